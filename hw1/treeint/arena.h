@@ -0,0 +1,342 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "common.h"
+
+/* Index arena: the nodes of a tree of int keys allocated from one growable
+ * array and linked by 32-bit indices instead of pointers.
+ *
+ * A pointer-based node pays 8 bytes per link, plus the padding of whatever
+ * small fields sit next to them: with the int key, an st_node takes 40 bytes.
+ * Here a node is the key, two child indices and a parent word, 16 bytes in
+ * total, so four nodes share a cache line and a tree of a given size touches
+ * less than half the lines. The low IA_META_BITS of the parent word are left
+ * to the tree, e.g. for the hint of an S-Tree or the colour of a red-black
+ * tree, which caps the arena at 2^26 nodes.
+ *
+ * Index 0 (IA_NIL) is never handed out and stands for the null link. Freed
+ * nodes are chained through their left index and reused first. Growing the
+ * arena moves the array, so the nodes must only be referred to by index
+ * across ia_alloc().
+ *
+ * Since the links are indices, the node array can be written to a file as it
+ * is and mapped back at any address, see ia_save() and ia_map().
+ */
+
+#define IA_NIL 0
+#define IA_META_BITS 6
+#define IA_META_MASK ((1U << IA_META_BITS) - 1)
+#define IA_MAX_NODES (1U << (32 - IA_META_BITS))
+
+struct ia_node {
+    int key;
+    uint32_t left, right;
+    /* parent index above IA_META_BITS bits of tree specific data */
+    uint32_t parent_meta;
+};
+
+struct ia_arena {
+    struct ia_node *nodes;
+    uint32_t nr;  /* slots handed out so far, including IA_NIL */
+    uint32_t cap; /* slots allocated */
+    uint32_t free, nr_free; /* free list chained through the left index */
+    /* Image file the nodes live in, see ia_map(), NULL for the heap */
+    void *map;
+    size_t map_size;
+    int map_prot;
+};
+
+/* Header of an image file, followed by the nr slots of the node array. The
+ * image is in the byte order of the machine that wrote it, which the magic
+ * number checks, and the tag tells which tree the nodes belong to.
+ */
+#define IA_IMAGE_MAGIC 0x31474d4941414e49ULL /* "INAAIMG1" */
+
+struct ia_image {
+    uint64_t magic;
+    uint32_t node_size;
+    uint32_t tag;
+    uint32_t nr, free, nr_free;
+    uint32_t root;
+};
+
+#define ia_pack(p, meta) ((uint32_t) (p) << IA_META_BITS | (meta))
+#define ia_parent(pm) ((pm) >> IA_META_BITS)
+#define ia_meta(pm) ((pm) &IA_META_MASK)
+
+static inline void ia_set_parent(struct ia_node *n, uint32_t p)
+{
+    n->parent_meta = ia_pack(p, ia_meta(n->parent_meta));
+}
+
+static inline void ia_set_meta(struct ia_node *n, unsigned int meta)
+{
+    n->parent_meta = ia_pack(ia_parent(n->parent_meta), meta);
+}
+
+static inline void ia_init(struct ia_arena *a)
+{
+    memset(a, 0, sizeof(*a));
+    a->nr = 1; /* reserve IA_NIL */
+}
+
+/* Return the index of a zeroed node, IA_NIL when out of memory */
+static inline uint32_t ia_alloc(struct ia_arena *a)
+{
+    uint32_t i = a->free;
+
+    if (i) {
+        a->free = a->nodes[i].left;
+        a->nr_free--;
+    } else {
+        if (a->nr >= a->cap) {
+            uint32_t cap = a->cap ? a->cap * 2 : 64;
+            if (cap > IA_MAX_NODES)
+                cap = IA_MAX_NODES;
+            if (cap == a->cap)
+                return IA_NIL;
+
+            struct ia_node *nodes;
+            if (a->map) {
+                /* An image has no room to grow, move to the heap */
+                nodes = malloc(cap * sizeof(*nodes));
+                if (!nodes)
+                    return IA_NIL;
+                memcpy(nodes, a->nodes, a->nr * sizeof(*nodes));
+                munmap(a->map, a->map_size);
+                a->map = NULL;
+            } else {
+                nodes = realloc(a->nodes, cap * sizeof(*nodes));
+                if (!nodes)
+                    return IA_NIL;
+            }
+            /* keep IA_NIL readable as an empty node */
+            if (!a->cap)
+                memset(nodes, 0, sizeof(*nodes));
+            a->nodes = nodes;
+            a->cap = cap;
+        }
+        i = a->nr++;
+    }
+
+    memset(&a->nodes[i], 0, sizeof(struct ia_node));
+    return i;
+}
+
+static inline void ia_free(struct ia_arena *a, uint32_t i)
+{
+    a->nodes[i].left = a->free;
+    a->free = i;
+    a->nr_free++;
+}
+
+/* Number of nodes in use */
+static inline size_t ia_count(const struct ia_arena *a)
+{
+    return a->nr - 1 - a->nr_free;
+}
+
+/* Bytes held by the arena, including the slack of the last growth */
+static inline size_t ia_memsize(const struct ia_arena *a)
+{
+    return (size_t) a->cap * sizeof(struct ia_node);
+}
+
+static inline void ia_release(struct ia_arena *a)
+{
+    if (a->map)
+        munmap(a->map, a->map_size);
+    else
+        free(a->nodes);
+    ia_init(a);
+}
+
+/* Write the nodes of the arena and the root of its tree to an image file.
+ *
+ * The image goes to path.tmp first and is renamed over path once it is on
+ * disk, so that a crash never leaves a half-written image behind, and saving
+ * a mapped arena onto its own image does not truncate the file under the
+ * mapping: the mapping keeps the old file.
+ */
+static inline int ia_save(const struct ia_arena *a,
+                          uint32_t root,
+                          uint32_t tag,
+                          const char *path)
+{
+    struct ia_image hdr = {
+        .magic = IA_IMAGE_MAGIC,
+        .node_size = sizeof(struct ia_node),
+        .tag = tag,
+        .nr = a->nr,
+        .free = a->free,
+        .nr_free = a->nr_free,
+        .root = root,
+    };
+    /* An arena that never allocated has no array yet, only IA_NIL */
+    const struct ia_node nil = {0};
+    const struct ia_node *nodes = a->cap ? a->nodes : &nil;
+
+    size_t len = strlen(path);
+    char *tmp = malloc(len + sizeof(".tmp"));
+    if (!tmp)
+        return -1;
+    memcpy(tmp, path, len);
+    memcpy(tmp + len, ".tmp", sizeof(".tmp"));
+
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+        free(tmp);
+        return -1;
+    }
+
+    int ret = 0;
+    if (fwrite(&hdr, sizeof(hdr), 1, f) != 1 ||
+        fwrite(nodes, sizeof(*nodes), a->nr, f) != a->nr || fflush(f) ||
+        fsync(fileno(f)))
+        ret = -1;
+
+    if (fclose(f))
+        ret = -1;
+    if (!ret && rename(tmp, path))
+        ret = -1;
+    if (ret)
+        unlink(tmp);
+
+    free(tmp);
+    return ret;
+}
+
+/* Check that a corrupt or truncated image cannot lead the tree code out of the
+ * array, or around in circles: every link stays in the array, the free list
+ * ends after nr_free distinct nodes, and the children of the nodes in use are
+ * in use too and link back to them, up to the root. A path down from the root
+ * then never comes back to a node, which would have two parents. The keys and
+ * the tree specific data are not checked.
+ */
+static inline int ia_test_bit(const uint64_t *bits, uint32_t i)
+{
+    return bits[i / 64] >> i % 64 & 1;
+}
+
+static inline int ia_check(const struct ia_image *hdr,
+                           const struct ia_node *nodes)
+{
+    uint32_t nr = hdr->nr, i = hdr->free;
+
+    for (uint32_t k = 0; k < nr; k++) {
+        if (nodes[k].left >= nr || nodes[k].right >= nr ||
+            ia_parent(nodes[k].parent_meta) >= nr)
+            return -1;
+    }
+
+    if (hdr->nr_free >= nr)
+        return -1;
+
+    uint64_t *is_free = calloc(nr / 64 + 1, sizeof(uint64_t));
+    if (!is_free)
+        return -1;
+
+    int ret = -1;
+    for (uint32_t k = 0; k < hdr->nr_free; k++) {
+        if (i == IA_NIL || ia_test_bit(is_free, i))
+            goto out;
+        is_free[i / 64] |= 1ULL << i % 64;
+        i = nodes[i].left;
+    }
+    if (i != IA_NIL)
+        goto out;
+
+    i = hdr->root;
+    if (i && (ia_test_bit(is_free, i) ||
+              ia_parent(nodes[i].parent_meta) != IA_NIL))
+        goto out;
+
+    for (uint32_t k = 1; k < nr; k++) {
+        if (ia_test_bit(is_free, k))
+            continue;
+
+        uint32_t l = nodes[k].left, r = nodes[k].right;
+        if ((l && (ia_test_bit(is_free, l) ||
+                   ia_parent(nodes[l].parent_meta) != k)) ||
+            (r && (ia_test_bit(is_free, r) ||
+                   ia_parent(nodes[r].parent_meta) != k)))
+            goto out;
+    }
+    ret = 0;
+
+out:
+    free(is_free);
+    return ret;
+}
+
+/* Map an image file written by ia_save() as the nodes of an empty arena, and
+ * store the root of its tree in *root. The mapping is private and read-only:
+ * lookups read the pages of the file in place, as the page cache holds them,
+ * and nothing is copied, though ia_check() reads the whole image once.
+ * ia_cow() must be called before the nodes are modified.
+ */
+static inline int ia_map(struct ia_arena *a,
+                         uint32_t *root,
+                         uint32_t tag,
+                         const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) || (size_t) st.st_size < sizeof(struct ia_image)) {
+        close(fd);
+        return -1;
+    }
+
+    size_t size = st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+
+    const struct ia_image *hdr = map;
+    if (hdr->magic != IA_IMAGE_MAGIC ||
+        hdr->node_size != sizeof(struct ia_node) || hdr->tag != tag ||
+        !hdr->nr || hdr->nr > IA_MAX_NODES ||
+        size != sizeof(*hdr) + (size_t) hdr->nr * sizeof(struct ia_node) ||
+        hdr->root >= hdr->nr || hdr->free >= hdr->nr ||
+        ia_check(hdr, (const struct ia_node *) (hdr + 1))) {
+        munmap(map, size);
+        return -1;
+    }
+
+    a->nodes = (struct ia_node *) (hdr + 1);
+    a->nr = a->cap = hdr->nr;
+    a->free = hdr->free;
+    a->nr_free = hdr->nr_free;
+    a->map = map;
+    a->map_size = size;
+    a->map_prot = PROT_READ;
+    *root = hdr->root;
+    return 0;
+}
+
+/* Let the nodes of a mapped image be modified. The mapping stays private, so
+ * the kernel copies each page on its first write only, and the file is never
+ * modified.
+ */
+static inline void ia_cow(struct ia_arena *a)
+{
+    if (a->map && a->map_prot == PROT_READ) {
+        if (mprotect(a->map, a->map_size, PROT_READ | PROT_WRITE))
+            throw_err("arena: cannot write to the image");
+        a->map_prot = PROT_READ | PROT_WRITE;
+    }
+}
+
+#endif
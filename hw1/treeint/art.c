@@ -0,0 +1,630 @@
+/*
+ * Adaptive Radix Tree of int keys.
+ *
+ * A key is 4 bytes, so there are at most 4 inner nodes on any path, each one
+ * branching on the byte that follows its prefix. The prefixes are stored in
+ * full (pessimistic path compression), since at most 3 bytes can ever be
+ * skipped, but lookups do not even look at them: the key stored in the slot
+ * they end at is compared in full anyway, which catches any mismatch.
+ *
+ * Insertion ends either in an empty slot of an inner node, which takes the key
+ * and grows the node if it was full, or on a key or a prefix that differs from
+ * the new one, which are then pushed down under a new node4 branching on the
+ * first byte they differ at. Removal empties the slot of the key and shrinks
+ * the node once it is left with well below the children of the smaller size,
+ * not to switch back and forth around the boundary. A node4 left with a single
+ * child is replaced by that child, its prefix and branching byte moving down
+ * into the prefix of the child.
+ */
+#include "art.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ART_X86_SIMD
+#endif
+
+_Static_assert(sizeof(art_ref) > sizeof(int),
+               "keys must fit in a child slot next to the tag bit");
+
+#define art_is_key(r) ((r) & 1)
+#define art_ref_key(u) (((art_ref) (u) << 1) | 1)
+#define art_key_bits(r) ((uint32_t) ((r) >> 1))
+#define art_node(r) ((struct art_node *) (r))
+
+#define art_node4(n) ((struct art_node4 *) (n))
+#define art_node16(n) ((struct art_node16 *) (n))
+#define art_node48(n) ((struct art_node48 *) (n))
+#define art_node256(n) ((struct art_node256 *) (n))
+
+/* Shrink a node once it has this many children left */
+#define ART_NODE16_MIN 3
+#define ART_NODE48_MIN 12
+#define ART_NODE256_MIN 37
+
+static const size_t art_node_size[] = {
+    [ART_NODE4] = sizeof(struct art_node4),
+    [ART_NODE16] = sizeof(struct art_node16),
+    [ART_NODE48] = sizeof(struct art_node48),
+    [ART_NODE256] = sizeof(struct art_node256),
+};
+
+/* The keys with the sign bit flipped, so that unsigned order is key order */
+static inline uint32_t art_bits(int key)
+{
+    return (uint32_t) key ^ 0x80000000u;
+}
+
+static inline int art_key(uint32_t u)
+{
+    return (int) (u ^ 0x80000000u);
+}
+
+/* Byte d of u, 0 being the most significant */
+static inline uint8_t art_byte(uint32_t u, int d)
+{
+    return u >> (24 - 8 * d);
+}
+
+static struct art_node *art_alloc(uint8_t type)
+{
+    struct art_node *n = calloc(art_node_size[type], 1);
+    assert(n);
+    n->type = type;
+    return n;
+}
+
+struct art *art_create(void)
+{
+    return calloc(sizeof(struct art), 1);
+}
+
+static void art_free(art_ref r)
+{
+    if (!r || art_is_key(r))
+        return;
+
+    struct art_node *n = art_node(r);
+    switch (n->type) {
+    case ART_NODE4:
+        for (int i = 0; i < n->nr; i++)
+            art_free(art_node4(n)->child[i]);
+        break;
+    case ART_NODE16:
+        for (int i = 0; i < n->nr; i++)
+            art_free(art_node16(n)->child[i]);
+        break;
+    case ART_NODE48:
+        for (int i = 0; i < 48; i++)
+            art_free(art_node48(n)->child[i]);
+        break;
+    case ART_NODE256:
+        for (int i = 0; i < 256; i++)
+            art_free(art_node256(n)->child[i]);
+        break;
+    }
+    free(n);
+}
+
+void art_destroy(struct art *tree)
+{
+    art_free(tree->root);
+    free(tree);
+}
+
+#ifdef ART_X86_SIMD
+static inline int art_find16(const struct art_node16 *n, uint8_t b)
+{
+    __m128i keys = _mm_loadu_si128((const __m128i *) n->keys);
+    unsigned int mask =
+        _mm_movemask_epi8(_mm_cmpeq_epi8(keys, _mm_set1_epi8(b)));
+
+    mask &= (1U << n->hdr.nr) - 1;
+    return mask ? __builtin_ctz(mask) : -1;
+}
+#else
+static inline int art_find16(const struct art_node16 *n, uint8_t b)
+{
+    for (int i = 0; i < n->hdr.nr; i++) {
+        if (n->keys[i] == b)
+            return i;
+    }
+    return -1;
+}
+#endif
+
+/* Slot of the child of byte b, NULL if there is none */
+static inline art_ref *art_find_child(struct art_node *n, uint8_t b)
+{
+    int i;
+
+    switch (n->type) {
+    case ART_NODE4:
+        for (i = 0; i < n->nr; i++) {
+            if (art_node4(n)->keys[i] == b)
+                return &art_node4(n)->child[i];
+        }
+        return NULL;
+    case ART_NODE16:
+        i = art_find16(art_node16(n), b);
+        return i < 0 ? NULL : &art_node16(n)->child[i];
+    case ART_NODE48:
+        i = art_node48(n)->index[b];
+        return i ? &art_node48(n)->child[i - 1] : NULL;
+    default:
+        return art_node256(n)->child[b] ? &art_node256(n)->child[b] : NULL;
+    }
+}
+
+/* Insert c at byte b in the sorted arrays of a node4 or node16 with room */
+static void art_add_sorted(uint8_t *keys,
+                           art_ref *child,
+                           int nr,
+                           uint8_t b,
+                           art_ref c)
+{
+    int i = 0;
+
+    while (i < nr && keys[i] < b)
+        i++;
+    memmove(keys + i + 1, keys + i, nr - i);
+    memmove(child + i + 1, child + i, (nr - i) * sizeof(art_ref));
+    keys[i] = b;
+    child[i] = c;
+}
+
+/* Move the header and children of n to a node of the next size up */
+static struct art_node *art_grow(struct art_node *n)
+{
+    struct art_node *m = art_alloc(n->type + 1);
+
+    memcpy(m->prefix, n->prefix, sizeof(n->prefix));
+    m->prefix_len = n->prefix_len;
+    m->nr = n->nr;
+
+    switch (n->type) {
+    case ART_NODE4:
+        memcpy(art_node16(m)->keys, art_node4(n)->keys, n->nr);
+        memcpy(art_node16(m)->child, art_node4(n)->child,
+               n->nr * sizeof(art_ref));
+        break;
+    case ART_NODE16:
+        for (int i = 0; i < n->nr; i++) {
+            art_node48(m)->index[art_node16(n)->keys[i]] = i + 1;
+            art_node48(m)->child[i] = art_node16(n)->child[i];
+        }
+        break;
+    case ART_NODE48:
+        for (int b = 0; b < 256; b++) {
+            int i = art_node48(n)->index[b];
+            if (i)
+                art_node256(m)->child[b] = art_node48(n)->child[i - 1];
+        }
+        break;
+    }
+
+    free(n);
+    return m;
+}
+
+/* Add the child c of byte b to the node in *slot, growing it if it is full */
+static void art_add_child(art_ref *slot, uint8_t b, art_ref c)
+{
+    struct art_node *n = art_node(*slot);
+
+    if ((n->type == ART_NODE4 && n->nr == 4) ||
+        (n->type == ART_NODE16 && n->nr == 16) ||
+        (n->type == ART_NODE48 && n->nr == 48)) {
+        n = art_grow(n);
+        *slot = (art_ref) n;
+    }
+
+    switch (n->type) {
+    case ART_NODE4:
+        art_add_sorted(art_node4(n)->keys, art_node4(n)->child, n->nr, b, c);
+        break;
+    case ART_NODE16:
+        art_add_sorted(art_node16(n)->keys, art_node16(n)->child, n->nr, b,
+                       c);
+        break;
+    case ART_NODE48: {
+        /* Removals leave holes, take the first one */
+        int i = 0;
+        while (art_node48(n)->child[i])
+            i++;
+        art_node48(n)->child[i] = c;
+        art_node48(n)->index[b] = i + 1;
+        break;
+    }
+    case ART_NODE256:
+        art_node256(n)->child[b] = c;
+        break;
+    }
+    n->nr++;
+}
+
+/* A node4 branching on the first byte from depth on where the key u and the
+ * subtree r, whose bytes before that are those of u, differ
+ */
+static art_ref art_split(art_ref r,
+                         uint8_t rb,
+                         uint32_t u,
+                         int depth,
+                         int prefix_len)
+{
+    struct art_node *n = art_alloc(ART_NODE4);
+
+    for (int i = 0; i < prefix_len; i++)
+        n->prefix[i] = art_byte(u, depth + i);
+    n->prefix_len = prefix_len;
+
+    art_ref slot = (art_ref) n;
+    art_add_child(&slot, rb, r);
+    art_add_child(&slot, art_byte(u, depth + prefix_len), art_ref_key(u));
+    return slot;
+}
+
+static int art_insert_at(art_ref *slot, uint32_t u, int depth)
+{
+    art_ref r = *slot;
+
+    if (!r) {
+        *slot = art_ref_key(u);
+        return 0;
+    }
+
+    if (art_is_key(r)) {
+        uint32_t v = art_key_bits(r);
+        int p = 0;
+
+        if (v == u)
+            return -1;
+        while (art_byte(v, depth + p) == art_byte(u, depth + p))
+            p++;
+        *slot = art_split(r, art_byte(v, depth + p), u, depth, p);
+        return 0;
+    }
+
+    struct art_node *n = art_node(r);
+    int p = 0;
+    while (p < n->prefix_len && n->prefix[p] == art_byte(u, depth + p))
+        p++;
+
+    if (p < n->prefix_len) {
+        /* The node keeps the bytes of its prefix past the one it differs at */
+        uint8_t nb = n->prefix[p];
+        n->prefix_len -= p + 1;
+        memmove(n->prefix, n->prefix + p + 1, n->prefix_len);
+        *slot = art_split(r, nb, u, depth, p);
+        return 0;
+    }
+
+    depth += n->prefix_len;
+    art_ref *c = art_find_child(n, art_byte(u, depth));
+    if (c)
+        return art_insert_at(c, u, depth + 1);
+
+    art_add_child(slot, art_byte(u, depth), art_ref_key(u));
+    return 0;
+}
+
+int art_insert(struct art *tree, int key)
+{
+    return art_insert_at(&tree->root, art_bits(key), 0);
+}
+
+art_ref *art_find(struct art *tree, int key)
+{
+    uint32_t u = art_bits(key);
+    art_ref *slot = &tree->root;
+    int depth = 0;
+
+    while (*slot && !art_is_key(*slot)) {
+        struct art_node *n = art_node(*slot);
+
+        /* Skip the prefix unchecked, the key found will tell */
+        depth += n->prefix_len;
+        slot = art_find_child(n, art_byte(u, depth++));
+        if (!slot)
+            return NULL;
+    }
+
+    return *slot && art_key_bits(*slot) == u ? slot : NULL;
+}
+
+/* Move the header and children of n to a node of the next size down */
+static struct art_node *art_shrink(struct art_node *n)
+{
+    struct art_node *m = art_alloc(n->type - 1);
+    int j = 0;
+
+    memcpy(m->prefix, n->prefix, sizeof(n->prefix));
+    m->prefix_len = n->prefix_len;
+    m->nr = n->nr;
+
+    switch (n->type) {
+    case ART_NODE16:
+        memcpy(art_node4(m)->keys, art_node16(n)->keys, n->nr);
+        memcpy(art_node4(m)->child, art_node16(n)->child,
+               n->nr * sizeof(art_ref));
+        break;
+    case ART_NODE48:
+        for (int b = 0; b < 256; b++) {
+            int i = art_node48(n)->index[b];
+            if (!i)
+                continue;
+            art_node16(m)->keys[j] = b;
+            art_node16(m)->child[j++] = art_node48(n)->child[i - 1];
+        }
+        break;
+    case ART_NODE256:
+        for (int b = 0; b < 256; b++) {
+            art_ref c = art_node256(n)->child[b];
+            if (!c)
+                continue;
+            art_node48(m)->index[b] = j + 1;
+            art_node48(m)->child[j++] = c;
+        }
+        break;
+    }
+
+    free(n);
+    return m;
+}
+
+/* Replace a node4 with a single child by that child */
+static art_ref art_collapse(struct art_node *n)
+{
+    art_ref c = art_node4(n)->child[0];
+
+    if (!art_is_key(c)) {
+        struct art_node *m = art_node(c);
+        uint8_t prefix[3];
+        int len = n->prefix_len;
+
+        memcpy(prefix, n->prefix, len);
+        prefix[len++] = art_node4(n)->keys[0];
+        memcpy(prefix + len, m->prefix, m->prefix_len);
+        len += m->prefix_len;
+        assert(len <= 3);
+
+        memcpy(m->prefix, prefix, len);
+        m->prefix_len = len;
+    }
+
+    free(n);
+    return c;
+}
+
+/* Remove the child of byte b, held in c, from the node in *slot */
+static void art_remove_child(art_ref *slot, uint8_t b, art_ref *c)
+{
+    struct art_node *n = art_node(*slot);
+    int i;
+
+    switch (n->type) {
+    case ART_NODE4:
+        i = c - art_node4(n)->child;
+        memmove(art_node4(n)->keys + i, art_node4(n)->keys + i + 1,
+                n->nr - i - 1);
+        memmove(c, c + 1, (n->nr - i - 1) * sizeof(art_ref));
+        if (--n->nr == 1)
+            *slot = art_collapse(n);
+        return;
+    case ART_NODE16:
+        i = c - art_node16(n)->child;
+        memmove(art_node16(n)->keys + i, art_node16(n)->keys + i + 1,
+                n->nr - i - 1);
+        memmove(c, c + 1, (n->nr - i - 1) * sizeof(art_ref));
+        if (--n->nr == ART_NODE16_MIN)
+            *slot = (art_ref) art_shrink(n);
+        return;
+    case ART_NODE48:
+        art_node48(n)->index[b] = 0;
+        *c = 0;
+        if (--n->nr == ART_NODE48_MIN)
+            *slot = (art_ref) art_shrink(n);
+        return;
+    case ART_NODE256:
+        *c = 0;
+        if (--n->nr == ART_NODE256_MIN)
+            *slot = (art_ref) art_shrink(n);
+        return;
+    }
+}
+
+static int art_remove_at(art_ref *slot, uint32_t u, int depth)
+{
+    struct art_node *n = art_node(*slot);
+
+    for (int p = 0; p < n->prefix_len; p++) {
+        if (n->prefix[p] != art_byte(u, depth + p))
+            return -1;
+    }
+    depth += n->prefix_len;
+
+    uint8_t b = art_byte(u, depth);
+    art_ref *c = art_find_child(n, b);
+    if (!c)
+        return -1;
+
+    if (!art_is_key(*c))
+        return art_remove_at(c, u, depth + 1);
+    if (art_key_bits(*c) != u)
+        return -1;
+
+    art_remove_child(slot, b, c);
+    return 0;
+}
+
+int art_remove(struct art *tree, int key)
+{
+    uint32_t u = art_bits(key);
+    art_ref r = tree->root;
+
+    if (!r)
+        return -1;
+
+    if (art_is_key(r)) {
+        if (art_key_bits(r) != u)
+            return -1;
+        tree->root = 0;
+        return 0;
+    }
+
+    return art_remove_at(&tree->root, u, 0);
+}
+
+struct art_scan {
+    uint32_t lo, hi;
+    void (*cb)(int key, void *arg);
+    void *arg;
+    size_t nr;
+};
+
+static void art_scan(struct art_scan *s,
+                     art_ref r,
+                     int depth,
+                     bool lo_tight,
+                     bool hi_tight);
+
+/* Child of byte b of a node visited by art_scan() */
+static inline void art_scan_child(struct art_scan *s,
+                                  art_ref c,
+                                  uint8_t b,
+                                  int depth,
+                                  bool lo_tight,
+                                  bool hi_tight)
+{
+    art_scan(s, c, depth + 1, lo_tight && b == art_byte(s->lo, depth),
+             hi_tight && b == art_byte(s->hi, depth));
+}
+
+/* Visit the keys of r within [s->lo, s->hi], r being reached through the
+ * first depth bytes of s->lo if lo_tight, of s->hi if hi_tight, and through
+ * bytes strictly in between otherwise. Only the subtrees on the edges of the
+ * range need their bytes checked, those in between are walked whole.
+ */
+static void art_scan(struct art_scan *s,
+                     art_ref r,
+                     int depth,
+                     bool lo_tight,
+                     bool hi_tight)
+{
+    if (art_is_key(r)) {
+        uint32_t u = art_key_bits(r);
+        if (u >= s->lo && u <= s->hi) {
+            s->cb(art_key(u), s->arg);
+            s->nr++;
+        }
+        return;
+    }
+
+    struct art_node *n = art_node(r);
+    for (int p = 0; p < n->prefix_len; p++, depth++) {
+        uint8_t b = n->prefix[p];
+        if (lo_tight) {
+            if (b < art_byte(s->lo, depth))
+                return;
+            lo_tight = b == art_byte(s->lo, depth);
+        }
+        if (hi_tight) {
+            if (b > art_byte(s->hi, depth))
+                return;
+            hi_tight = b == art_byte(s->hi, depth);
+        }
+    }
+
+    int first = lo_tight ? art_byte(s->lo, depth) : 0;
+    int last = hi_tight ? art_byte(s->hi, depth) : 255;
+
+    switch (n->type) {
+    case ART_NODE4:
+        for (int i = 0; i < n->nr; i++) {
+            uint8_t b = art_node4(n)->keys[i];
+            if (b >= first && b <= last)
+                art_scan_child(s, art_node4(n)->child[i], b, depth, lo_tight,
+                               hi_tight);
+        }
+        break;
+    case ART_NODE16:
+        for (int i = 0; i < n->nr; i++) {
+            uint8_t b = art_node16(n)->keys[i];
+            if (b >= first && b <= last)
+                art_scan_child(s, art_node16(n)->child[i], b, depth, lo_tight,
+                               hi_tight);
+        }
+        break;
+    case ART_NODE48:
+        for (int b = first; b <= last; b++) {
+            int i = art_node48(n)->index[b];
+            if (i)
+                art_scan_child(s, art_node48(n)->child[i - 1], b, depth,
+                               lo_tight, hi_tight);
+        }
+        break;
+    case ART_NODE256:
+        for (int b = first; b <= last; b++) {
+            art_ref c = art_node256(n)->child[b];
+            if (c)
+                art_scan_child(s, c, b, depth, lo_tight, hi_tight);
+        }
+        break;
+    }
+}
+
+size_t art_range(struct art *tree,
+                 int lo,
+                 int hi,
+                 void (*cb)(int key, void *arg),
+                 void *arg)
+{
+    struct art_scan s = {
+        .lo = art_bits(lo),
+        .hi = art_bits(hi),
+        .cb = cb,
+        .arg = arg,
+    };
+
+    if (tree->root && lo <= hi)
+        art_scan(&s, tree->root, 0, true, true);
+    return s.nr;
+}
+
+static size_t art_node_memsize(art_ref r)
+{
+    if (!r || art_is_key(r))
+        return 0;
+
+    struct art_node *n = art_node(r);
+    size_t size = art_node_size[n->type];
+
+    switch (n->type) {
+    case ART_NODE4:
+        for (int i = 0; i < n->nr; i++)
+            size += art_node_memsize(art_node4(n)->child[i]);
+        break;
+    case ART_NODE16:
+        for (int i = 0; i < n->nr; i++)
+            size += art_node_memsize(art_node16(n)->child[i]);
+        break;
+    case ART_NODE48:
+        for (int i = 0; i < 48; i++)
+            size += art_node_memsize(art_node48(n)->child[i]);
+        break;
+    case ART_NODE256:
+        for (int i = 0; i < 256; i++)
+            size += art_node_memsize(art_node256(n)->child[i]);
+        break;
+    }
+    return size;
+}
+
+size_t art_memsize(struct art *tree)
+{
+    return sizeof(*tree) + art_node_memsize(tree->root);
+}
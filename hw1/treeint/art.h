@@ -0,0 +1,83 @@
+#ifndef ART_H
+#define ART_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Adaptive Radix Tree of int keys (Leis, Kemper & Neumann).
+ *
+ * Instead of comparing whole keys, a lookup goes down one byte of the key per
+ * level, most significant first, so there are at most 4 levels whatever the
+ * number of keys. Each inner node only has room for the children it needs: 4,
+ * 16 or 48 of them indexed by their byte, or 256 slots indexed directly, and
+ * grows or shrinks to the next size as children come and go. Chains of nodes
+ * with a single child are collapsed into a prefix of bytes in the node below,
+ * and a subtree holding a single key is just that key.
+ *
+ * The keys are short enough to be stored in the child slots themselves, tagged
+ * by their lowest bit, so that there are no leaf nodes at all. The key bytes
+ * are taken with the sign bit flipped, which makes their order the one of the
+ * keys, and an in-order walk of the tree sorted.
+ */
+
+#define ART_NODE4 0
+#define ART_NODE16 1
+#define ART_NODE48 2
+#define ART_NODE256 3
+
+/* Child slot, either a pointer to an inner node or a key shifted left by one
+ * with the lowest bit set, 0 if empty
+ */
+typedef uintptr_t art_ref;
+
+struct art_node {
+    uint8_t type;
+    uint8_t prefix_len;
+    /* Bytes skipped before the one this node branches on */
+    uint8_t prefix[3];
+    uint16_t nr; /* number of children */
+};
+
+struct art_node4 {
+    struct art_node hdr;
+    uint8_t keys[4]; /* sorted */
+    art_ref child[4];
+};
+
+struct art_node16 {
+    struct art_node hdr;
+    uint8_t keys[16]; /* sorted */
+    art_ref child[16];
+};
+
+struct art_node48 {
+    struct art_node hdr;
+    uint8_t index[256]; /* 1 + position of the child of each byte, 0 if none */
+    art_ref child[48];
+};
+
+struct art_node256 {
+    struct art_node hdr;
+    art_ref child[256];
+};
+
+struct art {
+    art_ref root;
+};
+
+struct art *art_create(void);
+void art_destroy(struct art *tree);
+int art_insert(struct art *tree, int key);
+int art_remove(struct art *tree, int key);
+/* Return the slot holding key, NULL if there is none */
+art_ref *art_find(struct art *tree, int key);
+/* Visit the keys in [lo, hi] in order, return how many */
+size_t art_range(struct art *tree,
+                 int lo,
+                 int hi,
+                 void (*cb)(int key, void *arg),
+                 void *arg);
+/* Bytes held by the tree, counting every node in full */
+size_t art_memsize(struct art *tree);
+
+#endif
@@ -0,0 +1,572 @@
+/*
+ * B+-Tree with cache-line sized nodes.
+ *
+ * The tree keeps every leaf at the same depth. Lookups walk down from the root
+ * choosing a child with a search over the sorted separator keys of each inner
+ * node, which costs one or a few adjacent cache lines per level instead of one
+ * miss per binary comparison.
+ *
+ * Insertion descends to the leaf while remembering the path. When the leaf is
+ * full it is split in halves and the first key of the new right half is
+ * inserted into the parent as a separator, which may split the parent in turn.
+ * A split of the root grows the tree by one level.
+ *
+ * Removal deletes the key from its leaf. If the leaf falls below half
+ * occupancy, a key is borrowed from a sibling under the same parent when the
+ * sibling can spare one, otherwise the two nodes are merged and the separator
+ * between them is removed from the parent, which may underflow in turn. An
+ * inner root left with a single child is replaced by that child.
+ */
+#include "bptree.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BP_X86_SIMD
+#endif
+
+#define BP_MAX_HEIGHT 16
+#define BP_INNER_MIN (BP_INNER_KEYS / 2)
+#define BP_LEAF_MIN (BP_LEAF_KEYS / 2)
+
+_Static_assert(sizeof(struct bp_inner) <= BPTREE_NODE_SIZE,
+               "inner node exceeds BPTREE_NODE_SIZE");
+_Static_assert(sizeof(struct bp_leaf) <= BPTREE_NODE_SIZE,
+               "leaf node exceeds BPTREE_NODE_SIZE");
+
+#define bp_inner(n) ((struct bp_inner *) (n))
+#define bp_leaf(n) ((struct bp_leaf *) (n))
+
+static void *bp_alloc(void)
+{
+    void *n = aligned_alloc(64, BPTREE_NODE_SIZE);
+    assert(n);
+    memset(n, 0, BPTREE_NODE_SIZE);
+    return n;
+}
+
+/* Number of keys strictly less than key */
+static inline unsigned int bp_rank_scalar(const int *keys,
+                                          unsigned int nr,
+                                          int key)
+{
+    unsigned int lo = 0, hi = nr;
+
+    while (lo < hi) {
+        unsigned int mid = (lo + hi) / 2;
+        if (keys[mid] < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+#ifdef BP_X86_SIMD
+/* Since the keys of a node are sorted, the number of lanes holding a key less
+ * than the searched one is exactly its rank. The lanes past nr are masked out
+ * rather than padded with sentinels, so the node layout is the same for every
+ * search variant.
+ */
+static unsigned int bp_rank_sse2(const int *keys, unsigned int nr, int key)
+{
+    __m128i k = _mm_set1_epi32(key);
+    unsigned int rank = 0, i = 0;
+
+    for (; i + 4 <= nr; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *) &keys[i]);
+        __m128i lt = _mm_cmpgt_epi32(k, v);
+        rank += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(lt)));
+    }
+    for (; i < nr; i++)
+        rank += keys[i] < key;
+
+    return rank;
+}
+
+__attribute__((target("avx2,popcnt"))) static unsigned int
+bp_rank_avx2(const int *keys, unsigned int nr, int key)
+{
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i k = _mm256_set1_epi32(key);
+    unsigned int rank = 0, i = 0;
+
+    for (; i + 8 <= nr; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) &keys[i]);
+        __m256 lt = _mm256_castsi256_ps(_mm256_cmpgt_epi32(k, v));
+        rank += __builtin_popcount(_mm256_movemask_ps(lt));
+    }
+
+    if (i < nr) {
+        __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(nr - i), lane);
+        __m256i v = _mm256_maskload_epi32(&keys[i], valid);
+        __m256i lt = _mm256_and_si256(_mm256_cmpgt_epi32(k, v), valid);
+        __m256 mask = _mm256_castsi256_ps(lt);
+        rank += __builtin_popcount(_mm256_movemask_ps(mask));
+    }
+
+    return rank;
+}
+
+__attribute__((target("avx512f,popcnt"))) static unsigned int
+bp_rank_avx512(const int *keys, unsigned int nr, int key)
+{
+    __m512i k = _mm512_set1_epi32(key);
+    unsigned int rank = 0;
+
+    /* 16 keys per compare, the masked load never touches the lanes past nr */
+    for (unsigned int i = 0; i < nr; i += 16) {
+        __mmask16 valid = nr - i >= 16 ? 0xffff : (1U << (nr - i)) - 1;
+        __m512i v = _mm512_maskz_loadu_epi32(valid, &keys[i]);
+        rank += __builtin_popcount(_mm512_mask_cmplt_epi32_mask(valid, v, k));
+    }
+
+    return rank;
+}
+#endif
+
+static inline unsigned int bp_rank(const struct bptree *tree,
+                                   const int *keys,
+                                   unsigned int nr,
+                                   int key)
+{
+#ifdef BP_X86_SIMD
+    switch (tree->search) {
+    case BP_SEARCH_AVX512:
+        return bp_rank_avx512(keys, nr, key);
+    case BP_SEARCH_AVX2:
+        return bp_rank_avx2(keys, nr, key);
+    case BP_SEARCH_SSE2:
+        return bp_rank_sse2(keys, nr, key);
+    default:
+        break;
+    }
+#else
+    (void) tree;
+#endif
+    return bp_rank_scalar(keys, nr, key);
+}
+
+/* Number of keys less than or equal to key, i.e. the child to descend into */
+static inline unsigned int bp_rank_upper(const struct bptree *tree,
+                                         const int *keys,
+                                         unsigned int nr,
+                                         int key)
+{
+    if (unlikely(key == INT_MAX))
+        return nr;
+    return bp_rank(tree, keys, nr, key + 1);
+}
+
+struct bptree *bptree_create(int flags)
+{
+    struct bptree *tree = calloc(sizeof(struct bptree), 1);
+    if (!tree)
+        return NULL;
+
+    tree->search = BP_SEARCH_SCALAR;
+#ifdef BP_X86_SIMD
+    if (flags & BPTREE_SIMD) {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            tree->search = BP_SEARCH_AVX512;
+        else if (__builtin_cpu_supports("avx2"))
+            tree->search = BP_SEARCH_AVX2;
+        else
+            tree->search = BP_SEARCH_SSE2;
+    }
+#else
+    (void) flags;
+#endif
+    return tree;
+}
+
+static void __bptree_destroy(struct bp_node *n, int height)
+{
+    if (height) {
+        for (unsigned int i = 0; i <= n->nr; i++)
+            __bptree_destroy(bp_inner(n)->child[i], height - 1);
+    }
+    free(n);
+}
+
+void bptree_destroy(struct bptree *tree)
+{
+    if (tree->root)
+        __bptree_destroy(tree->root, tree->height);
+    free(tree);
+}
+
+static size_t __bptree_memsize(struct bp_node *n, int height)
+{
+    size_t size = BPTREE_NODE_SIZE;
+
+    if (height) {
+        for (unsigned int i = 0; i <= n->nr; i++)
+            size += __bptree_memsize(bp_inner(n)->child[i], height - 1);
+    }
+    return size;
+}
+
+size_t bptree_memsize(struct bptree *tree)
+{
+    size_t size = sizeof(*tree);
+
+    if (tree->root)
+        size += __bptree_memsize(tree->root, tree->height);
+    return size;
+}
+
+static struct bp_leaf *bp_find_leaf(struct bptree *tree,
+                                    int key,
+                                    struct bp_inner **path,
+                                    unsigned int *idx)
+{
+    struct bp_node *n = tree->root;
+
+    for (int h = 0; h < tree->height; h++) {
+        struct bp_inner *in = bp_inner(n);
+        unsigned int i = bp_rank_upper(tree, in->keys, in->hdr.nr, key);
+        path[h] = in;
+        idx[h] = i;
+        n = in->child[i];
+    }
+
+    return bp_leaf(n);
+}
+
+int *bptree_find(struct bptree *tree, int key)
+{
+    struct bp_node *n = tree->root;
+    if (!n)
+        return NULL;
+
+    for (int h = 0; h < tree->height; h++) {
+        struct bp_inner *in = bp_inner(n);
+        n = in->child[bp_rank_upper(tree, in->keys, in->hdr.nr, key)];
+    }
+
+    struct bp_leaf *leaf = bp_leaf(n);
+    unsigned int pos = bp_rank(tree, leaf->keys, leaf->hdr.nr, key);
+    if (pos < leaf->hdr.nr && leaf->keys[pos] == key)
+        return &leaf->keys[pos];
+
+    return NULL;
+}
+
+struct bp_leaf *bptree_lower_bound(struct bptree *tree,
+                                   int key,
+                                   unsigned int *pos)
+{
+    struct bp_node *n = tree->root;
+    if (!n)
+        return NULL;
+
+    for (int h = 0; h < tree->height; h++) {
+        struct bp_inner *in = bp_inner(n);
+        n = in->child[bp_rank_upper(tree, in->keys, in->hdr.nr, key)];
+    }
+
+    /* The key may be past the last one of its leaf, and the leaf may even be
+     * empty if it is the root, so move on to the next one as needed.
+     */
+    struct bp_leaf *leaf = bp_leaf(n);
+    unsigned int i = bp_rank(tree, leaf->keys, leaf->hdr.nr, key);
+    if (i == leaf->hdr.nr) {
+        leaf = leaf->next;
+        i = 0;
+    }
+
+    *pos = i;
+    return leaf;
+}
+
+static struct bp_leaf *bp_split_leaf(struct bp_leaf *leaf,
+                                     unsigned int pos,
+                                     int key)
+{
+    struct bp_leaf *right = bp_alloc();
+    unsigned int split = BP_LEAF_KEYS / 2;
+
+    memcpy(right->keys, &leaf->keys[split],
+           (BP_LEAF_KEYS - split) * sizeof(int));
+    right->hdr.nr = BP_LEAF_KEYS - split;
+    leaf->hdr.nr = split;
+
+    right->next = leaf->next;
+    right->prev = leaf;
+    if (leaf->next)
+        leaf->next->prev = right;
+    leaf->next = right;
+
+    struct bp_leaf *dst = leaf;
+    if (pos > split) {
+        dst = right;
+        pos -= split;
+    }
+    memmove(&dst->keys[pos + 1], &dst->keys[pos],
+            (dst->hdr.nr - pos) * sizeof(int));
+    dst->keys[pos] = key;
+    dst->hdr.nr++;
+
+    return right;
+}
+
+/* Insert separator key 'sep' with its right child into a full inner node.
+ * The upper half is moved into a new node, which is returned, and the median
+ * key to be pushed into the parent is stored in *up.
+ */
+static struct bp_inner *bp_split_inner(struct bp_inner *in,
+                                       unsigned int pos,
+                                       int sep,
+                                       struct bp_node *child,
+                                       int *up)
+{
+    int keys[BP_INNER_KEYS + 1];
+    struct bp_node *children[BP_INNER_KEYS + 2];
+
+    memcpy(keys, in->keys, pos * sizeof(int));
+    keys[pos] = sep;
+    memcpy(&keys[pos + 1], &in->keys[pos],
+           (BP_INNER_KEYS - pos) * sizeof(int));
+
+    memcpy(children, in->child, (pos + 1) * sizeof(struct bp_node *));
+    children[pos + 1] = child;
+    memcpy(&children[pos + 2], &in->child[pos + 1],
+           (BP_INNER_KEYS - pos) * sizeof(struct bp_node *));
+
+    struct bp_inner *right = bp_alloc();
+    unsigned int m = (BP_INNER_KEYS + 1) / 2;
+
+    memcpy(in->keys, keys, m * sizeof(int));
+    memcpy(in->child, children, (m + 1) * sizeof(struct bp_node *));
+    in->hdr.nr = m;
+
+    *up = keys[m];
+
+    right->hdr.nr = BP_INNER_KEYS - m;
+    memcpy(right->keys, &keys[m + 1], right->hdr.nr * sizeof(int));
+    memcpy(right->child, &children[m + 1],
+           (right->hdr.nr + 1) * sizeof(struct bp_node *));
+
+    return right;
+}
+
+int bptree_insert(struct bptree *tree, int key)
+{
+    struct bp_inner *path[BP_MAX_HEIGHT];
+    unsigned int idx[BP_MAX_HEIGHT];
+
+    if (!tree->root) {
+        struct bp_leaf *leaf = bp_alloc();
+        leaf->keys[0] = key;
+        leaf->hdr.nr = 1;
+        tree->root = &leaf->hdr;
+        return 0;
+    }
+
+    struct bp_leaf *leaf = bp_find_leaf(tree, key, path, idx);
+    unsigned int pos = bp_rank(tree, leaf->keys, leaf->hdr.nr, key);
+    if (pos < leaf->hdr.nr && leaf->keys[pos] == key)
+        return -1;
+
+    if (leaf->hdr.nr < BP_LEAF_KEYS) {
+        memmove(&leaf->keys[pos + 1], &leaf->keys[pos],
+                (leaf->hdr.nr - pos) * sizeof(int));
+        leaf->keys[pos] = key;
+        leaf->hdr.nr++;
+        return 0;
+    }
+
+    struct bp_leaf *rleaf = bp_split_leaf(leaf, pos, key);
+    struct bp_node *child = &rleaf->hdr;
+    int sep = rleaf->keys[0];
+
+    for (int h = tree->height - 1; h >= 0; h--) {
+        struct bp_inner *in = path[h];
+        unsigned int i = idx[h];
+
+        if (in->hdr.nr < BP_INNER_KEYS) {
+            memmove(&in->keys[i + 1], &in->keys[i],
+                    (in->hdr.nr - i) * sizeof(int));
+            memmove(&in->child[i + 2], &in->child[i + 1],
+                    (in->hdr.nr - i) * sizeof(struct bp_node *));
+            in->keys[i] = sep;
+            in->child[i + 1] = child;
+            in->hdr.nr++;
+            return 0;
+        }
+
+        child = &bp_split_inner(in, i, sep, child, &sep)->hdr;
+    }
+
+    /* The root was split: grow the tree by one level */
+    assert(tree->height + 1 < BP_MAX_HEIGHT);
+    struct bp_inner *root = bp_alloc();
+    root->hdr.nr = 1;
+    root->keys[0] = sep;
+    root->child[0] = tree->root;
+    root->child[1] = child;
+    tree->root = &root->hdr;
+    tree->height++;
+
+    return 0;
+}
+
+/* Remove the separator key i and the child on its right from an inner node */
+static void bp_inner_remove(struct bp_inner *in, unsigned int i)
+{
+    memmove(&in->keys[i], &in->keys[i + 1],
+            (in->hdr.nr - i - 1) * sizeof(int));
+    memmove(&in->child[i + 1], &in->child[i + 2],
+            (in->hdr.nr - i - 1) * sizeof(struct bp_node *));
+    in->hdr.nr--;
+}
+
+/* Fix an underflowing leaf, the i-th child of parent. Return true if a
+ * separator was removed from parent.
+ */
+static int bp_rebalance_leaf(struct bp_inner *parent,
+                             unsigned int i,
+                             struct bp_leaf *leaf)
+{
+    struct bp_leaf *left = i > 0 ? bp_leaf(parent->child[i - 1]) : NULL;
+    struct bp_leaf *right =
+        i < parent->hdr.nr ? bp_leaf(parent->child[i + 1]) : NULL;
+
+    if (left && left->hdr.nr > BP_LEAF_MIN) {
+        memmove(&leaf->keys[1], &leaf->keys[0], leaf->hdr.nr * sizeof(int));
+        leaf->keys[0] = left->keys[--left->hdr.nr];
+        leaf->hdr.nr++;
+        parent->keys[i - 1] = leaf->keys[0];
+        return 0;
+    }
+
+    if (right && right->hdr.nr > BP_LEAF_MIN) {
+        leaf->keys[leaf->hdr.nr++] = right->keys[0];
+        memmove(&right->keys[0], &right->keys[1],
+                --right->hdr.nr * sizeof(int));
+        parent->keys[i] = right->keys[0];
+        return 0;
+    }
+
+    /* Merge the right node of the pair into the left one */
+    if (left) {
+        right = leaf;
+        i--;
+    } else {
+        left = leaf;
+    }
+
+    memcpy(&left->keys[left->hdr.nr], right->keys, right->hdr.nr * sizeof(int));
+    left->hdr.nr += right->hdr.nr;
+    left->next = right->next;
+    if (right->next)
+        right->next->prev = left;
+    free(right);
+
+    bp_inner_remove(parent, i);
+    return 1;
+}
+
+static int bp_rebalance_inner(struct bp_inner *parent,
+                              unsigned int i,
+                              struct bp_inner *in)
+{
+    struct bp_inner *left = i > 0 ? bp_inner(parent->child[i - 1]) : NULL;
+    struct bp_inner *right =
+        i < parent->hdr.nr ? bp_inner(parent->child[i + 1]) : NULL;
+
+    if (left && left->hdr.nr > BP_INNER_MIN) {
+        memmove(&in->keys[1], &in->keys[0], in->hdr.nr * sizeof(int));
+        memmove(&in->child[1], &in->child[0],
+                (in->hdr.nr + 1) * sizeof(struct bp_node *));
+        in->keys[0] = parent->keys[i - 1];
+        in->child[0] = left->child[left->hdr.nr];
+        in->hdr.nr++;
+        parent->keys[i - 1] = left->keys[--left->hdr.nr];
+        return 0;
+    }
+
+    if (right && right->hdr.nr > BP_INNER_MIN) {
+        in->keys[in->hdr.nr] = parent->keys[i];
+        in->child[++in->hdr.nr] = right->child[0];
+        parent->keys[i] = right->keys[0];
+        memmove(&right->keys[0], &right->keys[1],
+                (right->hdr.nr - 1) * sizeof(int));
+        memmove(&right->child[0], &right->child[1],
+                right->hdr.nr * sizeof(struct bp_node *));
+        right->hdr.nr--;
+        return 0;
+    }
+
+    if (left) {
+        right = in;
+        i--;
+    } else {
+        left = in;
+    }
+
+    left->keys[left->hdr.nr] = parent->keys[i];
+    memcpy(&left->keys[left->hdr.nr + 1], right->keys,
+           right->hdr.nr * sizeof(int));
+    memcpy(&left->child[left->hdr.nr + 1], right->child,
+           (right->hdr.nr + 1) * sizeof(struct bp_node *));
+    left->hdr.nr += right->hdr.nr + 1;
+    free(right);
+
+    bp_inner_remove(parent, i);
+    return 1;
+}
+
+int bptree_remove(struct bptree *tree, int key)
+{
+    struct bp_inner *path[BP_MAX_HEIGHT];
+    unsigned int idx[BP_MAX_HEIGHT];
+
+    if (!tree->root)
+        return -1;
+
+    struct bp_leaf *leaf = bp_find_leaf(tree, key, path, idx);
+    unsigned int pos = bp_rank(tree, leaf->keys, leaf->hdr.nr, key);
+    if (pos >= leaf->hdr.nr || leaf->keys[pos] != key)
+        return -1;
+
+    memmove(&leaf->keys[pos], &leaf->keys[pos + 1],
+            (leaf->hdr.nr - pos - 1) * sizeof(int));
+    leaf->hdr.nr--;
+
+    if (tree->height == 0) {
+        if (leaf->hdr.nr == 0) {
+            free(leaf);
+            tree->root = NULL;
+        }
+        return 0;
+    }
+
+    if (leaf->hdr.nr >= BP_LEAF_MIN)
+        return 0;
+
+    int h = tree->height - 1;
+    if (!bp_rebalance_leaf(path[h], idx[h], leaf))
+        return 0;
+
+    for (; h > 0 && path[h]->hdr.nr < BP_INNER_MIN; h--) {
+        if (!bp_rebalance_inner(path[h - 1], idx[h - 1], path[h]))
+            return 0;
+    }
+
+    /* Shrink the tree if the root has a single child left */
+    struct bp_inner *root = bp_inner(tree->root);
+    if (root->hdr.nr == 0) {
+        tree->root = root->child[0];
+        tree->height--;
+        free(root);
+    }
+
+    return 0;
+}
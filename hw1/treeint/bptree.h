@@ -0,0 +1,79 @@
+#ifndef BPTREE_H
+#define BPTREE_H
+
+#include <stddef.h>
+
+/* B+-Tree: a cache-conscious ordered index of int keys.
+ *
+ * Unlike the binary trees, which spend one node (and thus at least one cache
+ * miss) per key compared, a B+-tree node holds a sorted array of keys spanning
+ * BPTREE_NODE_SIZE bytes. Inner nodes only carry separator keys and child
+ * pointers, so the fanout stays high and the tree stays shallow, while all
+ * the keys live in the leaves, which are chained through sibling links for
+ * ordered traversal.
+ */
+
+/* Size of a node in bytes. Pick a multiple of the cache line size, or the
+ * page size for trees that mostly live out of cache.
+ */
+#ifndef BPTREE_NODE_SIZE
+#define BPTREE_NODE_SIZE 256
+#endif
+
+#define BP_INNER_KEYS ((BPTREE_NODE_SIZE - 16) / 12)
+#define BP_LEAF_KEYS ((BPTREE_NODE_SIZE - 24) / 4)
+
+struct bp_node {
+    unsigned int nr; /* number of keys in use */
+};
+
+struct bp_inner {
+    struct bp_node hdr;
+    int keys[BP_INNER_KEYS];
+    /* child[i] holds the keys k with keys[i - 1] <= k < keys[i] */
+    struct bp_node *child[BP_INNER_KEYS + 1];
+};
+
+struct bp_leaf {
+    struct bp_node hdr;
+    struct bp_leaf *prev, *next;
+    int keys[BP_LEAF_KEYS];
+};
+
+/* How keys are located inside a node. The vectorized variants compare a whole
+ * register of keys against the searched one at once and turn the resulting
+ * mask into the rank of the key with a popcount, instead of branching on every
+ * step of a binary search.
+ */
+enum bp_search {
+    BP_SEARCH_SCALAR,
+    BP_SEARCH_SSE2,
+    BP_SEARCH_AVX2,
+    BP_SEARCH_AVX512,
+};
+
+/* Flags for bptree_create() */
+#define BPTREE_SIMD (1 << 0) /* best in-node search supported by the CPU */
+
+struct bptree {
+    struct bp_node *root;
+    int height; /* number of inner levels above the leaves */
+    enum bp_search search;
+};
+
+struct bptree *bptree_create(int flags);
+void bptree_destroy(struct bptree *tree);
+int bptree_insert(struct bptree *tree, int key);
+int bptree_remove(struct bptree *tree, int key);
+int *bptree_find(struct bptree *tree, int key);
+/* Bytes held by the tree, counting every node in full */
+size_t bptree_memsize(struct bptree *tree);
+
+/* Return the leaf holding the first key not less than key, and its position
+ * in *pos. The following keys are reached through the leaf sibling links.
+ */
+struct bp_leaf *bptree_lower_bound(struct bptree *tree,
+                                   int key,
+                                   unsigned int *pos);
+
+#endif
@@ -8,6 +8,8 @@
 #define container_of(ptr, type, member) \
     ((type *) ((char *) (ptr) - (offsetof(type, member))))
 
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
 static inline int throw_err(const char *str)
 {
     fprintf(stderr, "%s\n", str);
@@ -27,6 +29,15 @@ static inline int throw_err(const char *str)
     } while (0)
 #endif
 
+/* Access shared data exactly once, without tearing or fusing, for the lockless
+ * readers of concurrently modified structures.
+ */
+#define READ_ONCE(x) (*(const volatile __typeof__(x) *) &(x))
+#define WRITE_ONCE(x, val)                        \
+    do {                                          \
+        *(volatile __typeof__(x) *) &(x) = (val); \
+    } while (0)
+
 #define unlikely(x) __builtin_expect(!!(x), 0)
 #define __unused __attribute__((unused))
 #endif
@@ -0,0 +1,174 @@
+#include "ebr.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "common.h"
+
+/* Epochs advance by 2, the lowest bit of a reader slot tells whether the
+ * thread is inside a read section.
+ */
+#define EBR_ACTIVE 1UL
+
+struct ebr_reader {
+    unsigned long state; /* epoch | EBR_ACTIVE while reading, 0 otherwise */
+    int in_use;
+    struct ebr_reader *next;
+
+    /* see ebr_retire_local(), only touched by the owning thread */
+    void **retired;
+    size_t nr_retired, cap_retired;
+} __attribute__((aligned(64))); /* one cache line per reader */
+
+static unsigned long ebr_epoch = 2;
+/* Slots are never freed, the slot of an exited thread is reused */
+static struct ebr_reader *ebr_readers;
+static __thread struct ebr_reader *ebr_self;
+
+static pthread_key_t ebr_key;
+static pthread_once_t ebr_once = PTHREAD_ONCE_INIT;
+
+static void __ebr_flush_local(struct ebr_reader *r)
+{
+    if (!r->nr_retired)
+        return;
+
+    ebr_synchronize();
+    for (size_t i = 0; i < r->nr_retired; i++)
+        free(r->retired[i]);
+    r->nr_retired = 0;
+}
+
+static void ebr_thread_exit(void *arg)
+{
+    struct ebr_reader *r = arg;
+
+    __ebr_flush_local(r);
+    __atomic_store_n(&r->state, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&r->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static void ebr_key_create(void)
+{
+    pthread_key_create(&ebr_key, ebr_thread_exit);
+}
+
+static struct ebr_reader *ebr_register(void)
+{
+    struct ebr_reader *r;
+
+    pthread_once(&ebr_once, ebr_key_create);
+
+    for (r = __atomic_load_n(&ebr_readers, __ATOMIC_ACQUIRE); r; r = r->next) {
+        int unused = 0;
+        if (__atomic_compare_exchange_n(&r->in_use, &unused, 1, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            goto out;
+    }
+
+    r = aligned_alloc(64, sizeof(*r));
+    if (!r)
+        throw_err("ebr: out of memory");
+    r->state = 0;
+    r->in_use = 1;
+    r->retired = NULL;
+    r->nr_retired = r->cap_retired = 0;
+    r->next = __atomic_load_n(&ebr_readers, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&ebr_readers, &r->next, r, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+
+out:
+    pthread_setspecific(ebr_key, r);
+    ebr_self = r;
+    return r;
+}
+
+void ebr_read_lock(void)
+{
+    struct ebr_reader *r = ebr_self;
+
+    if (unlikely(!r))
+        r = ebr_register();
+
+    __atomic_store_n(&r->state,
+                     __atomic_load_n(&ebr_epoch, __ATOMIC_RELAXED) | EBR_ACTIVE,
+                     __ATOMIC_RELAXED);
+    /* Pairs with the fence of ebr_synchronize(): either the writer sees this
+     * reader as active, or the reader sees the unlinking done by the writer.
+     */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void ebr_read_unlock(void)
+{
+    struct ebr_reader *r = ebr_self;
+
+    __atomic_store_n(&r->state, 0, __ATOMIC_RELEASE);
+    if (r->nr_retired >= EBR_BATCH)
+        __ebr_flush_local(r);
+}
+
+void ebr_synchronize(void)
+{
+    unsigned long epoch = __atomic_add_fetch(&ebr_epoch, 2, __ATOMIC_SEQ_CST);
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    /* Readers that entered in the new epoch cannot reach what was unlinked
+     * before it started, only wait for the ones still in an older epoch.
+     */
+    for (struct ebr_reader *r = __atomic_load_n(&ebr_readers, __ATOMIC_ACQUIRE);
+         r; r = r->next) {
+        unsigned long state;
+
+        while ((state = __atomic_load_n(&r->state, __ATOMIC_ACQUIRE)) &
+                   EBR_ACTIVE &&
+               state < epoch)
+            sched_yield();
+    }
+}
+
+void ebr_flush(struct ebr_limbo *limbo)
+{
+    if (!limbo->nr)
+        return;
+
+    ebr_synchronize();
+    for (size_t i = 0; i < limbo->nr; i++)
+        limbo->free_fn(limbo->ptrs[i]);
+    limbo->nr = 0;
+}
+
+void ebr_retire_local(void *ptr)
+{
+    struct ebr_reader *r = ebr_self;
+
+    if (unlikely(!r))
+        r = ebr_register();
+
+    /* Flushing is not possible from inside a read section, so grow instead */
+    if (r->nr_retired == r->cap_retired) {
+        size_t cap = r->cap_retired ? r->cap_retired * 2 : EBR_BATCH;
+        void **retired = realloc(r->retired, cap * sizeof(*retired));
+        if (!retired)
+            throw_err("ebr: out of memory");
+        r->retired = retired;
+        r->cap_retired = cap;
+    }
+
+    r->retired[r->nr_retired++] = ptr;
+}
+
+void ebr_flush_local(void)
+{
+    if (ebr_self)
+        __ebr_flush_local(ebr_self);
+}
+
+void ebr_retire(struct ebr_limbo *limbo, void *ptr)
+{
+    limbo->ptrs[limbo->nr++] = ptr;
+    if (limbo->nr == EBR_BATCH)
+        ebr_flush(limbo);
+}
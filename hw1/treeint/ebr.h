@@ -0,0 +1,49 @@
+#ifndef EBR_H
+#define EBR_H
+
+#include <stddef.h>
+
+/* Epoch-based reclamation of the memory of lockless data structures.
+ *
+ * A lockless reader may still hold a pointer to a node that a writer has just
+ * unlinked, so the node can only be freed once every reader that might have
+ * seen it is gone. Readers wrap their accesses in ebr_read_lock() and
+ * ebr_read_unlock(), which only publish the current epoch in a per-thread
+ * slot. ebr_synchronize() starts a new epoch and waits until no thread is
+ * still reading in an older one, the equivalent of synchronize_rcu().
+ *
+ * Retired nodes are collected in a limbo list and freed in batches, so that
+ * the cost of a grace period is shared by EBR_BATCH nodes. A limbo list is
+ * not thread-safe: it belongs to a writer, or is protected by its lock.
+ * Read sections must not nest, nor call ebr_synchronize().
+ */
+
+#define EBR_BATCH 256
+
+struct ebr_limbo {
+    void (*free_fn)(void *ptr);
+    size_t nr;
+    void *ptrs[EBR_BATCH];
+};
+
+void ebr_read_lock(void);
+void ebr_read_unlock(void);
+void ebr_synchronize(void);
+
+/* Free ptr with free_fn() once no reader can see it anymore */
+void ebr_retire(struct ebr_limbo *limbo, void *ptr);
+/* Wait for a grace period and free everything retired so far, e.g. before the
+ * structure owning the limbo list goes away.
+ */
+void ebr_flush(struct ebr_limbo *limbo);
+
+/* For structures with concurrent writers: retire ptr, to be released with
+ * free(), to a limbo list private to the calling thread. It may be called
+ * inside a read section, the list is only flushed by ebr_read_unlock() once
+ * EBR_BATCH nodes piled up, and when the thread exits. ebr_flush_local()
+ * flushes it right away, outside of a read section.
+ */
+void ebr_retire_local(void *ptr);
+void ebr_flush_local(void);
+
+#endif
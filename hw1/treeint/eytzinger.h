@@ -0,0 +1,89 @@
+#ifndef EYTZINGER_H
+#define EYTZINGER_H
+
+#include <stddef.h>
+#include <stdlib.h>
+
+/* Eytzinger layout: a read-only snapshot of an ordered set stored as an
+ * implicit binary tree in breadth-first order. The root lives at index 1 and
+ * the children of node k live at 2k and 2k + 1, so the array carries no
+ * pointers at all and the first levels of every search share the same few
+ * cache lines. Index 0 is left unused.
+ *
+ * Since the descendants of node k four levels down are 16 consecutive slots
+ * starting at 16k, a single prefetch per step keeps the memory requests of the
+ * next levels in flight while the current comparison is resolved.
+ */
+
+/* Index of the smallest element of the layout, 0 when it is empty */
+static inline size_t ez_first(size_t nr)
+{
+    size_t k = 1;
+
+    if (!nr)
+        return 0;
+    while (2 * k <= nr)
+        k = 2 * k;
+    return k;
+}
+
+/* Index of the in-order successor of k, 0 when k is the largest element */
+static inline size_t ez_next(size_t k, size_t nr)
+{
+    if (2 * k + 1 <= nr) {
+        k = 2 * k + 1;
+        while (2 * k <= nr)
+            k = 2 * k;
+        return k;
+    }
+
+    /* climb while k is a right child, then its parent is the successor */
+    while (k & 1)
+        k >>= 1;
+    return k >> 1;
+}
+
+/* Allocate a cache line aligned layout for nr elements of the given size */
+static inline void *ez_alloc(size_t nr, size_t size)
+{
+    size_t bytes = (nr + 1) * size;
+    return aligned_alloc(64, (bytes + 63) & ~(size_t) 63);
+}
+
+/* A frozen set of int keys */
+struct ez_tree {
+    size_t nr;
+    int *keys;
+};
+
+/* Index of the smallest key not less than key, 0 if there is none.
+ *
+ * The descent is branchless: the result of each comparison only feeds the
+ * next index. When the loop falls off the bottom of the tree, the last left
+ * turn is recovered from the trailing one bits of k.
+ */
+static inline size_t ez_lower_bound(const struct ez_tree *ez, int key)
+{
+    const int *keys = ez->keys;
+    size_t k = 1;
+
+    while (k <= ez->nr) {
+        __builtin_prefetch(keys + 16 * k);
+        k = 2 * k + (keys[k] < key);
+    }
+    return k >> __builtin_ffsl(~k);
+}
+
+static inline int *ez_find(const struct ez_tree *ez, int key)
+{
+    size_t k = ez_lower_bound(ez, key);
+    return (k && ez->keys[k] == key) ? &ez->keys[k] : NULL;
+}
+
+static inline void ez_destroy(struct ez_tree *ez)
+{
+    free(ez->keys);
+    free(ez);
+}
+
+#endif
@@ -0,0 +1,229 @@
+/*
+ * Swiss table of int keys.
+ *
+ * The groups are aligned, and the probe sequence visits them in triangular
+ * steps (1, 2, 3... groups further each time), which covers all of them since
+ * their number is a power of two. A lookup stops at the first group holding
+ * an empty slot, the key would have been put there or earlier otherwise.
+ *
+ * Removal can therefore only empty a slot again if its group already holds an
+ * empty slot, so that no probe sequence used to go through the group. It marks
+ * the slot as deleted otherwise, a tombstone that insertions may reuse and that
+ * only a rehash clears. The table is rehashed once its empty slots run out,
+ * into twice as many slots if it holds more than half of its 7/8 load, or
+ * into the same number of slots to purge the tombstones otherwise.
+ */
+#include "hashtable.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HT_X86_SIMD
+#endif
+
+/* Number of slots of a table of ht->mask + 1 groups, and of them the most that
+ * can be in use or deleted
+ */
+#define ht_capacity(ht) (((ht)->mask + 1) * HT_GROUP_SIZE)
+#define ht_max_load(cap) ((cap) - (cap) / 8)
+
+/* splitmix64 finalizer: consecutive keys land in unrelated groups, and the
+ * low 7 bits stored in the control bytes do not depend on the group.
+ */
+static inline uint64_t ht_hash(int key)
+{
+    uint64_t h = (uint32_t) key;
+
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+#define ht_h1(h) ((h) >> 7)
+#define ht_h2(h) ((uint8_t) ((h) & 0x7f))
+
+/* Bit i set for each control byte i of the group equal to c */
+#ifdef HT_X86_SIMD
+static inline unsigned int ht_match(const uint8_t *group, uint8_t c)
+{
+    __m128i ctrl = _mm_load_si128((const __m128i *) group);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(c)));
+}
+#else
+static inline unsigned int ht_match(const uint8_t *group, uint8_t c)
+{
+    unsigned int mask = 0;
+
+    for (int i = 0; i < HT_GROUP_SIZE; i++)
+        mask |= (unsigned int) (group[i] == c) << i;
+    return mask;
+}
+#endif
+
+/* Bit i set for each slot i of the group free to take a key, empty or deleted,
+ * which are the only control bytes with the top bit set
+ */
+#ifdef HT_X86_SIMD
+static inline unsigned int ht_match_free(const uint8_t *group)
+{
+    return _mm_movemask_epi8(_mm_load_si128((const __m128i *) group));
+}
+#else
+static inline unsigned int ht_match_free(const uint8_t *group)
+{
+    unsigned int mask = 0;
+
+    for (int i = 0; i < HT_GROUP_SIZE; i++)
+        mask |= (unsigned int) (group[i] >> 7) << i;
+    return mask;
+}
+#endif
+
+static void ht_alloc(struct hashtable *ht, size_t nr_groups)
+{
+    size_t cap = nr_groups * HT_GROUP_SIZE;
+    size_t size = (cap + cap * sizeof(int) + 63) & ~(size_t) 63;
+
+    /* The keys follow the control bytes, both aligned to the groups */
+    ht->ctrl = aligned_alloc(64, size);
+    assert(ht->ctrl);
+    memset(ht->ctrl, HT_EMPTY, cap);
+    ht->keys = (int *) (ht->ctrl + cap);
+    ht->mask = nr_groups - 1;
+    ht->nr_free = ht_max_load(cap);
+}
+
+struct hashtable *ht_create(void)
+{
+    struct hashtable *ht = calloc(sizeof(struct hashtable), 1);
+    if (!ht)
+        return NULL;
+
+    ht_alloc(ht, 1);
+    return ht;
+}
+
+void ht_destroy(struct hashtable *ht)
+{
+    free(ht->ctrl);
+    free(ht);
+}
+
+/* Slot of key, or -1 */
+static inline ptrdiff_t ht_lookup(const struct hashtable *ht,
+                                  int key,
+                                  uint64_t h)
+{
+    size_t g = ht_h1(h) & ht->mask;
+
+    for (size_t step = 1;; step++) {
+        const uint8_t *group = ht->ctrl + g * HT_GROUP_SIZE;
+
+        for (unsigned int m = ht_match(group, ht_h2(h)); m; m &= m - 1) {
+            size_t i = g * HT_GROUP_SIZE + __builtin_ctz(m);
+            if (ht->keys[i] == key)
+                return i;
+        }
+
+        if (ht_match(group, HT_EMPTY))
+            return -1;
+
+        g = (g + step) & ht->mask;
+    }
+}
+
+/* First free slot of the probe sequence of h, there always is one */
+static inline size_t ht_find_free(const struct hashtable *ht, uint64_t h)
+{
+    size_t g = ht_h1(h) & ht->mask;
+
+    for (size_t step = 1;; step++) {
+        unsigned int m = ht_match_free(ht->ctrl + g * HT_GROUP_SIZE);
+        if (m)
+            return g * HT_GROUP_SIZE + __builtin_ctz(m);
+
+        g = (g + step) & ht->mask;
+    }
+}
+
+static void ht_rehash(struct hashtable *ht)
+{
+    struct hashtable old = *ht;
+    size_t cap = ht_capacity(ht);
+
+    ht_alloc(ht, ht->nr > ht_max_load(cap) / 2 ? (ht->mask + 1) * 2
+                                                : ht->mask + 1);
+
+    for (size_t i = 0; i < cap; i++) {
+        if (old.ctrl[i] & HT_EMPTY)
+            continue;
+
+        int key = old.keys[i];
+        uint64_t h = ht_hash(key);
+        size_t j = ht_find_free(ht, h);
+        ht->ctrl[j] = ht_h2(h);
+        ht->keys[j] = key;
+    }
+    ht->nr_free -= ht->nr;
+
+    free(old.ctrl);
+}
+
+int ht_insert(struct hashtable *ht, int key)
+{
+    uint64_t h = ht_hash(key);
+
+    if (ht_lookup(ht, key, h) >= 0)
+        return -1;
+
+    size_t i = ht_find_free(ht, h);
+    if (ht->ctrl[i] == HT_EMPTY) {
+        /* Reusing a tombstone is always fine, filling an empty slot may have
+         * to wait for a rehash
+         */
+        if (unlikely(!ht->nr_free)) {
+            ht_rehash(ht);
+            i = ht_find_free(ht, h);
+        }
+        ht->nr_free--;
+    }
+
+    ht->ctrl[i] = ht_h2(h);
+    ht->keys[i] = key;
+    ht->nr++;
+
+    return 0;
+}
+
+int ht_remove(struct hashtable *ht, int key)
+{
+    ptrdiff_t i = ht_lookup(ht, key, ht_hash(key));
+    if (i < 0)
+        return -1;
+
+    const uint8_t *group = ht->ctrl + (i & ~(ptrdiff_t) (HT_GROUP_SIZE - 1));
+    if (ht_match(group, HT_EMPTY)) {
+        ht->ctrl[i] = HT_EMPTY;
+        ht->nr_free++;
+    } else {
+        ht->ctrl[i] = HT_DELETED;
+    }
+    ht->nr--;
+
+    return 0;
+}
+
+int *ht_find(struct hashtable *ht, int key)
+{
+    ptrdiff_t i = ht_lookup(ht, key, ht_hash(key));
+
+    return i < 0 ? NULL : &ht->keys[i];
+}
+
+size_t ht_memsize(struct hashtable *ht)
+{
+    return sizeof(*ht) + ht_capacity(ht) * (1 + sizeof(int));
+}
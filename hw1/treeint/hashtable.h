@@ -0,0 +1,44 @@
+#ifndef HASHTABLE_H
+#define HASHTABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Open-addressing hash set of int keys, laid out as a Swiss table.
+ *
+ * The slots are split into groups of HT_GROUP_SIZE, each slot having a control
+ * byte next to the ones of its group: empty, deleted, or the low 7 bits of the
+ * hash of its key. A lookup hashes the key to a first group, then compares the
+ * control bytes of the whole group at once against the 7 bits it is after, so
+ * that only the few slots matching them have their key compared, and goes on
+ * to the next group of its probe sequence only if there was no empty slot in
+ * this one. Most lookups thus touch one line of control bytes and one line of
+ * keys, whatever the number of keys.
+ *
+ * The keys are kept in no particular order, so there are no range scans: this
+ * is the baseline telling what keeping the keys sorted costs the trees.
+ */
+
+#define HT_GROUP_SIZE 16
+
+struct hashtable {
+    uint8_t *ctrl; /* (mask + 1) * HT_GROUP_SIZE control bytes */
+    int *keys; /* as many slots, in the same allocation */
+    size_t mask; /* number of groups - 1, a power of two minus one */
+    size_t nr; /* keys held */
+    size_t nr_free; /* empty slots that can still be filled before a rehash */
+};
+
+struct hashtable *ht_create(void);
+void ht_destroy(struct hashtable *ht);
+int ht_insert(struct hashtable *ht, int key);
+int ht_remove(struct hashtable *ht, int key);
+int *ht_find(struct hashtable *ht, int key);
+/* Bytes held by the table, counting the slots in use or not */
+size_t ht_memsize(struct hashtable *ht);
+
+/* Control bytes below HT_EMPTY mark the slots in use */
+#define HT_EMPTY 0x80
+#define HT_DELETED 0xfe
+
+#endif
@@ -0,0 +1,168 @@
+#include "heap.h"
+#include <stdlib.h>
+
+void bheap_destroy(struct bheap *h)
+{
+    free(h->a);
+    *h = BHEAP_INIT;
+}
+
+static inline void bheap_set(struct bheap *h, size_t i, struct bheap_node *n)
+{
+    h->a[i] = n;
+    n->pos = i;
+}
+
+/* Move n up from the hole at i, see bheap_sift_down() for the way down */
+static void bheap_sift_up(struct bheap *h, size_t i, struct bheap_node *n)
+{
+    while (i) {
+        size_t p = (i - 1) / 2;
+        if (h->a[p]->key <= n->key)
+            break;
+
+        bheap_set(h, i, h->a[p]);
+        i = p;
+    }
+    bheap_set(h, i, n);
+}
+
+static void bheap_sift_down(struct bheap *h, size_t i, struct bheap_node *n)
+{
+    for (;;) {
+        size_t c = 2 * i + 1;
+        if (c >= h->nr)
+            break;
+
+        if (c + 1 < h->nr && h->a[c + 1]->key < h->a[c]->key)
+            c++;
+        if (n->key <= h->a[c]->key)
+            break;
+
+        bheap_set(h, i, h->a[c]);
+        i = c;
+    }
+    bheap_set(h, i, n);
+}
+
+int bheap_push(struct bheap *h, struct bheap_node *n)
+{
+    if (h->nr == h->cap) {
+        size_t cap = h->cap ? 2 * h->cap : 64;
+        struct bheap_node **a = realloc(h->a, sizeof(*a) * cap);
+
+        if (!a)
+            return -1;
+        h->a = a;
+        h->cap = cap;
+    }
+
+    bheap_sift_up(h, h->nr++, n);
+    return 0;
+}
+
+struct bheap_node *bheap_pop(struct bheap *h)
+{
+    struct bheap_node *min = bheap_peek(h);
+
+    if (min && --h->nr)
+        bheap_sift_down(h, 0, h->a[h->nr]);
+
+    return min;
+}
+
+void bheap_decrease(struct bheap *h, struct bheap_node *n, int key)
+{
+    n->key = key;
+    bheap_sift_up(h, n->pos, n);
+}
+
+/* Make the root with the larger key the first child of the other */
+static struct pheap_node *pheap_meld(struct pheap_node *a,
+                                     struct pheap_node *b)
+{
+    if (!a)
+        return b;
+    if (!b)
+        return a;
+
+    if (b->key < a->key) {
+        struct pheap_node *t = a;
+        a = b;
+        b = t;
+    }
+
+    b->prev = a;
+    b->next = a->child;
+    if (a->child)
+        a->child->prev = b;
+    a->child = b;
+    return a;
+}
+
+void pheap_push(struct pheap *h, struct pheap_node *n)
+{
+    n->child = n->next = n->prev = NULL;
+    h->root = pheap_meld(h->root, n);
+}
+
+/* Meld the siblings pairwise left to right, then the pairs right to left. The
+ * first pass chains the pairs through prev, backwards, for the second one to
+ * walk without recursion.
+ */
+static struct pheap_node *pheap_merge_pairs(struct pheap_node *first)
+{
+    struct pheap_node *pairs = NULL;
+
+    while (first) {
+        struct pheap_node *a = first, *b = a->next;
+
+        first = b ? b->next : NULL;
+        a->next = a->prev = NULL;
+        if (b)
+            b->next = b->prev = NULL;
+
+        a = pheap_meld(a, b);
+        a->prev = pairs;
+        pairs = a;
+    }
+
+    struct pheap_node *root = NULL;
+    while (pairs) {
+        struct pheap_node *prev = pairs->prev;
+
+        pairs->prev = NULL;
+        root = pheap_meld(pairs, root);
+        pairs = prev;
+    }
+
+    return root;
+}
+
+struct pheap_node *pheap_pop(struct pheap *h)
+{
+    struct pheap_node *min = h->root;
+
+    if (min)
+        h->root = pheap_merge_pairs(min->child);
+
+    return min;
+}
+
+void pheap_decrease(struct pheap *h, struct pheap_node *n, int key)
+{
+    n->key = key;
+    if (n == h->root)
+        return;
+
+    /* Cut the subtree of n out of its sibling list, then meld it back */
+    if (n->prev->child == n)
+        n->prev->child = n->next;
+    else
+        n->prev->next = n->next;
+    if (n->next)
+        n->next->prev = n->prev;
+
+    n->next = n->prev = NULL;
+    h->root = pheap_meld(h->root, n);
+}
@@ -0,0 +1,64 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <stddef.h>
+
+/* Min-heaps of int keys, the baselines for the priority queue operations of
+ * the rbtree. Nodes are embedded in the caller's objects as with rb_node, so
+ * that decrease-key can work from a handle instead of a search.
+ */
+
+/* Implicit binary heap in an array of node pointers, each node keeping its
+ * index for bheap_decrease().
+ */
+struct bheap_node {
+    int key;
+    size_t pos;
+};
+
+struct bheap {
+    struct bheap_node **a;
+    size_t nr, cap;
+};
+
+#define BHEAP_INIT \
+    (struct bheap) \
+    {              \
+        NULL, 0, 0 \
+    }
+
+void bheap_destroy(struct bheap *h);
+int bheap_push(struct bheap *h, struct bheap_node *n);
+struct bheap_node *bheap_pop(struct bheap *h);
+/* Lower the key of n, which must be in the heap, to key */
+void bheap_decrease(struct bheap *h, struct bheap_node *n, int key);
+
+static inline struct bheap_node *bheap_peek(const struct bheap *h)
+{
+    return h->nr ? h->a[0] : NULL;
+}
+
+/* Pairing heap (Fredman, Sedgewick, Sleator & Tarjan) with the two-pass
+ * pairing on pop. The children of a node are a doubly-linked list, prev
+ * pointing to the parent for the first child, so that a node can be cut out
+ * in O(1) by pheap_decrease().
+ */
+struct pheap_node {
+    int key;
+    struct pheap_node *child, *next, *prev;
+};
+
+struct pheap {
+    struct pheap_node *root;
+};
+
+void pheap_push(struct pheap *h, struct pheap_node *n);
+struct pheap_node *pheap_pop(struct pheap *h);
+void pheap_decrease(struct pheap *h, struct pheap_node *n, int key);
+
+static inline struct pheap_node *pheap_peek(const struct pheap *h)
+{
+    return h->root;
+}
+
+#endif
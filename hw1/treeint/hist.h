@@ -0,0 +1,79 @@
+#ifndef HIST_H
+#define HIST_H
+
+#include <stdint.h>
+#include <string.h>
+
+/* Latency histogram in the manner of HdrHistogram.
+ *
+ * Values are bucketed by their highest set bit, and each power of two is split
+ * into HIST_SUB linear sub-buckets, so that a value is known within 1 /
+ * HIST_SUB of itself (3% for 32) whatever its magnitude. Recording is a few
+ * instructions and the memory is fixed, so every operation of a run can be
+ * recorded, and any percentile read back afterwards.
+ */
+#define HIST_SUB_BITS 5
+#define HIST_SUB (1 << HIST_SUB_BITS)
+/* Values below HIST_SUB get a bucket each, then HIST_SUB per power of two */
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+struct hist {
+    uint64_t nr, sum, max;
+    uint64_t count[HIST_BUCKETS];
+};
+
+static inline void hist_init(struct hist *h)
+{
+    memset(h, 0, sizeof(*h));
+}
+
+static inline unsigned int hist_index(uint64_t v)
+{
+    if (v < HIST_SUB)
+        return v;
+
+    int shift = 63 - __builtin_clzll(v) - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB + (v >> shift) - HIST_SUB;
+}
+
+/* Highest value of bucket i */
+static inline uint64_t hist_value(unsigned int i)
+{
+    if (i < HIST_SUB)
+        return i;
+
+    int shift = i / HIST_SUB - 1;
+    return ((uint64_t) (i % HIST_SUB + HIST_SUB + 1) << shift) - 1;
+}
+
+static inline void hist_record(struct hist *h, uint64_t v)
+{
+    h->count[hist_index(v)]++;
+    h->nr++;
+    h->sum += v;
+    if (v > h->max)
+        h->max = v;
+}
+
+/* Smallest value that p percent of the recorded ones do not exceed, up to the
+ * precision of the buckets
+ */
+static inline uint64_t hist_percentile(const struct hist *h, double p)
+{
+    double r = p / 100 * h->nr;
+    uint64_t rank = r, seen = 0;
+
+    /* rounded up, and at least the first value */
+    if (rank < r || !rank)
+        rank++;
+
+    for (unsigned int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->count[i];
+        if (seen >= rank)
+            return hist_value(i) < h->max ? hist_value(i) : h->max;
+    }
+
+    return h->max;
+}
+
+#endif
@@ -0,0 +1,174 @@
+/*
+ * Interval tree, ported from linux/include/linux/interval_tree_generic.h.
+ *
+ * Descents maintain two conditions for a node to overlap [start, last]:
+ *   Cond1: node->start <= last
+ *   Cond2: start <= node->last
+ * Nodes are in order of start, so once Cond1 fails it fails for the rest of
+ * the walk. Cond2 is looked for through subtree_last, which tells whether a
+ * subtree holds any interval ending at start or later.
+ */
+#include "interval_tree.h"
+#include "common.h"
+#include "rbtree_augmented.h"
+
+#define it_entry(ptr) container_of(ptr, struct it_node, rb)
+
+static inline bool it_compute_last(struct it_node *node, bool exit)
+{
+    int max = node->last;
+
+    if (node->rb.rb_left && it_entry(node->rb.rb_left)->subtree_last > max)
+        max = it_entry(node->rb.rb_left)->subtree_last;
+    if (node->rb.rb_right && it_entry(node->rb.rb_right)->subtree_last > max)
+        max = it_entry(node->rb.rb_right)->subtree_last;
+
+    if (exit && node->subtree_last == max)
+        return true;
+    node->subtree_last = max;
+    return false;
+}
+
+RB_DECLARE_CALLBACKS(static,
+                     it_augment,
+                     struct it_node,
+                     rb,
+                     subtree_last,
+                     it_compute_last)
+
+static inline bool it_less(const struct it_node *a, int start, int last)
+{
+    return a->start < start || (a->start == start && a->last < last);
+}
+
+void it_insert(struct it_node *node, struct rb_root *root)
+{
+    struct rb_node **link = &root->rb_node, *rb_parent = NULL;
+
+    /* Every subtree on the way down gets node, so their max can only grow */
+    while (*link) {
+        struct it_node *parent = it_entry(*link);
+
+        rb_parent = *link;
+        if (parent->subtree_last < node->last)
+            parent->subtree_last = node->last;
+
+        if (it_less(parent, node->start, node->last))
+            link = &parent->rb.rb_right;
+        else
+            link = &parent->rb.rb_left;
+    }
+
+    node->subtree_last = node->last;
+    rb_link_node(&node->rb, rb_parent, link);
+    rb_insert_augmented(&node->rb, root, &it_augment);
+}
+
+void it_remove(struct it_node *node, struct rb_root *root)
+{
+    rb_erase_augmented(&node->rb, root, &it_augment);
+}
+
+struct it_node *it_find(struct rb_root *root, int start, int last)
+{
+    struct rb_node *n = root->rb_node;
+
+    while (n) {
+        struct it_node *node = it_entry(n);
+
+        if (node->start == start && node->last == last)
+            return node;
+
+        n = it_less(node, start, last) ? n->rb_right : n->rb_left;
+    }
+
+    return NULL;
+}
+
+/* The leftmost node of the subtree of node overlapping [start, last], given
+ * that the subtree holds an interval ending at start or later.
+ */
+static struct it_node *it_subtree_search(struct it_node *node,
+                                         int start,
+                                         int last)
+{
+    while (true) {
+        /* Loop invariant: start <= node->subtree_last (Cond2 is satisfied
+         * by one of the subtree nodes)
+         */
+        if (node->rb.rb_left) {
+            struct it_node *left = it_entry(node->rb.rb_left);
+            if (start <= left->subtree_last) {
+                /* Some nodes in left subtree satisfy Cond2. Iterate to find
+                 * the leftmost such node N. If it also satisfies Cond1, that's
+                 * the match we are looking for. Otherwise, there is no
+                 * matching interval as nodes to the right of N can't satisfy
+                 * Cond1 either.
+                 */
+                node = left;
+                continue;
+            }
+        }
+
+        if (node->start <= last) {   /* Cond1 */
+            if (start <= node->last) /* Cond2 */
+                return node;         /* node is leftmost match */
+            if (node->rb.rb_right) {
+                node = it_entry(node->rb.rb_right);
+                if (start <= node->subtree_last)
+                    continue;
+            }
+        }
+
+        return NULL; /* No match */
+    }
+}
+
+struct it_node *it_iter_first(struct rb_root *root, int start, int last)
+{
+    struct it_node *node;
+
+    if (!root->rb_node)
+        return NULL;
+
+    node = it_entry(root->rb_node);
+    if (node->subtree_last < start)
+        return NULL;
+
+    return it_subtree_search(node, start, last);
+}
+
+struct it_node *it_iter_next(struct it_node *node, int start, int last)
+{
+    struct rb_node *rb = node->rb.rb_right, *prev;
+
+    while (true) {
+        /* Loop invariants:
+         *   Cond1: node->start <= last
+         *   rb == node->rb.rb_right
+         *
+         * First, search right subtree if suitable
+         */
+        if (rb) {
+            struct it_node *right = it_entry(rb);
+            if (start <= right->subtree_last)
+                return it_subtree_search(right, start, last);
+        }
+
+        /* Move up the tree until we come from a node's left child */
+        do {
+            rb = rb_parent(&node->rb);
+            if (!rb)
+                return NULL;
+            prev = &node->rb;
+            node = it_entry(rb);
+            rb = node->rb.rb_right;
+        } while (prev == rb);
+
+        /* Check if the node intersects [start, last] */
+        if (last < node->start) /* !Cond1 */
+            return NULL;
+        else if (start <= node->last) /* Cond2 */
+            return node;
+    }
+}
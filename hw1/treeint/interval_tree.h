@@ -0,0 +1,32 @@
+#ifndef INTERVAL_TREE_H
+#define INTERVAL_TREE_H
+
+#include <stdbool.h>
+#include "rbtree.h"
+
+/* Interval tree of closed intervals [start, last], after the one of Linux.
+ *
+ * A red-black tree ordered by start, and by last between equal starts, each
+ * node also keeping the largest last of its subtree. A walk for the intervals
+ * overlapping [start, last] skips every subtree ending before start, and stops
+ * at the first node starting after last, so it costs O(log n + k) for k
+ * results. The same interval may be inserted several times.
+ */
+struct it_node {
+    struct rb_node rb;
+    int start, last;
+    int subtree_last;
+};
+
+void it_insert(struct it_node *node, struct rb_root *root);
+void it_remove(struct it_node *node, struct rb_root *root);
+/* The node of exactly [start, last], if any */
+struct it_node *it_find(struct rb_root *root, int start, int last);
+
+/* The first interval overlapping [start, last] in the tree order, and the one
+ * after node. Stabbing queries are the case start == last.
+ */
+struct it_node *it_iter_first(struct rb_root *root, int start, int last);
+struct it_node *it_iter_next(struct it_node *node, int start, int last);
+
+#endif
@@ -10,12 +10,46 @@
 */
 
 #include "rbtree.h"
+#include <pthread.h>
 #include <stdbool.h>
 #include "common.h"
+#include "eytzinger.h"
+#include "rbtree_augmented.h"
 
 #define RB_RED 0
 #define RB_BLACK 1
 
+/* Subtrees smaller than this are not worth a thread of their own */
+#define RB_BUILD_SPLIT (1 << 14)
+
+/*
+ * All stores to the tree structure (rb_left and rb_right) must be done using
+ * rb_publish(). And we must not inadvertently cause (temporary) loops in the
+ * tree structure as seen in program order.
+ *
+ * These two requirements will allow lockless iteration of the tree -- not
+ * correct iteration mind you, tree rotations are not atomic so a lookup might
+ * miss entire subtrees.
+ *
+ * But they do guarantee that any such traversal will only see valid elements
+ * and that it will indeed complete -- does not get stuck in a loop.
+ *
+ * It also guarantees that if the lookup returns an element it is the 'correct'
+ * one. But not returning an element does _NOT_ mean it's not present.
+ *
+ * NOTE:
+ *
+ * Stores to __rb_parent_color are not important for simple lookups so those
+ * are left undone as of now. Nor did I check for loops involving parent
+ * pointers.
+ *
+ * Unlike the kernel, which gets away with WRITE_ONCE() and address
+ * dependencies, rb_publish() is a release store: a reader that loads a link
+ * with acquire semantics then also sees the node behind it, and every link
+ * and counter update the writer made before.
+ */
+#define rb_publish(x, val) __atomic_store_n(&(x), (val), __ATOMIC_RELEASE)
+
 #define __rb_parent(pc) ((struct rb_node *) (pc & ~3))
 
 #define __rb_color(pc) ((pc) &1)
@@ -25,8 +59,6 @@
 #define rb_is_red(rb) __rb_is_red((rb)->__rb_parent_color)
 #define rb_is_black(rb) __rb_is_black((rb)->__rb_parent_color)
 
-#define rb_parent(r) ((struct rb_node *) ((r)->__rb_parent_color & ~3))
-
 static inline void rb_set_parent(struct rb_node *rb, struct rb_node *p)
 {
     rb->__rb_parent_color = rb_color(rb) + (unsigned long) p;
@@ -56,11 +88,11 @@ static inline void __rb_change_child(struct rb_node *old,
 {
     if (parent) {
         if (parent->rb_left == old)
-            parent->rb_left = new;
+            rb_publish(parent->rb_left, new);
         else
-            parent->rb_right = new;
+            rb_publish(parent->rb_right, new);
     } else
-        root->rb_node = new;
+        rb_publish(root->rb_node, new);
 }
 
 static inline void __rb_rotate_set_parents(struct rb_node *old,
@@ -146,8 +178,8 @@ static void __rb_insert(struct rb_node *node,
                  * continuation into Case 3 will fix that.
                  */
                 tmp = node->rb_left;
-                parent->rb_right = tmp;
-                node->rb_left = parent;
+                rb_publish(parent->rb_right, tmp);
+                rb_publish(node->rb_left, parent);
                 if (tmp)
                     rb_set_parent_color(tmp, parent, RB_BLACK);
                 rb_set_parent_color(parent, node, RB_RED);
@@ -166,8 +198,8 @@ static void __rb_insert(struct rb_node *node,
              *     /                 \
              *    n                   U
              */
-            gparent->rb_left = tmp; /* == parent->rb_right */
-            parent->rb_right = gparent;
+            rb_publish(gparent->rb_left, tmp); /* == parent->rb_right */
+            rb_publish(parent->rb_right, gparent);
             if (tmp)
                 rb_set_parent_color(tmp, gparent, RB_BLACK);
             __rb_rotate_set_parents(gparent, parent, root, RB_RED);
@@ -189,8 +221,8 @@ static void __rb_insert(struct rb_node *node,
             if (node == tmp) {
                 /* Case 2 - right rotate at parent */
                 tmp = node->rb_right;
-                parent->rb_left = tmp;
-                node->rb_right = parent;
+                rb_publish(parent->rb_left, tmp);
+                rb_publish(node->rb_right, parent);
                 if (tmp)
                     rb_set_parent_color(tmp, parent, RB_BLACK);
                 rb_set_parent_color(parent, node, RB_RED);
@@ -200,8 +232,8 @@ static void __rb_insert(struct rb_node *node,
             }
 
             /* Case 3 - left rotate at gparent */
-            gparent->rb_right = tmp; /* == parent->rb_left */
-            parent->rb_left = gparent;
+            rb_publish(gparent->rb_right, tmp); /* == parent->rb_left */
+            rb_publish(parent->rb_left, gparent);
             if (tmp)
                 rb_set_parent_color(tmp, gparent, RB_BLACK);
             __rb_rotate_set_parents(gparent, parent, root, RB_RED);
@@ -225,12 +257,6 @@ static inline void dummy_rotate(__unused struct rb_node *old,
 {
 }
 
-struct rb_augment_callbacks {
-    void (*propagate)(struct rb_node *node, struct rb_node *stop);
-    void (*copy)(struct rb_node *old, struct rb_node *new);
-    void (*rotate)(struct rb_node *old, struct rb_node *new);
-};
-
 static const struct rb_augment_callbacks dummy_callbacks = {
     .propagate = dummy_propagate,
     .copy = dummy_copy,
@@ -314,8 +340,8 @@ static struct rb_node *__rb_erase_augmented(
                 tmp = tmp->rb_left;
             } while (tmp);
             child2 = successor->rb_right;
-            parent->rb_left = child2;
-            successor->rb_right = child;
+            rb_publish(parent->rb_left, child2);
+            rb_publish(successor->rb_right, child);
             rb_set_parent(child, successor);
 
             augment->copy(node, successor);
@@ -323,7 +349,7 @@ static struct rb_node *__rb_erase_augmented(
         }
 
         tmp = node->rb_left;
-        successor->rb_left = tmp;
+        rb_publish(successor->rb_left, tmp);
         rb_set_parent(tmp, successor);
 
         pc = node->__rb_parent_color;
@@ -372,8 +398,8 @@ static void ____rb_erase_color(struct rb_node *parent,
                  *     Sl  Sr      N   Sl
                  */
                 tmp1 = sibling->rb_left;
-                parent->rb_right = tmp1;
-                sibling->rb_left = parent;
+                rb_publish(parent->rb_right, tmp1);
+                rb_publish(sibling->rb_left, parent);
                 rb_set_parent_color(tmp1, parent, RB_BLACK);
                 __rb_rotate_set_parents(parent, sibling, root, RB_RED);
                 augment_rotate(parent, sibling);
@@ -437,9 +463,9 @@ static void ____rb_erase_color(struct rb_node *parent,
                  *          Sr
                  */
                 tmp1 = tmp2->rb_right;
-                sibling->rb_left = tmp1;
-                tmp2->rb_right = sibling;
-                parent->rb_right = tmp2;
+                rb_publish(sibling->rb_left, tmp1);
+                rb_publish(tmp2->rb_right, sibling);
+                rb_publish(parent->rb_right, tmp2);
                 if (tmp1)
                     rb_set_parent_color(tmp1, sibling, RB_BLACK);
                 augment_rotate(sibling, tmp2);
@@ -459,8 +485,8 @@ static void ____rb_erase_color(struct rb_node *parent,
              *      (sl) sr      N  (sl)
              */
             tmp2 = sibling->rb_left;
-            parent->rb_right = tmp2;
-            sibling->rb_left = parent;
+            rb_publish(parent->rb_right, tmp2);
+            rb_publish(sibling->rb_left, parent);
             rb_set_parent_color(tmp1, sibling, RB_BLACK);
             if (tmp2)
                 rb_set_parent(tmp2, parent);
@@ -472,8 +498,8 @@ static void ____rb_erase_color(struct rb_node *parent,
             if (rb_is_red(sibling)) {
                 /* Case 1 - right rotate at parent */
                 tmp1 = sibling->rb_right;
-                parent->rb_left = tmp1;
-                sibling->rb_right = parent;
+                rb_publish(parent->rb_left, tmp1);
+                rb_publish(sibling->rb_right, parent);
                 rb_set_parent_color(tmp1, parent, RB_BLACK);
                 __rb_rotate_set_parents(parent, sibling, root, RB_RED);
                 augment_rotate(parent, sibling);
@@ -497,9 +523,9 @@ static void ____rb_erase_color(struct rb_node *parent,
                 }
                 /* Case 3 - left rotate at sibling */
                 tmp1 = tmp2->rb_left;
-                sibling->rb_right = tmp1;
-                tmp2->rb_left = sibling;
-                parent->rb_left = tmp2;
+                rb_publish(sibling->rb_right, tmp1);
+                rb_publish(tmp2->rb_left, sibling);
+                rb_publish(parent->rb_left, tmp2);
                 if (tmp1)
                     rb_set_parent_color(tmp1, sibling, RB_BLACK);
                 augment_rotate(sibling, tmp2);
@@ -508,8 +534,8 @@ static void ____rb_erase_color(struct rb_node *parent,
             }
             /* Case 4 - right rotate at parent + color flips */
             tmp2 = sibling->rb_right;
-            parent->rb_left = tmp2;
-            sibling->rb_right = parent;
+            rb_publish(parent->rb_left, tmp2);
+            rb_publish(sibling->rb_right, parent);
             rb_set_parent_color(tmp1, sibling, RB_BLACK);
             if (tmp2)
                 rb_set_parent(tmp2, parent);
@@ -527,3 +553,728 @@ void rb_erase(struct rb_node *node, struct rb_root *root)
     if (rebalance)
         ____rb_erase_color(rebalance, root, dummy_rotate);
 }
+
+/*
+ * Augmented rbtree manipulation functions.
+ *
+ * This instantiates the same code as the plain ones above, with the callbacks
+ * called through pointers rather than inlined.
+ */
+
+void __rb_insert_augmented(struct rb_node *node,
+                           struct rb_root *root,
+                           void (*augment_rotate)(struct rb_node *old,
+                                                  struct rb_node *new))
+{
+    __rb_insert(node, root, augment_rotate);
+}
+
+void rb_erase_augmented(struct rb_node *node,
+                        struct rb_root *root,
+                        const struct rb_augment_callbacks *augment)
+{
+    struct rb_node *rebalance = __rb_erase_augmented(node, root, augment);
+    if (rebalance)
+        ____rb_erase_color(rebalance, root, augment->rotate);
+}
+
+/*
+ * This function returns the first node (in sort order) of the tree.
+ */
+struct rb_node *rb_first(const struct rb_root *root)
+{
+    struct rb_node *n;
+
+    n = root->rb_node;
+    if (!n)
+        return NULL;
+    while (n->rb_left)
+        n = n->rb_left;
+    return n;
+}
+
+struct rb_node *rb_last(const struct rb_root *root)
+{
+    struct rb_node *n;
+
+    n = root->rb_node;
+    if (!n)
+        return NULL;
+    while (n->rb_right)
+        n = n->rb_right;
+    return n;
+}
+
+struct rb_node *rb_next(const struct rb_node *node)
+{
+    struct rb_node *parent;
+
+    /*
+     * If we have a right-hand child, go down and then left as far
+     * as we can.
+     */
+    if (node->rb_right) {
+        node = node->rb_right;
+        while (node->rb_left)
+            node = node->rb_left;
+        return (struct rb_node *) node;
+    }
+
+    /*
+     * No right-hand children. Everything down and left is smaller than us,
+     * so any 'next' node must be in the general direction of our parent.
+     * Go up the tree; any time the ancestor is a right-hand child of its
+     * parent, keep going up. First time it's a left-hand child of its
+     * parent, said parent is our 'next' node.
+     */
+    while ((parent = rb_parent(node)) && node == parent->rb_right)
+        node = parent;
+
+    return parent;
+}
+
+struct rb_node *rb_prev(const struct rb_node *node)
+{
+    struct rb_node *parent;
+
+    /*
+     * If we have a left-hand child, go down and then right as far
+     * as we can.
+     */
+    if (node->rb_left) {
+        node = node->rb_left;
+        while (node->rb_right)
+            node = node->rb_right;
+        return (struct rb_node *) node;
+    }
+
+    /*
+     * No left-hand children. Go up till we find an ancestor which
+     * is a right-hand child of its parent.
+     */
+    while ((parent = rb_parent(node)) && node == parent->rb_left)
+        node = parent;
+
+    return parent;
+}
+
+static size_t rb_count(const struct rb_root *root)
+{
+    size_t nr = 0;
+
+    for (struct rb_node *n = rb_first(root); n; n = rb_next(n))
+        nr++;
+
+    return nr;
+}
+
+struct rb_freeze_ctx {
+    char *base;
+    size_t size, nr, k;
+    void (*fill)(void *slot, struct rb_node *n);
+};
+
+static void __rb_freeze(const struct rb_root *root, struct rb_freeze_ctx *ctx)
+{
+    for (struct rb_node *n = rb_first(root); n; n = rb_next(n)) {
+        ctx->fill(ctx->base + ctx->k * ctx->size, n);
+        ctx->k = ez_next(ctx->k, ctx->nr);
+    }
+}
+
+void *rb_freeze(struct rb_root *root,
+                size_t size,
+                void (*fill)(void *slot, struct rb_node *n),
+                size_t *nr)
+{
+    struct rb_freeze_ctx ctx = {
+        .size = size,
+        .nr = rb_count(root),
+        .fill = fill,
+    };
+
+    ctx.base = ez_alloc(ctx.nr, size);
+    if (!ctx.base)
+        return NULL;
+
+    ctx.k = ez_first(ctx.nr);
+    __rb_freeze(root, &ctx);
+
+    *nr = ctx.nr;
+    return ctx.base;
+}
+
+struct rb_build_ctx {
+    rb_node_at_t *node_at;
+    void *arg;
+    int red_depth;
+};
+
+struct rb_build_job {
+    const struct rb_build_ctx *ctx;
+    size_t lo, hi;
+    struct rb_node *parent;
+    int depth, spawn;
+    struct rb_node *root;
+};
+
+static struct rb_node *__rb_build(const struct rb_build_ctx *ctx,
+                                  size_t lo,
+                                  size_t hi,
+                                  struct rb_node *parent,
+                                  int depth,
+                                  int spawn);
+
+static void *rb_build_worker(void *arg)
+{
+    struct rb_build_job *job = arg;
+
+    job->root = __rb_build(job->ctx, job->lo, job->hi, job->parent,
+                           job->depth, job->spawn);
+    return NULL;
+}
+
+/* Splitting at the median fills every level of the tree but the deepest one.
+ * Colouring exactly the nodes of that deepest level red gives every path the
+ * same number of black nodes, and a red node never has a red parent.
+ */
+static struct rb_node *__rb_build(const struct rb_build_ctx *ctx,
+                                  size_t lo,
+                                  size_t hi,
+                                  struct rb_node *parent,
+                                  int depth,
+                                  int spawn)
+{
+    if (lo >= hi)
+        return NULL;
+
+    size_t mid = lo + (hi - lo) / 2;
+    struct rb_node *n = ctx->node_at(mid, ctx->arg);
+    rb_set_parent_color(n, parent,
+                        depth == ctx->red_depth ? RB_RED : RB_BLACK);
+
+    pthread_t worker;
+    struct rb_build_job job = {
+        .ctx = ctx,
+        .lo = lo,
+        .hi = mid,
+        .parent = n,
+        .depth = depth + 1,
+        .spawn = spawn - 1,
+    };
+
+    if (spawn > 0 && hi - lo >= RB_BUILD_SPLIT &&
+        !pthread_create(&worker, NULL, rb_build_worker, &job)) {
+        n->rb_right = __rb_build(ctx, mid + 1, hi, n, depth + 1, spawn - 1);
+        pthread_join(worker, NULL);
+        n->rb_left = job.root;
+    } else {
+        n->rb_left = __rb_build(ctx, lo, mid, n, depth + 1, spawn - 1);
+        n->rb_right = __rb_build(ctx, mid + 1, hi, n, depth + 1, spawn - 1);
+    }
+
+    return n;
+}
+
+void rb_build_sorted_parallel(struct rb_root *root,
+                              size_t nr,
+                              rb_node_at_t *node_at,
+                              void *arg,
+                              int nr_threads)
+{
+    struct rb_build_ctx ctx = {
+        .node_at = node_at,
+        .arg = arg,
+        /* the root must stay black, even when it is alone */
+        .red_depth = nr > 1 ? 63 - __builtin_clzl(nr) : -1,
+    };
+    int spawn = 0;
+
+    while ((1 << spawn) < nr_threads)
+        spawn++;
+
+    root->rb_node = __rb_build(&ctx, 0, nr, NULL, 0, spawn);
+}
+
+void rb_build_sorted(struct rb_root *root,
+                     size_t nr,
+                     rb_node_at_t *node_at,
+                     void *arg)
+{
+    rb_build_sorted_parallel(root, nr, node_at, arg, 1);
+}
+
+/*
+ * Join-based set operations, after "Just Join for Parallel Ordered Sets"
+ * (Blelloch, Ferizovic and Sun).
+ *
+ * join(l, m, r) links two trees whose keys are on either side of m through m,
+ * walking down the spine of the higher tree to the level of black height of
+ * the lower one, and fixing a red violation on the way back up as an
+ * insertion would. It costs O(|bh(l) - bh(r)|). Everything else is built on
+ * it, recursively: split() descends to the key and joins the pieces back on
+ * the way up, and a set operation splits one tree by the root of the other,
+ * handles both halves independently, on a thread of their own near the top,
+ * and joins the results.
+ *
+ * The intermediate trees are detached subtrees whose root may be red, so they
+ * travel with their black height, counting the root. The root of a tree is
+ * only made black again when it is stored back into a struct rb_root.
+ */
+
+/* Subtrees of a lower black height are not worth a thread of their own */
+#define RB_SET_SPLIT_BH 10
+
+struct rb_sub {
+    struct rb_node *root;
+    int bh;
+};
+
+static inline bool rb_node_is_red(const struct rb_node *n)
+{
+    return n && rb_is_red(n);
+}
+
+static inline void rb_set_color(struct rb_node *rb, int color)
+{
+    rb->__rb_parent_color = (rb->__rb_parent_color & ~1UL) | color;
+}
+
+static inline void rb_set_children(struct rb_node *n,
+                                   struct rb_node *l,
+                                   struct rb_node *r)
+{
+    rb_publish(n->rb_left, l);
+    rb_publish(n->rb_right, r);
+    if (l)
+        rb_set_parent(l, n);
+    if (r)
+        rb_set_parent(r, n);
+}
+
+static inline struct rb_sub rb_sub_child(struct rb_sub t, struct rb_node *c)
+{
+    return (struct rb_sub){c, t.bh - rb_is_black(t.root)};
+}
+
+static struct rb_sub rb_sub_of(struct rb_root *root)
+{
+    struct rb_sub t = {root->rb_node, 0};
+
+    for (struct rb_node *n = t.root; n; n = n->rb_left)
+        t.bh += rb_is_black(n);
+
+    return t;
+}
+
+static void rb_set_root(struct rb_root *root, struct rb_sub t)
+{
+    if (t.root)
+        rb_set_parent_color(t.root, NULL, RB_BLACK);
+    root->rb_node = t.root;
+}
+
+/* bh(l) > bh(r), or equal with a red l: link m on the right spine of l */
+static struct rb_node *rb_join_right(struct rb_node *l,
+                                     int lh,
+                                     struct rb_node *m,
+                                     struct rb_node *r,
+                                     int rh)
+{
+    if (!rb_node_is_red(l) && lh == rh) {
+        rb_set_color(m, RB_RED);
+        rb_set_children(m, l, r);
+        return m;
+    }
+
+    struct rb_node *c =
+        rb_join_right(l->rb_right, lh - rb_is_black(l), m, r, rh);
+    rb_set_children(l, l->rb_left, c);
+
+    if (rb_is_black(l) && rb_is_red(c) && rb_node_is_red(c->rb_right)) {
+        /* two reds in a row on the spine: rotate c up, over a black l */
+        rb_set_color(c->rb_right, RB_BLACK);
+        rb_set_children(l, l->rb_left, c->rb_left);
+        rb_set_children(c, l, c->rb_right);
+        return c;
+    }
+
+    return l;
+}
+
+static struct rb_node *rb_join_left(struct rb_node *l,
+                                    int lh,
+                                    struct rb_node *m,
+                                    struct rb_node *r,
+                                    int rh)
+{
+    if (!rb_node_is_red(r) && lh == rh) {
+        rb_set_color(m, RB_RED);
+        rb_set_children(m, l, r);
+        return m;
+    }
+
+    struct rb_node *c = rb_join_left(l, lh, m, r->rb_left, rh - rb_is_black(r));
+    rb_set_children(r, c, r->rb_right);
+
+    if (rb_is_black(r) && rb_is_red(c) && rb_node_is_red(c->rb_left)) {
+        rb_set_color(c->rb_left, RB_BLACK);
+        rb_set_children(r, c->rb_right, r->rb_right);
+        rb_set_children(c, c->rb_left, r);
+        return c;
+    }
+
+    return r;
+}
+
+static struct rb_sub rb_join_sub(struct rb_sub l,
+                                 struct rb_node *m,
+                                 struct rb_sub r)
+{
+    struct rb_sub t;
+
+    if (l.bh > r.bh) {
+        t = (struct rb_sub){rb_join_right(l.root, l.bh, m, r.root, r.bh),
+                            l.bh};
+        if (rb_is_red(t.root) && rb_node_is_red(t.root->rb_right)) {
+            rb_set_color(t.root, RB_BLACK);
+            t.bh++;
+        }
+    } else if (r.bh > l.bh) {
+        t = (struct rb_sub){rb_join_left(l.root, l.bh, m, r.root, r.bh),
+                            r.bh};
+        if (rb_is_red(t.root) && rb_node_is_red(t.root->rb_left)) {
+            rb_set_color(t.root, RB_BLACK);
+            t.bh++;
+        }
+    } else {
+        bool red = !rb_node_is_red(l.root) && !rb_node_is_red(r.root);
+
+        rb_set_color(m, red ? RB_RED : RB_BLACK);
+        rb_set_children(m, l.root, r.root);
+        t = (struct rb_sub){m, l.bh + !red};
+    }
+
+    return t;
+}
+
+/* Split t into the keys below key, returned in *l, and above it in *r. Return
+ * the node holding key, if any, detached from both.
+ */
+static struct rb_node *rb_split_sub(struct rb_sub t,
+                                    const struct rb_node *key,
+                                    rb_cmp_t *cmp,
+                                    struct rb_sub *l,
+                                    struct rb_sub *r)
+{
+    struct rb_node *n = t.root, *found;
+    struct rb_sub m;
+
+    if (!n) {
+        *l = *r = t;
+        return NULL;
+    }
+
+    struct rb_sub tl = rb_sub_child(t, n->rb_left);
+    struct rb_sub tr = rb_sub_child(t, n->rb_right);
+    int c = cmp(key, n);
+
+    if (c == 0) {
+        *l = tl;
+        *r = tr;
+        return n;
+    }
+
+    if (c < 0) {
+        found = rb_split_sub(tl, key, cmp, l, &m);
+        *r = rb_join_sub(m, n, tr);
+    } else {
+        found = rb_split_sub(tr, key, cmp, &m, r);
+        *l = rb_join_sub(tl, n, m);
+    }
+
+    return found;
+}
+
+/* Detach the last node of a non-empty t, the rest being left in *rest */
+static struct rb_node *rb_split_last(struct rb_sub t, struct rb_sub *rest)
+{
+    struct rb_node *n = t.root, *last;
+    struct rb_sub tl = rb_sub_child(t, n->rb_left);
+    struct rb_sub tr = rb_sub_child(t, n->rb_right), m;
+
+    if (!tr.root) {
+        *rest = tl;
+        return n;
+    }
+
+    last = rb_split_last(tr, &m);
+    *rest = rb_join_sub(tl, n, m);
+    return last;
+}
+
+/* Join without a middle node, by taking the last one of l */
+static struct rb_sub rb_join2_sub(struct rb_sub l, struct rb_sub r)
+{
+    struct rb_sub rest;
+
+    if (!l.root)
+        return r;
+
+    struct rb_node *m = rb_split_last(l, &rest);
+    return rb_join_sub(rest, m, r);
+}
+
+void rb_join(struct rb_root *root, struct rb_node *node, struct rb_root *right)
+{
+    rb_set_root(root, rb_join_sub(rb_sub_of(root), node, rb_sub_of(right)));
+    right->rb_node = NULL;
+}
+
+struct rb_node *rb_split(struct rb_root *root,
+                         const struct rb_node *key,
+                         rb_cmp_t *cmp,
+                         struct rb_root *right)
+{
+    struct rb_sub l, r;
+    struct rb_node *found = rb_split_sub(rb_sub_of(root), key, cmp, &l, &r);
+
+    rb_set_root(root, l);
+    rb_set_root(right, r);
+    return found;
+}
+
+struct rb_free_job {
+    struct rb_node *root;
+    rb_free_t *free_fn;
+    int spawn;
+    size_t nr;
+};
+
+static size_t __rb_free_parallel(struct rb_node *n,
+                                 rb_free_t *free_fn,
+                                 int spawn);
+
+static void *rb_free_worker(void *arg)
+{
+    struct rb_free_job *job = arg;
+
+    job->nr = __rb_free_parallel(job->root, job->free_fn, job->spawn);
+    return NULL;
+}
+
+/* Free a detached subtree and return its size, see __treeint_rb_destroy() */
+static size_t __rb_free_parallel(struct rb_node *n,
+                                 rb_free_t *free_fn,
+                                 int spawn)
+{
+    pthread_t worker;
+    size_t nr = 0;
+
+    if (spawn > 0 && n && n->rb_left && n->rb_right) {
+        struct rb_free_job job = {
+            .root = n->rb_left,
+            .free_fn = free_fn,
+            .spawn = spawn - 1,
+        };
+
+        if (!pthread_create(&worker, NULL, rb_free_worker, &job)) {
+            nr = __rb_free_parallel(n->rb_right, free_fn, spawn - 1);
+            pthread_join(worker, NULL);
+            free_fn(n);
+            return nr + job.nr + 1;
+        }
+    }
+
+    while (n) {
+        struct rb_node *l = n->rb_left;
+
+        if (l) {
+            n->rb_left = l->rb_right;
+            l->rb_right = n;
+            n = l;
+        } else {
+            struct rb_node *r = n->rb_right;
+            free_fn(n);
+            nr++;
+            n = r;
+        }
+    }
+
+    return nr;
+}
+
+enum rb_set_op {
+    RB_UNION,
+    RB_INTERSECTION,
+    RB_DIFFERENCE,
+};
+
+struct rb_set_ctx {
+    rb_cmp_t *cmp;
+    rb_free_t *free_fn;
+    enum rb_set_op op;
+};
+
+struct rb_set_job {
+    const struct rb_set_ctx *ctx;
+    struct rb_sub a, b;
+    int spawn;
+    struct rb_sub res;
+};
+
+static struct rb_sub __rb_set_op(const struct rb_set_ctx *ctx,
+                                 struct rb_sub a,
+                                 struct rb_sub b,
+                                 int spawn);
+
+static void *rb_set_worker(void *arg)
+{
+    struct rb_set_job *job = arg;
+
+    job->res = __rb_set_op(job->ctx, job->a, job->b, job->spawn);
+    return NULL;
+}
+
+/* Split a by the root k of b, recurse on both sides and join the results
+ * through the node of k that is kept, if any: the one of a when both have it.
+ */
+static struct rb_sub __rb_set_op(const struct rb_set_ctx *ctx,
+                                 struct rb_sub a,
+                                 struct rb_sub b,
+                                 int spawn)
+{
+    static const struct rb_sub empty;
+
+    if (!a.root || !b.root) {
+        switch (ctx->op) {
+        case RB_UNION:
+            return a.root ? a : b;
+        case RB_INTERSECTION:
+            __rb_free_parallel(a.root ? a.root : b.root, ctx->free_fn, 0);
+            return empty;
+        default:
+            __rb_free_parallel(b.root, ctx->free_fn, 0);
+            return a;
+        }
+    }
+
+    struct rb_node *k = b.root, *dup;
+    struct rb_sub ar, l, r;
+    struct rb_set_job job = {
+        .ctx = ctx,
+        .b = rb_sub_child(b, k->rb_left),
+        .spawn = spawn - 1,
+    };
+    struct rb_sub br = rb_sub_child(b, k->rb_right);
+    pthread_t worker;
+
+    dup = rb_split_sub(a, k, ctx->cmp, &job.a, &ar);
+
+    if (spawn > 0 && b.bh >= RB_SET_SPLIT_BH &&
+        !pthread_create(&worker, NULL, rb_set_worker, &job)) {
+        r = __rb_set_op(ctx, ar, br, spawn - 1);
+        pthread_join(worker, NULL);
+        l = job.res;
+    } else {
+        l = __rb_set_op(ctx, job.a, job.b, spawn - 1);
+        r = __rb_set_op(ctx, ar, br, spawn - 1);
+    }
+
+    switch (ctx->op) {
+    case RB_UNION:
+        if (dup) {
+            ctx->free_fn(k);
+            k = dup;
+        }
+        return rb_join_sub(l, k, r);
+    case RB_INTERSECTION:
+        ctx->free_fn(k);
+        return dup ? rb_join_sub(l, dup, r) : rb_join2_sub(l, r);
+    default:
+        ctx->free_fn(k);
+        if (dup)
+            ctx->free_fn(dup);
+        return rb_join2_sub(l, r);
+    }
+}
+
+static void rb_set_op(struct rb_root *root,
+                      struct rb_root *other,
+                      rb_cmp_t *cmp,
+                      rb_free_t *free_fn,
+                      enum rb_set_op op,
+                      int nr_threads)
+{
+    struct rb_set_ctx ctx = {.cmp = cmp, .free_fn = free_fn, .op = op};
+    int spawn = 0;
+
+    while ((1 << spawn) < nr_threads)
+        spawn++;
+
+    rb_set_root(root,
+                __rb_set_op(&ctx, rb_sub_of(root), rb_sub_of(other), spawn));
+    other->rb_node = NULL;
+}
+
+void rb_union(struct rb_root *root,
+              struct rb_root *other,
+              rb_cmp_t *cmp,
+              rb_free_t *free_fn,
+              int nr_threads)
+{
+    rb_set_op(root, other, cmp, free_fn, RB_UNION, nr_threads);
+}
+
+void rb_intersection(struct rb_root *root,
+                     struct rb_root *other,
+                     rb_cmp_t *cmp,
+                     rb_free_t *free_fn,
+                     int nr_threads)
+{
+    rb_set_op(root, other, cmp, free_fn, RB_INTERSECTION, nr_threads);
+}
+
+void rb_difference(struct rb_root *root,
+                   struct rb_root *other,
+                   rb_cmp_t *cmp,
+                   rb_free_t *free_fn,
+                   int nr_threads)
+{
+    rb_set_op(root, other, cmp, free_fn, RB_DIFFERENCE, nr_threads);
+}
+
+size_t rb_range_delete(struct rb_root *root,
+                       const struct rb_node *lo,
+                       const struct rb_node *hi,
+                       rb_cmp_t *cmp,
+                       rb_free_t *free_fn,
+                       int nr_threads)
+{
+    struct rb_sub l, m, r;
+    struct rb_node *first, *last;
+    size_t nr = 0;
+    int spawn = 0;
+
+    if (cmp(lo, hi) > 0)
+        return 0;
+
+    while ((1 << spawn) < nr_threads)
+        spawn++;
+
+    first = rb_split_sub(rb_sub_of(root), lo, cmp, &l, &m);
+    last = rb_split_sub(m, hi, cmp, &m, &r);
+
+    if (first) {
+        free_fn(first);
+        nr++;
+    }
+    if (last && last != first) {
+        free_fn(last);
+        nr++;
+    }
+    nr += __rb_free_parallel(m.root, free_fn, spawn);
+
+    rb_set_root(root, rb_join2_sub(l, r));
+    return nr;
+}
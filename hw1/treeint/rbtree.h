@@ -11,6 +11,7 @@
 #ifndef RBTREE_H
 #define RBTREE_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 #define rb_root(r) (r->rb_node)
@@ -34,6 +35,30 @@ struct rb_root {
         NULL,        \
     }
 
+/*
+ * Leftmost-cached rbtrees.
+ *
+ * We do not cache the rightmost node based on footprint
+ * size vs number of potential users that could benefit
+ * from O(1) rb_last(). Just not worth it, users that want
+ * this feature can always implement the logic explicitly.
+ * Furthermore, users that want to cache both pointers may
+ * find it a bit asymmetric, but that's ok.
+ */
+struct rb_root_cached {
+    struct rb_root rb_root;
+    struct rb_node *rb_leftmost;
+};
+
+#define RB_ROOT_CACHED      \
+    (struct rb_root_cached) \
+    {                       \
+        {NULL}, NULL        \
+    }
+
+/* Same as rb_first(), but O(1) */
+#define rb_first_cached(root) (root)->rb_leftmost
+
 static inline void rb_link_node(struct rb_node *node,
                                 struct rb_node *parent,
                                 struct rb_node **rb_link)
@@ -44,7 +69,118 @@ static inline void rb_link_node(struct rb_node *node,
     *rb_link = node;
 }
 
+/* Same as rb_link_node(), but the node is published with release semantics so
+ * that lockless readers never see it uninitialized.
+ */
+static inline void rb_link_node_rcu(struct rb_node *node,
+                                    struct rb_node *parent,
+                                    struct rb_node **rb_link)
+{
+    node->__rb_parent_color = (unsigned long) parent;
+    node->rb_left = node->rb_right = NULL;
+
+    __atomic_store_n(rb_link, node, __ATOMIC_RELEASE);
+}
+
 void rb_insert_color(struct rb_node *, struct rb_root *);
 void rb_erase(struct rb_node *, struct rb_root *);
 
+/* Find logical next and previous nodes in a tree */
+struct rb_node *rb_next(const struct rb_node *);
+struct rb_node *rb_prev(const struct rb_node *);
+struct rb_node *rb_first(const struct rb_root *);
+struct rb_node *rb_last(const struct rb_root *);
+
+/* leftmost tells whether the descent to node only went left */
+static inline void rb_insert_color_cached(struct rb_node *node,
+                                          struct rb_root_cached *root,
+                                          bool leftmost)
+{
+    if (leftmost)
+        root->rb_leftmost = node;
+    rb_insert_color(node, &root->rb_root);
+}
+
+/* Return the new leftmost node if node was the leftmost one, NULL otherwise */
+static inline struct rb_node *rb_erase_cached(struct rb_node *node,
+                                              struct rb_root_cached *root)
+{
+    struct rb_node *leftmost = NULL;
+
+    if (root->rb_leftmost == node)
+        leftmost = root->rb_leftmost = rb_next(node);
+
+    rb_erase(node, &root->rb_root);
+
+    return leftmost;
+}
+
+/* Build the tree from nr nodes in linear time, see st_build_sorted(). The tree
+ * must be empty, and node_at(i, arg) returns the node of the i-th smallest key,
+ * typically allocating it. The parallel variant calls node_at() for disjoint
+ * ranges of i from up to nr_threads threads.
+ */
+typedef struct rb_node *rb_node_at_t(size_t i, void *arg);
+void rb_build_sorted(struct rb_root *root,
+                     size_t nr,
+                     rb_node_at_t *node_at,
+                     void *arg);
+void rb_build_sorted_parallel(struct rb_root *root,
+                              size_t nr,
+                              rb_node_at_t *node_at,
+                              void *arg,
+                              int nr_threads);
+
+/* Join and split, in O(log n), and the set operations built on them in
+ * O(m log(n / m + 1)) for sizes m <= n. cmp(a, b) orders two nodes like
+ * strcmp(), and the key of a split may be a node of any tree or a dummy one.
+ */
+typedef int rb_cmp_t(const struct rb_node *a, const struct rb_node *b);
+typedef void rb_free_t(struct rb_node *n);
+
+/* Append node then the tree right to root, all their keys must be in order.
+ * right is left empty.
+ */
+void rb_join(struct rb_root *root, struct rb_node *node, struct rb_root *right);
+/* Move the keys above key to the empty tree right, and return the node of key
+ * itself, taken out of the tree, if there is one.
+ */
+struct rb_node *rb_split(struct rb_root *root,
+                         const struct rb_node *key,
+                         rb_cmp_t *cmp,
+                         struct rb_root *right);
+
+/* root = root op other, on up to nr_threads threads. other is left empty, the
+ * nodes that do not make it to root are released with free_fn(), and where
+ * both trees hold a key, the node of root is the one kept.
+ */
+void rb_union(struct rb_root *root,
+              struct rb_root *other,
+              rb_cmp_t *cmp,
+              rb_free_t *free_fn,
+              int nr_threads);
+void rb_intersection(struct rb_root *root,
+                     struct rb_root *other,
+                     rb_cmp_t *cmp,
+                     rb_free_t *free_fn,
+                     int nr_threads);
+void rb_difference(struct rb_root *root,
+                   struct rb_root *other,
+                   rb_cmp_t *cmp,
+                   rb_free_t *free_fn,
+                   int nr_threads);
+/* Release the nodes in [lo, hi] and return how many there were */
+size_t rb_range_delete(struct rb_root *root,
+                       const struct rb_node *lo,
+                       const struct rb_node *hi,
+                       rb_cmp_t *cmp,
+                       rb_free_t *free_fn,
+                       int nr_threads);
+
+/* Take a read-only snapshot of the tree in Eytzinger layout, see st_freeze() */
+void *rb_freeze(struct rb_root *root,
+                size_t size,
+                void (*fill)(void *slot, struct rb_node *n),
+                size_t *nr);
+
 #endif
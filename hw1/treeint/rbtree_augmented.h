@@ -0,0 +1,112 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+  Red Black Trees
+  (C) 1999  Andrea Arcangeli <andrea@suse.de>
+  (C) 2002  David Woodhouse <dwmw2@infradead.org>
+  (C) 2012  Michel Lespinasse <walken@google.com>
+
+
+  linux/include/linux/rbtree_augmented.h
+*/
+
+#ifndef RBTREE_AUGMENTED_H
+#define RBTREE_AUGMENTED_H
+
+#include <stdbool.h>
+#include "common.h"
+#include "rbtree.h"
+
+/*
+ * Please note - only struct rb_augment_callbacks and the prototypes for
+ * rb_insert_augmented() and rb_erase_augmented() are intended to be public.
+ * The rest are implementation details you are not expected to depend on.
+ *
+ * An augmented tree keeps in every node a value computed from its subtree,
+ * e.g. its size. The caller updates the values on the path down to a new node
+ * before rb_insert_augmented(), the callbacks take care of the rest. The join
+ * and split functions of rbtree.h do not maintain augmented values.
+ */
+
+struct rb_augment_callbacks {
+    void (*propagate)(struct rb_node *node, struct rb_node *stop);
+    void (*copy)(struct rb_node *old, struct rb_node *new);
+    void (*rotate)(struct rb_node *old, struct rb_node *new);
+};
+
+#define rb_parent(r) ((struct rb_node *) ((r)->__rb_parent_color & ~3))
+
+void __rb_insert_augmented(struct rb_node *node,
+                           struct rb_root *root,
+                           void (*augment_rotate)(struct rb_node *old,
+                                                  struct rb_node *new));
+
+/*
+ * Fixup the rbtree and update the augmented information when rebalancing.
+ *
+ * On insertion, the user must update the augmented information on the path
+ * leading to the inserted node, then call rb_link_node() as usual and
+ * rb_insert_augmented() instead of the usual rb_insert_color() call.
+ * If rb_insert_augmented() rebalances the rbtree, it will callback into
+ * a user provided function to update the augmented information on the
+ * affected subtrees.
+ */
+static inline void rb_insert_augmented(
+    struct rb_node *node,
+    struct rb_root *root,
+    const struct rb_augment_callbacks *augment)
+{
+    __rb_insert_augmented(node, root, augment->rotate);
+}
+
+void rb_erase_augmented(struct rb_node *node,
+                        struct rb_root *root,
+                        const struct rb_augment_callbacks *augment);
+
+/*
+ * Template for declaring augmented rbtree callbacks (generic case)
+ *
+ * RBSTATIC:    'static' or empty
+ * RBNAME:      name of the rb_augment_callbacks structure
+ * RBSTRUCT:    struct type of the tree nodes
+ * RBFIELD:     name of struct rb_node field within RBSTRUCT
+ * RBAUGMENTED: name of field within RBSTRUCT holding data for subtree
+ * RBCOMPUTE:   name of function that recomputes the RBAUGMENTED data
+ *
+ * RBCOMPUTE(node, exit) updates the augmented value of node from its children,
+ * and returns true if exit is true and the value did not change, which ends
+ * the propagation early.
+ */
+#define RB_DECLARE_CALLBACKS(RBSTATIC, RBNAME, RBSTRUCT, RBFIELD, RBAUGMENTED, \
+                             RBCOMPUTE)                                        \
+    static inline void RBNAME##_propagate(struct rb_node *rb,                  \
+                                          struct rb_node *stop)                \
+    {                                                                          \
+        while (rb != stop) {                                                   \
+            RBSTRUCT *node = container_of(rb, RBSTRUCT, RBFIELD);              \
+            if (RBCOMPUTE(node, true))                                         \
+                break;                                                         \
+            rb = rb_parent(&node->RBFIELD);                                    \
+        }                                                                      \
+    }                                                                          \
+    static inline void RBNAME##_copy(struct rb_node *rb_old,                   \
+                                     struct rb_node *rb_new)                   \
+    {                                                                          \
+        RBSTRUCT *old = container_of(rb_old, RBSTRUCT, RBFIELD);               \
+        RBSTRUCT *new = container_of(rb_new, RBSTRUCT, RBFIELD);               \
+        new->RBAUGMENTED = old->RBAUGMENTED;                                   \
+    }                                                                          \
+    static void RBNAME##_rotate(struct rb_node *rb_old,                        \
+                                struct rb_node *rb_new)                        \
+    {                                                                          \
+        RBSTRUCT *old = container_of(rb_old, RBSTRUCT, RBFIELD);               \
+        RBSTRUCT *new = container_of(rb_new, RBSTRUCT, RBFIELD);               \
+        new->RBAUGMENTED = old->RBAUGMENTED;                                   \
+        RBCOMPUTE(old, false);                                                 \
+    }                                                                          \
+    RBSTATIC const struct rb_augment_callbacks RBNAME = {                      \
+        .propagate = RBNAME##_propagate,                                       \
+        .copy = RBNAME##_copy,                                                 \
+        .rotate = RBNAME##_rotate,                                             \
+    };
+
+#endif
@@ -0,0 +1,461 @@
+/*
+ * Compact red-black tree: the insertion and erasure of rbtree.c on 32-bit
+ * indices, without the augmentation hooks. The case analysis follows the
+ * Linux implementation step by step, see the diagrams in rbtree.c.
+ *
+ * The helpers below expect the node array of the tree in a local 'nodes'.
+ * It is stable for the whole operation since only ia_alloc() moves it.
+ */
+#include "rbtree_compact.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include "common.h"
+
+/* Tag of the image files of the tree, see ia_save() */
+#define RBC_IMAGE_TAG 0x31434252 /* "RBC1" */
+
+#define RBC_RED 0
+#define RBC_BLACK 1
+
+#define rbc_left(n) (nodes[n].left)
+#define rbc_right(n) (nodes[n].right)
+#define rbc_pc(n) (nodes[n].parent_meta)
+#define rbc_parent(n) ia_parent(rbc_pc(n))
+#define rbc_is_black(n) (rbc_pc(n) & RBC_BLACK)
+#define rbc_is_red(n) (!rbc_is_black(n))
+#define rbc_set_parent(n, p) ia_set_parent(&nodes[n], p)
+#define rbc_set_parent_color(n, p, color) (rbc_pc(n) = ia_pack(p, color))
+#define rbc_set_black(n) (rbc_pc(n) |= RBC_BLACK)
+
+struct rbc_tree *rbc_create(void)
+{
+    struct rbc_tree *tree = calloc(sizeof(struct rbc_tree), 1);
+    if (!tree)
+        return NULL;
+
+    ia_init(&tree->arena);
+    tree->root = IA_NIL;
+    return tree;
+}
+
+void rbc_destroy(struct rbc_tree *tree)
+{
+    ia_release(&tree->arena);
+    free(tree);
+}
+
+int rbc_save(struct rbc_tree *tree, const char *path)
+{
+    return ia_save(&tree->arena, tree->root, RBC_IMAGE_TAG, path);
+}
+
+struct rbc_tree *rbc_load(const char *path)
+{
+    struct rbc_tree *tree = calloc(sizeof(struct rbc_tree), 1);
+    if (!tree)
+        return NULL;
+
+    ia_init(&tree->arena);
+    if (ia_map(&tree->arena, &tree->root, RBC_IMAGE_TAG, path)) {
+        free(tree);
+        return NULL;
+    }
+    return tree;
+}
+
+static inline void rbc_change_child(struct rbc_tree *tree,
+                                    uint32_t old,
+                                    uint32_t new,
+                                    uint32_t parent)
+{
+    struct ia_node *nodes = tree->arena.nodes;
+
+    if (parent) {
+        if (rbc_left(parent) == old)
+            rbc_left(parent) = new;
+        else
+            rbc_right(parent) = new;
+    } else
+        tree->root = new;
+}
+
+static inline void rbc_rotate_set_parents(struct rbc_tree *tree,
+                                          uint32_t old,
+                                          uint32_t new,
+                                          int color)
+{
+    struct ia_node *nodes = tree->arena.nodes;
+    uint32_t parent = rbc_parent(old);
+
+    rbc_pc(new) = rbc_pc(old);
+    rbc_set_parent_color(old, new, color);
+    rbc_change_child(tree, old, new, parent);
+}
+
+static void rbc_insert_color(struct rbc_tree *tree, uint32_t node)
+{
+    struct ia_node *nodes = tree->arena.nodes;
+    uint32_t parent = rbc_parent(node), gparent, tmp;
+
+    while (true) {
+        /* Loop invariant: node is red */
+        if (unlikely(!parent)) {
+            rbc_set_parent_color(node, IA_NIL, RBC_BLACK);
+            break;
+        }
+
+        if (rbc_is_black(parent))
+            break;
+
+        gparent = rbc_parent(parent);
+
+        tmp = rbc_right(gparent);
+        if (parent != tmp) { /* parent == gparent->left */
+            if (tmp && rbc_is_red(tmp)) {
+                /* Case 1 - color flips */
+                rbc_set_parent_color(tmp, gparent, RBC_BLACK);
+                rbc_set_parent_color(parent, gparent, RBC_BLACK);
+                node = gparent;
+                parent = rbc_parent(node);
+                rbc_set_parent_color(node, parent, RBC_RED);
+                continue;
+            }
+
+            tmp = rbc_right(parent);
+            if (node == tmp) {
+                /* Case 2 - left rotate at parent */
+                tmp = rbc_left(node);
+                rbc_right(parent) = tmp;
+                rbc_left(node) = parent;
+                if (tmp)
+                    rbc_set_parent_color(tmp, parent, RBC_BLACK);
+                rbc_set_parent_color(parent, node, RBC_RED);
+                parent = node;
+                tmp = rbc_right(node);
+            }
+
+            /* Case 3 - right rotate at gparent */
+            rbc_left(gparent) = tmp; /* == parent->right */
+            rbc_right(parent) = gparent;
+            if (tmp)
+                rbc_set_parent_color(tmp, gparent, RBC_BLACK);
+            rbc_rotate_set_parents(tree, gparent, parent, RBC_RED);
+            break;
+        } else {
+            tmp = rbc_left(gparent);
+            if (tmp && rbc_is_red(tmp)) {
+                /* Case 1 - color flips */
+                rbc_set_parent_color(tmp, gparent, RBC_BLACK);
+                rbc_set_parent_color(parent, gparent, RBC_BLACK);
+                node = gparent;
+                parent = rbc_parent(node);
+                rbc_set_parent_color(node, parent, RBC_RED);
+                continue;
+            }
+
+            tmp = rbc_left(parent);
+            if (node == tmp) {
+                /* Case 2 - right rotate at parent */
+                tmp = rbc_right(node);
+                rbc_left(parent) = tmp;
+                rbc_right(node) = parent;
+                if (tmp)
+                    rbc_set_parent_color(tmp, parent, RBC_BLACK);
+                rbc_set_parent_color(parent, node, RBC_RED);
+                parent = node;
+                tmp = rbc_left(node);
+            }
+
+            /* Case 3 - left rotate at gparent */
+            rbc_right(gparent) = tmp; /* == parent->left */
+            rbc_left(parent) = gparent;
+            if (tmp)
+                rbc_set_parent_color(tmp, gparent, RBC_BLACK);
+            rbc_rotate_set_parents(tree, gparent, parent, RBC_RED);
+            break;
+        }
+    }
+}
+
+int rbc_insert(struct rbc_tree *tree, int key)
+{
+    struct ia_node *nodes = tree->arena.nodes;
+    uint32_t p = IA_NIL;
+    bool left = false;
+
+    for (uint32_t n = tree->root; n;) {
+        if (nodes[n].key == key)
+            return -1;
+
+        p = n;
+        left = nodes[n].key > key;
+        n = left ? rbc_left(n) : rbc_right(n);
+    }
+
+    ia_cow(&tree->arena);
+    uint32_t n = ia_alloc(&tree->arena);
+    if (!n)
+        return -1;
+
+    nodes = tree->arena.nodes;
+    nodes[n].key = key;
+    rbc_set_parent_color(n, p, RBC_RED);
+
+    if (!p)
+        tree->root = n;
+    else if (left)
+        rbc_left(p) = n;
+    else
+        rbc_right(p) = n;
+
+    rbc_insert_color(tree, n);
+    return 0;
+}
+
+/* Unlink node as __rb_erase_augmented() does, and return the parent to
+ * rebalance from, IA_NIL if the colours could be fixed locally.
+ */
+static uint32_t __rbc_erase(struct rbc_tree *tree, uint32_t node)
+{
+    struct ia_node *nodes = tree->arena.nodes;
+    uint32_t child = rbc_right(node), tmp = rbc_left(node);
+    uint32_t parent, rebalance, pc;
+
+    if (!tmp) {
+        /* Case 1: node to erase has no more than 1 child */
+        pc = rbc_pc(node);
+        parent = ia_parent(pc);
+        rbc_change_child(tree, node, child, parent);
+        if (child) {
+            rbc_pc(child) = pc;
+            rebalance = IA_NIL;
+        } else
+            rebalance = (pc & RBC_BLACK) ? parent : IA_NIL;
+    } else if (!child) {
+        /* Still case 1, but this time the child is node->left */
+        rbc_pc(tmp) = pc = rbc_pc(node);
+        parent = ia_parent(pc);
+        rbc_change_child(tree, node, tmp, parent);
+        rebalance = IA_NIL;
+    } else {
+        uint32_t successor = child, child2;
+
+        tmp = rbc_left(child);
+        if (!tmp) {
+            /* Case 2: node's successor is its right child */
+            parent = successor;
+            child2 = rbc_right(successor);
+        } else {
+            /* Case 3: node's successor is leftmost under node's right
+             * child subtree
+             */
+            do {
+                parent = successor;
+                successor = tmp;
+                tmp = rbc_left(tmp);
+            } while (tmp);
+            child2 = rbc_right(successor);
+            rbc_left(parent) = child2;
+            rbc_right(successor) = child;
+            rbc_set_parent(child, successor);
+        }
+
+        tmp = rbc_left(node);
+        rbc_left(successor) = tmp;
+        rbc_set_parent(tmp, successor);
+
+        pc = rbc_pc(node);
+        rbc_change_child(tree, node, successor, ia_parent(pc));
+
+        if (child2) {
+            rbc_set_parent_color(child2, parent, RBC_BLACK);
+            rebalance = IA_NIL;
+        } else {
+            rebalance = rbc_is_black(successor) ? parent : IA_NIL;
+        }
+        rbc_pc(successor) = pc;
+    }
+
+    return rebalance;
+}
+
+static void rbc_erase_color(struct rbc_tree *tree, uint32_t parent)
+{
+    struct ia_node *nodes = tree->arena.nodes;
+    uint32_t node = IA_NIL, sibling, tmp1, tmp2;
+
+    while (true) {
+        /* Loop invariants:
+         * - node is black (or IA_NIL on first iteration)
+         * - node is not the root (parent is not IA_NIL)
+         * - All leaf paths going through parent and node have a black node
+         *   count that is 1 lower than other leaf paths.
+         */
+        sibling = rbc_right(parent);
+        if (node != sibling) { /* node == parent->left */
+            if (rbc_is_red(sibling)) {
+                /* Case 1 - left rotate at parent */
+                tmp1 = rbc_left(sibling);
+                rbc_right(parent) = tmp1;
+                rbc_left(sibling) = parent;
+                rbc_set_parent_color(tmp1, parent, RBC_BLACK);
+                rbc_rotate_set_parents(tree, parent, sibling, RBC_RED);
+                sibling = tmp1;
+            }
+            tmp1 = rbc_right(sibling);
+            if (!tmp1 || rbc_is_black(tmp1)) {
+                tmp2 = rbc_left(sibling);
+                if (!tmp2 || rbc_is_black(tmp2)) {
+                    /* Case 2 - sibling color flip */
+                    rbc_set_parent_color(sibling, parent, RBC_RED);
+                    if (rbc_is_red(parent))
+                        rbc_set_black(parent);
+                    else {
+                        node = parent;
+                        parent = rbc_parent(node);
+                        if (parent)
+                            continue;
+                    }
+                    break;
+                }
+                /* Case 3 - right rotate at sibling */
+                tmp1 = rbc_right(tmp2);
+                rbc_left(sibling) = tmp1;
+                rbc_right(tmp2) = sibling;
+                rbc_right(parent) = tmp2;
+                if (tmp1)
+                    rbc_set_parent_color(tmp1, sibling, RBC_BLACK);
+                tmp1 = sibling;
+                sibling = tmp2;
+            }
+            /* Case 4 - left rotate at parent + color flips */
+            tmp2 = rbc_left(sibling);
+            rbc_right(parent) = tmp2;
+            rbc_left(sibling) = parent;
+            rbc_set_parent_color(tmp1, sibling, RBC_BLACK);
+            if (tmp2)
+                rbc_set_parent(tmp2, parent);
+            rbc_rotate_set_parents(tree, parent, sibling, RBC_BLACK);
+            break;
+        } else {
+            sibling = rbc_left(parent);
+            if (rbc_is_red(sibling)) {
+                /* Case 1 - right rotate at parent */
+                tmp1 = rbc_right(sibling);
+                rbc_left(parent) = tmp1;
+                rbc_right(sibling) = parent;
+                rbc_set_parent_color(tmp1, parent, RBC_BLACK);
+                rbc_rotate_set_parents(tree, parent, sibling, RBC_RED);
+                sibling = tmp1;
+            }
+            tmp1 = rbc_left(sibling);
+            if (!tmp1 || rbc_is_black(tmp1)) {
+                tmp2 = rbc_right(sibling);
+                if (!tmp2 || rbc_is_black(tmp2)) {
+                    /* Case 2 - sibling color flip */
+                    rbc_set_parent_color(sibling, parent, RBC_RED);
+                    if (rbc_is_red(parent))
+                        rbc_set_black(parent);
+                    else {
+                        node = parent;
+                        parent = rbc_parent(node);
+                        if (parent)
+                            continue;
+                    }
+                    break;
+                }
+                /* Case 3 - left rotate at sibling */
+                tmp1 = rbc_left(tmp2);
+                rbc_right(sibling) = tmp1;
+                rbc_left(tmp2) = sibling;
+                rbc_left(parent) = tmp2;
+                if (tmp1)
+                    rbc_set_parent_color(tmp1, sibling, RBC_BLACK);
+                tmp1 = sibling;
+                sibling = tmp2;
+            }
+            /* Case 4 - right rotate at parent + color flips */
+            tmp2 = rbc_right(sibling);
+            rbc_left(parent) = tmp2;
+            rbc_right(sibling) = parent;
+            rbc_set_parent_color(tmp1, sibling, RBC_BLACK);
+            if (tmp2)
+                rbc_set_parent(tmp2, parent);
+            rbc_rotate_set_parents(tree, parent, sibling, RBC_BLACK);
+            break;
+        }
+    }
+}
+
+static uint32_t __rbc_find(struct rbc_tree *tree, int key)
+{
+    struct ia_node *nodes = tree->arena.nodes;
+
+    for (uint32_t n = tree->root; n;) {
+        if (nodes[n].key == key)
+            return n;
+
+        n = nodes[n].key > key ? rbc_left(n) : rbc_right(n);
+    }
+
+    return IA_NIL;
+}
+
+struct ia_node *rbc_find(struct rbc_tree *tree, int key)
+{
+    uint32_t n = __rbc_find(tree, key);
+    return n ? &tree->arena.nodes[n] : NULL;
+}
+
+int rbc_remove(struct rbc_tree *tree, int key)
+{
+    uint32_t n = __rbc_find(tree, key);
+    if (!n)
+        return -1;
+
+    ia_cow(&tree->arena);
+    uint32_t rebalance = __rbc_erase(tree, n);
+    if (rebalance)
+        rbc_erase_color(tree, rebalance);
+
+    ia_free(&tree->arena, n);
+    return 0;
+}
+
+uint32_t rbc_lower_bound(struct rbc_tree *tree, int key)
+{
+    struct ia_node *nodes = tree->arena.nodes;
+    uint32_t lb = IA_NIL;
+
+    for (uint32_t n = tree->root; n;) {
+        if (nodes[n].key == key)
+            return n;
+
+        if (nodes[n].key > key) {
+            lb = n;
+            n = rbc_left(n);
+        } else {
+            n = rbc_right(n);
+        }
+    }
+
+    return lb;
+}
+
+uint32_t rbc_next(struct rbc_tree *tree, uint32_t n)
+{
+    struct ia_node *nodes = tree->arena.nodes;
+
+    if (rbc_right(n)) {
+        n = rbc_right(n);
+        while (rbc_left(n))
+            n = rbc_left(n);
+        return n;
+    }
+
+    uint32_t p;
+    while ((p = rbc_parent(n)) && n == rbc_right(p))
+        n = p;
+
+    return p;
+}
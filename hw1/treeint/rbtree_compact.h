@@ -0,0 +1,35 @@
+#ifndef RBTREE_COMPACT_H
+#define RBTREE_COMPACT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+
+/* Compact red-black tree of int keys: the rebalancing of rbtree.c on the
+ * 16-byte nodes of an index arena (see arena.h). The colour takes the lowest
+ * of the IA_META_BITS of the parent word, the way rbtree.c hides it in the
+ * alignment bits of the parent pointer.
+ */
+struct rbc_tree {
+    struct ia_arena arena;
+    uint32_t root;
+};
+
+struct rbc_tree *rbc_create(void);
+void rbc_destroy(struct rbc_tree *tree);
+int rbc_insert(struct rbc_tree *tree, int key);
+int rbc_remove(struct rbc_tree *tree, int key);
+/* The returned node stays valid until the next insertion */
+struct ia_node *rbc_find(struct rbc_tree *tree, int key);
+
+/* Write the tree to an image file, and map one back as a new tree that is
+ * queried in place, without a rebuild, and copied on write (see ia_map())
+ */
+int rbc_save(struct rbc_tree *tree, const char *path);
+struct rbc_tree *rbc_load(const char *path);
+
+/* In-order traversal by index, IA_NIL past the end */
+uint32_t rbc_lower_bound(struct rbc_tree *tree, int key);
+uint32_t rbc_next(struct rbc_tree *tree, uint32_t n);
+
+#endif
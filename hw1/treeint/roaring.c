@@ -0,0 +1,860 @@
+/*
+ * Roaring bitmap of int keys.
+ *
+ * The keys are taken with the sign bit flipped, which makes their unsigned
+ * order the one of the keys, the high 16 bits picking the container and the
+ * low 16 bits being what the container stores.
+ *
+ * An array container that would go past RR_ARRAY_MAX keys becomes a bitmap, or
+ * a list of runs if that is smaller. A bitmap only goes back to an array once
+ * it has lost half of those keys, not to switch back and forth around the
+ * boundary, and a list of runs becomes a bitmap when it gets larger than one.
+ * The results of set operations are laid out in whichever of the three takes
+ * the least room.
+ */
+#include "roaring.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RR_X86_SIMD
+#endif
+
+/* Runs past which a list of runs takes more room than a bitmap */
+#define RR_RUN_MAX (RR_BITMAP_WORDS * 8 / sizeof(struct rr_run))
+
+enum rr_op {
+    RR_UNION,
+    RR_INTERSECTION,
+    RR_DIFFERENCE,
+};
+
+static inline uint32_t rr_bits(int key)
+{
+    return (uint32_t) key ^ 0x80000000u;
+}
+
+static inline int rr_key(uint16_t high, uint16_t low)
+{
+    return (int) ((((uint32_t) high << 16) | low) ^ 0x80000000u);
+}
+
+/* Index of the first of the nr sorted values of a not less than x */
+static inline uint32_t rr_lower_bound(const uint16_t *a,
+                                      uint32_t nr,
+                                      uint16_t x)
+{
+    uint32_t lo = 0, hi = nr;
+
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (a[mid] < x)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Index of the last run starting at or before x, -1 if none */
+static inline int rr_run_find(const struct rr_container *c, uint16_t x)
+{
+    int lo = 0, hi = c->nr;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (c->runs[mid].start <= x)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo - 1;
+}
+
+#define rr_run_end(r) ((uint32_t) (r).start + (r).len)
+
+/* Make room for nr entries of size bytes in an array or list of runs */
+static void rr_reserve(struct rr_container *c, uint32_t nr, size_t size)
+{
+    if (nr <= c->cap)
+        return;
+
+    uint32_t cap = c->cap ? c->cap : 4;
+    while (cap < nr)
+        cap *= 2;
+
+    c->data = realloc(c->data, cap * size);
+    assert(c->data);
+    c->cap = cap;
+}
+
+static uint64_t *rr_bitmap_alloc(void)
+{
+    uint64_t *bitmap = aligned_alloc(64, RR_BITMAP_WORDS * sizeof(uint64_t));
+    assert(bitmap);
+    memset(bitmap, 0, RR_BITMAP_WORDS * sizeof(uint64_t));
+    return bitmap;
+}
+
+static inline bool rr_bitmap_test(const uint64_t *bitmap, uint16_t x)
+{
+    return bitmap[x / 64] >> (x % 64) & 1;
+}
+
+/* Set the bits start to end included */
+static void rr_bitmap_set_range(uint64_t *bitmap, uint32_t start, uint32_t end)
+{
+    uint32_t first = start / 64, last = end / 64;
+    uint64_t head = ~0ULL << (start % 64), tail = ~0ULL >> (63 - end % 64);
+
+    if (first == last) {
+        bitmap[first] |= head & tail;
+        return;
+    }
+
+    bitmap[first] |= head;
+    for (uint32_t i = first + 1; i < last; i++)
+        bitmap[i] = ~0ULL;
+    bitmap[last] |= tail;
+}
+
+/* Clear the bits start to end included */
+static void rr_bitmap_clear_range(uint64_t *bitmap,
+                                  uint32_t start,
+                                  uint32_t end)
+{
+    uint32_t first = start / 64, last = end / 64;
+    uint64_t head = ~0ULL << (start % 64), tail = ~0ULL >> (63 - end % 64);
+
+    if (first == last) {
+        bitmap[first] &= ~(head & tail);
+        return;
+    }
+
+    bitmap[first] &= ~head;
+    for (uint32_t i = first + 1; i < last; i++)
+        bitmap[i] = 0;
+    bitmap[last] &= ~tail;
+}
+
+static uint32_t rr_bitmap_card(const uint64_t *bitmap)
+{
+    uint32_t card = 0;
+
+    for (int i = 0; i < RR_BITMAP_WORDS; i++)
+        card += __builtin_popcountll(bitmap[i]);
+    return card;
+}
+
+/* Number of runs of consecutive keys in a container */
+static uint32_t rr_nr_runs(const struct rr_container *c)
+{
+    uint32_t nr = 0;
+
+    switch (c->type) {
+    case RR_ARRAY:
+        for (uint32_t i = 0; i < c->nr; i++)
+            nr += !i || c->array[i] != c->array[i - 1] + 1;
+        break;
+    case RR_BITMAP: {
+        /* Count the set bits whose lower neighbour is clear */
+        uint64_t carry = 0;
+        for (int i = 0; i < RR_BITMAP_WORDS; i++) {
+            uint64_t w = c->bitmap[i];
+            nr += __builtin_popcountll(w & ~(w << 1 | carry));
+            carry = w >> 63;
+        }
+        break;
+    }
+    case RR_RUN:
+        nr = c->nr;
+        break;
+    }
+    return nr;
+}
+
+static void rr_to_bitmap(struct rr_container *c)
+{
+    if (c->type == RR_BITMAP)
+        return;
+
+    uint64_t *bitmap = rr_bitmap_alloc();
+
+    if (c->type == RR_ARRAY) {
+        for (uint32_t i = 0; i < c->nr; i++)
+            bitmap[c->array[i] / 64] |= 1ULL << (c->array[i] % 64);
+    } else {
+        for (uint32_t i = 0; i < c->nr; i++)
+            rr_bitmap_set_range(bitmap, c->runs[i].start,
+                                rr_run_end(c->runs[i]));
+    }
+
+    free(c->data);
+    c->bitmap = bitmap;
+    c->type = RR_BITMAP;
+    c->nr = c->cap = 0;
+}
+
+static void rr_to_array(struct rr_container *c)
+{
+    if (c->type == RR_ARRAY)
+        return;
+
+    uint16_t *array = malloc(c->card * sizeof(uint16_t));
+    uint32_t nr = 0;
+    assert(array || !c->card);
+
+    if (c->type == RR_BITMAP) {
+        for (int i = 0; i < RR_BITMAP_WORDS; i++) {
+            for (uint64_t w = c->bitmap[i]; w; w &= w - 1)
+                array[nr++] = i * 64 + __builtin_ctzll(w);
+        }
+    } else {
+        for (uint32_t i = 0; i < c->nr; i++) {
+            for (uint32_t x = c->runs[i].start; x <= rr_run_end(c->runs[i]);
+                 x++)
+                array[nr++] = x;
+        }
+    }
+
+    free(c->data);
+    c->array = array;
+    c->type = RR_ARRAY;
+    c->nr = c->cap = nr;
+}
+
+/* Extend the last of the nr runs with x if x follows it, else start a run */
+static inline void rr_runs_push(struct rr_run *runs, uint32_t *nr, uint16_t x)
+{
+    if (*nr && rr_run_end(runs[*nr - 1]) + 1 == x)
+        runs[*nr - 1].len++;
+    else
+        runs[(*nr)++] = (struct rr_run){x, 0};
+}
+
+static void rr_to_runs(struct rr_container *c, uint32_t nr_runs)
+{
+    if (c->type == RR_RUN)
+        return;
+
+    struct rr_run *runs = malloc(nr_runs * sizeof(struct rr_run));
+    uint32_t nr = 0;
+    assert(runs);
+
+    if (c->type == RR_ARRAY) {
+        for (uint32_t i = 0; i < c->nr; i++)
+            rr_runs_push(runs, &nr, c->array[i]);
+    } else {
+        for (int i = 0; i < RR_BITMAP_WORDS; i++) {
+            for (uint64_t w = c->bitmap[i]; w; w &= w - 1)
+                rr_runs_push(runs, &nr, i * 64 + __builtin_ctzll(w));
+        }
+    }
+    assert(nr == nr_runs);
+
+    free(c->data);
+    c->runs = runs;
+    c->type = RR_RUN;
+    c->nr = c->cap = nr;
+}
+
+/* Switch to whichever layout takes the least room */
+static void rr_optimize(struct rr_container *c)
+{
+    uint32_t nr_runs = rr_nr_runs(c);
+    size_t array = c->card * sizeof(uint16_t);
+    size_t bitmap = RR_BITMAP_WORDS * sizeof(uint64_t);
+    size_t runs = nr_runs * sizeof(struct rr_run);
+
+    if (runs < array && runs < bitmap)
+        rr_to_runs(c, nr_runs);
+    else if (c->card <= RR_ARRAY_MAX)
+        rr_to_array(c);
+    else
+        rr_to_bitmap(c);
+}
+
+static bool rr_container_contains(const struct rr_container *c, uint16_t x)
+{
+    uint32_t i;
+    int r;
+
+    switch (c->type) {
+    case RR_ARRAY:
+        i = rr_lower_bound(c->array, c->nr, x);
+        return i < c->nr && c->array[i] == x;
+    case RR_BITMAP:
+        return rr_bitmap_test(c->bitmap, x);
+    default:
+        r = rr_run_find(c, x);
+        return r >= 0 && x <= rr_run_end(c->runs[r]);
+    }
+}
+
+static int rr_run_add(struct rr_container *c, uint16_t x)
+{
+    int r = rr_run_find(c, x);
+
+    if (r >= 0 && x <= rr_run_end(c->runs[r]))
+        return -1;
+
+    bool after = r >= 0 && rr_run_end(c->runs[r]) + 1 == x;
+    bool before = r + 1 < (int) c->nr && c->runs[r + 1].start == x + 1;
+
+    if (after && before) {
+        /* x fills the gap between two runs */
+        c->runs[r].len += c->runs[r + 1].len + 2;
+        memmove(c->runs + r + 1, c->runs + r + 2,
+                (c->nr - r - 2) * sizeof(struct rr_run));
+        c->nr--;
+    } else if (after) {
+        c->runs[r].len++;
+    } else if (before) {
+        c->runs[r + 1].start--;
+        c->runs[r + 1].len++;
+    } else {
+        rr_reserve(c, c->nr + 1, sizeof(struct rr_run));
+        memmove(c->runs + r + 2, c->runs + r + 1,
+                (c->nr - r - 1) * sizeof(struct rr_run));
+        c->runs[r + 1] = (struct rr_run){x, 0};
+        c->nr++;
+    }
+    return 0;
+}
+
+static int rr_run_remove(struct rr_container *c, uint16_t x)
+{
+    int r = rr_run_find(c, x);
+
+    if (r < 0 || x > rr_run_end(c->runs[r]))
+        return -1;
+
+    struct rr_run *run = &c->runs[r];
+    if (!run->len) {
+        memmove(run, run + 1, (c->nr - r - 1) * sizeof(struct rr_run));
+        c->nr--;
+    } else if (x == run->start) {
+        run->start++;
+        run->len--;
+    } else if (x == rr_run_end(*run)) {
+        run->len--;
+    } else {
+        /* Split the run around x */
+        rr_reserve(c, c->nr + 1, sizeof(struct rr_run));
+        run = &c->runs[r];
+        memmove(run + 2, run + 1, (c->nr - r - 1) * sizeof(struct rr_run));
+        run[1] = (struct rr_run){x + 1, rr_run_end(*run) - x - 1};
+        run->len = x - run->start - 1;
+        c->nr++;
+    }
+    return 0;
+}
+
+static int rr_container_add(struct rr_container *c, uint16_t x)
+{
+    uint32_t i;
+
+    switch (c->type) {
+    case RR_ARRAY:
+        i = rr_lower_bound(c->array, c->nr, x);
+        if (i < c->nr && c->array[i] == x)
+            return -1;
+        if (c->nr == RR_ARRAY_MAX) {
+            rr_to_bitmap(c);
+            c->bitmap[x / 64] |= 1ULL << (x % 64);
+            c->card++;
+            rr_optimize(c);
+            return 0;
+        }
+        rr_reserve(c, c->nr + 1, sizeof(uint16_t));
+        memmove(c->array + i + 1, c->array + i,
+                (c->nr - i) * sizeof(uint16_t));
+        c->array[i] = x;
+        c->nr++;
+        break;
+    case RR_BITMAP:
+        if (rr_bitmap_test(c->bitmap, x))
+            return -1;
+        c->bitmap[x / 64] |= 1ULL << (x % 64);
+        break;
+    case RR_RUN:
+        if (rr_run_add(c, x))
+            return -1;
+        if (c->nr > RR_RUN_MAX) {
+            c->card++;
+            rr_to_bitmap(c);
+            return 0;
+        }
+        break;
+    }
+
+    c->card++;
+    return 0;
+}
+
+static int rr_container_remove(struct rr_container *c, uint16_t x)
+{
+    uint32_t i;
+
+    switch (c->type) {
+    case RR_ARRAY:
+        i = rr_lower_bound(c->array, c->nr, x);
+        if (i == c->nr || c->array[i] != x)
+            return -1;
+        memmove(c->array + i, c->array + i + 1,
+                (c->nr - i - 1) * sizeof(uint16_t));
+        c->nr--;
+        c->card--;
+        break;
+    case RR_BITMAP:
+        if (!rr_bitmap_test(c->bitmap, x))
+            return -1;
+        c->bitmap[x / 64] &= ~(1ULL << (x % 64));
+        if (--c->card <= RR_ARRAY_MAX / 2)
+            rr_to_array(c);
+        break;
+    case RR_RUN:
+        if (rr_run_remove(c, x))
+            return -1;
+        c->card--;
+        if (c->nr > RR_RUN_MAX)
+            rr_to_bitmap(c);
+        break;
+    }
+    return 0;
+}
+
+struct roaring *roaring_create(void)
+{
+    return calloc(sizeof(struct roaring), 1);
+}
+
+static void rr_clear(struct roaring *r)
+{
+    for (size_t i = 0; i < r->nr; i++)
+        free(r->c[i].data);
+    free(r->keys);
+    free(r->c);
+    r->keys = NULL;
+    r->c = NULL;
+    r->nr = r->cap = 0;
+}
+
+void roaring_destroy(struct roaring *r)
+{
+    rr_clear(r);
+    free(r);
+}
+
+/* Index of the first container whose high bits are not less than high */
+static inline size_t rr_find(const struct roaring *r, uint16_t high)
+{
+    return rr_lower_bound(r->keys, r->nr, high);
+}
+
+int roaring_insert(struct roaring *r, int key)
+{
+    uint32_t u = rr_bits(key);
+    size_t i = rr_find(r, u >> 16);
+
+    if (i == r->nr || r->keys[i] != u >> 16) {
+        if (r->nr == r->cap) {
+            r->cap = r->cap ? r->cap * 2 : 4;
+            r->keys = realloc(r->keys, r->cap * sizeof(uint16_t));
+            r->c = realloc(r->c, r->cap * sizeof(struct rr_container));
+            assert(r->keys && r->c);
+        }
+        memmove(r->keys + i + 1, r->keys + i, (r->nr - i) * sizeof(uint16_t));
+        memmove(r->c + i + 1, r->c + i,
+                (r->nr - i) * sizeof(struct rr_container));
+        r->keys[i] = u >> 16;
+        r->c[i] = (struct rr_container){.type = RR_ARRAY};
+        r->nr++;
+    }
+
+    return rr_container_add(&r->c[i], u & 0xffff);
+}
+
+/* Drop the empty container i */
+static void rr_drop(struct roaring *r, size_t i)
+{
+    free(r->c[i].data);
+    memmove(r->keys + i, r->keys + i + 1, (r->nr - i - 1) * sizeof(uint16_t));
+    memmove(r->c + i, r->c + i + 1,
+            (r->nr - i - 1) * sizeof(struct rr_container));
+    r->nr--;
+}
+
+int roaring_remove(struct roaring *r, int key)
+{
+    uint32_t u = rr_bits(key);
+    size_t i = rr_find(r, u >> 16);
+
+    if (i == r->nr || r->keys[i] != u >> 16)
+        return -1;
+    if (rr_container_remove(&r->c[i], u & 0xffff))
+        return -1;
+
+    if (!r->c[i].card)
+        rr_drop(r, i);
+    return 0;
+}
+
+int roaring_contains(const struct roaring *r, int key)
+{
+    uint32_t u = rr_bits(key);
+    size_t i = rr_find(r, u >> 16);
+
+    return i < r->nr && r->keys[i] == u >> 16 &&
+           rr_container_contains(&r->c[i], u & 0xffff);
+}
+
+/* Visit the keys of c within [lo, hi] */
+static size_t rr_container_range(const struct rr_container *c,
+                                 uint16_t high,
+                                 uint32_t lo,
+                                 uint32_t hi,
+                                 void (*cb)(int key, void *arg),
+                                 void *arg)
+{
+    size_t nr = 0;
+
+    switch (c->type) {
+    case RR_ARRAY:
+        for (uint32_t i = rr_lower_bound(c->array, c->nr, lo);
+             i < c->nr && c->array[i] <= hi; i++, nr++)
+            cb(rr_key(high, c->array[i]), arg);
+        break;
+    case RR_BITMAP:
+        for (uint32_t i = lo / 64; i <= hi / 64; i++) {
+            uint64_t w = c->bitmap[i];
+            if (i == lo / 64)
+                w &= ~0ULL << (lo % 64);
+            if (i == hi / 64)
+                w &= ~0ULL >> (63 - hi % 64);
+            for (; w; w &= w - 1, nr++)
+                cb(rr_key(high, i * 64 + __builtin_ctzll(w)), arg);
+        }
+        break;
+    case RR_RUN: {
+        /* The first run may start before lo and still reach into the range */
+        int first = rr_run_find(c, lo);
+        for (int i = first < 0 ? 0 : first;
+             i < (int) c->nr && c->runs[i].start <= hi; i++) {
+            uint32_t start = c->runs[i].start, end = rr_run_end(c->runs[i]);
+            for (uint32_t x = start < lo ? lo : start; x <= end && x <= hi;
+                 x++, nr++)
+                cb(rr_key(high, x), arg);
+        }
+        break;
+    }
+    }
+    return nr;
+}
+
+size_t roaring_range(const struct roaring *r,
+                     int lo,
+                     int hi,
+                     void (*cb)(int key, void *arg),
+                     void *arg)
+{
+    uint32_t ulo = rr_bits(lo), uhi = rr_bits(hi);
+    size_t nr = 0;
+
+    if (lo > hi)
+        return 0;
+
+    for (size_t i = rr_find(r, ulo >> 16); i < r->nr && r->keys[i] <= uhi >> 16;
+         i++) {
+        uint32_t first = r->keys[i] == ulo >> 16 ? ulo & 0xffff : 0;
+        uint32_t last = r->keys[i] == uhi >> 16 ? uhi & 0xffff : 0xffff;
+        nr += rr_container_range(&r->c[i], r->keys[i], first, last, cb, arg);
+    }
+    return nr;
+}
+
+/* dst = dst op src over whole bitmaps, two words at a time with SSE2 */
+#ifdef RR_X86_SIMD
+static void rr_bitmap_op(uint64_t *dst, const uint64_t *src, enum rr_op op)
+{
+    __m128i *d = (__m128i *) dst;
+    const __m128i *s = (const __m128i *) src;
+
+    for (int i = 0; i < RR_BITMAP_WORDS / 2; i++) {
+        __m128i a = _mm_load_si128(d + i), b = _mm_load_si128(s + i);
+        if (op == RR_UNION)
+            a = _mm_or_si128(a, b);
+        else if (op == RR_INTERSECTION)
+            a = _mm_and_si128(a, b);
+        else
+            a = _mm_andnot_si128(b, a);
+        _mm_store_si128(d + i, a);
+    }
+}
+#else
+static void rr_bitmap_op(uint64_t *dst, const uint64_t *src, enum rr_op op)
+{
+    for (int i = 0; i < RR_BITMAP_WORDS; i++) {
+        if (op == RR_UNION)
+            dst[i] |= src[i];
+        else if (op == RR_INTERSECTION)
+            dst[i] &= src[i];
+        else
+            dst[i] &= ~src[i];
+    }
+}
+#endif
+
+/* Keep the keys of the array container a that are in b, or not in it */
+static void rr_array_filter(struct rr_container *a,
+                            const struct rr_container *b,
+                            bool keep)
+{
+    uint32_t nr = 0;
+
+    for (uint32_t i = 0; i < a->nr; i++) {
+        if (rr_container_contains(b, a->array[i]) == keep)
+            a->array[nr++] = a->array[i];
+    }
+    a->nr = a->card = nr;
+}
+
+/* Merge two array containers into a, which may need to become a bitmap */
+static void rr_array_merge(struct rr_container *a,
+                           const struct rr_container *b,
+                           enum rr_op op)
+{
+    uint16_t *out = malloc((a->nr + b->nr) * sizeof(uint16_t));
+    uint32_t i = 0, j = 0, nr = 0;
+    assert(out);
+
+    while (i < a->nr && j < b->nr) {
+        if (a->array[i] < b->array[j]) {
+            if (op != RR_INTERSECTION)
+                out[nr++] = a->array[i];
+            i++;
+        } else if (a->array[i] > b->array[j]) {
+            if (op == RR_UNION)
+                out[nr++] = b->array[j];
+            j++;
+        } else {
+            if (op != RR_DIFFERENCE)
+                out[nr++] = a->array[i];
+            i++;
+            j++;
+        }
+    }
+    for (; op != RR_INTERSECTION && i < a->nr; i++)
+        out[nr++] = a->array[i];
+    for (; op == RR_UNION && j < b->nr; j++)
+        out[nr++] = b->array[j];
+
+    free(a->array);
+    a->array = out;
+    a->nr = a->cap = a->card = nr;
+    if (nr > RR_ARRAY_MAX)
+        rr_to_bitmap(a);
+}
+
+/* a = a op b, b being consumed. The arrays are merged or filtered as such, any
+ * other pair goes through bitmaps.
+ */
+static void rr_container_op(struct rr_container *a,
+                            struct rr_container *b,
+                            enum rr_op op)
+{
+    if (a->type == RR_ARRAY && b->type == RR_ARRAY) {
+        rr_array_merge(a, b, op);
+    } else if (a->type == RR_ARRAY && op != RR_UNION) {
+        rr_array_filter(a, b, op == RR_INTERSECTION);
+    } else if (b->type == RR_ARRAY && op == RR_INTERSECTION) {
+        rr_array_filter(b, a, true);
+        struct rr_container tmp = *a;
+        *a = *b;
+        *b = tmp;
+    } else {
+        rr_to_bitmap(a);
+        rr_to_bitmap(b);
+        rr_bitmap_op(a->bitmap, b->bitmap, op);
+        a->card = rr_bitmap_card(a->bitmap);
+    }
+
+    free(b->data);
+    if (a->card)
+        rr_optimize(a);
+}
+
+static void rr_set_op(struct roaring *r, struct roaring *other, enum rr_op op)
+{
+    size_t cap = r->nr + (op == RR_UNION ? other->nr : 0);
+    uint16_t *keys = malloc((cap ? cap : 1) * sizeof(uint16_t));
+    struct rr_container *c = malloc((cap ? cap : 1) * sizeof(*c));
+    size_t i = 0, j = 0, nr = 0;
+    assert(keys && c);
+
+    while (i < r->nr || j < other->nr) {
+        if (j == other->nr || (i < r->nr && r->keys[i] < other->keys[j])) {
+            /* Only in r */
+            if (op == RR_INTERSECTION) {
+                free(r->c[i].data);
+            } else {
+                keys[nr] = r->keys[i];
+                c[nr++] = r->c[i];
+            }
+            i++;
+        } else if (i == r->nr || other->keys[j] < r->keys[i]) {
+            /* Only in other */
+            if (op == RR_UNION) {
+                keys[nr] = other->keys[j];
+                c[nr++] = other->c[j];
+            } else {
+                free(other->c[j].data);
+            }
+            j++;
+        } else {
+            rr_container_op(&r->c[i], &other->c[j], op);
+            if (r->c[i].card) {
+                keys[nr] = r->keys[i];
+                c[nr++] = r->c[i];
+            } else {
+                free(r->c[i].data);
+            }
+            i++;
+            j++;
+        }
+    }
+
+    /* The containers have all been moved or freed */
+    other->nr = r->nr = 0;
+    rr_clear(other);
+    rr_clear(r);
+    r->keys = keys;
+    r->c = c;
+    r->nr = nr;
+    r->cap = cap ? cap : 1;
+}
+
+void roaring_union(struct roaring *r, struct roaring *other)
+{
+    rr_set_op(r, other, RR_UNION);
+}
+
+void roaring_intersection(struct roaring *r, struct roaring *other)
+{
+    rr_set_op(r, other, RR_INTERSECTION);
+}
+
+void roaring_difference(struct roaring *r, struct roaring *other)
+{
+    rr_set_op(r, other, RR_DIFFERENCE);
+}
+
+/* Remove the keys in [lo, hi] from c */
+static void rr_container_remove_range(struct rr_container *c,
+                                      uint32_t lo,
+                                      uint32_t hi)
+{
+    uint32_t i, j, nr = 0;
+
+    switch (c->type) {
+    case RR_ARRAY:
+        i = rr_lower_bound(c->array, c->nr, lo);
+        j = hi == 0xffff ? c->nr : rr_lower_bound(c->array, c->nr, hi + 1);
+        memmove(c->array + i, c->array + j, (c->nr - j) * sizeof(uint16_t));
+        c->nr -= j - i;
+        c->card = c->nr;
+        return;
+    case RR_BITMAP:
+        rr_bitmap_clear_range(c->bitmap, lo, hi);
+        c->card = rr_bitmap_card(c->bitmap);
+        break;
+    case RR_RUN: {
+        /* Each run may leave a piece on either side of the range */
+        struct rr_run *runs = malloc((c->nr + 1) * sizeof(struct rr_run));
+        assert(runs);
+        c->card = 0;
+        for (i = 0; i < c->nr; i++) {
+            uint32_t start = c->runs[i].start, end = rr_run_end(c->runs[i]);
+            if (end < lo || start > hi) {
+                runs[nr++] = c->runs[i];
+                c->card += end - start + 1;
+                continue;
+            }
+            if (start < lo) {
+                runs[nr++] = (struct rr_run){start, lo - 1 - start};
+                c->card += lo - start;
+            }
+            if (end > hi) {
+                runs[nr++] = (struct rr_run){hi + 1, end - hi - 1};
+                c->card += end - hi;
+            }
+        }
+        free(c->runs);
+        c->runs = runs;
+        c->nr = nr;
+        c->cap = c->nr + 1;
+        break;
+    }
+    }
+
+    if (c->card)
+        rr_optimize(c);
+}
+
+size_t roaring_range_delete(struct roaring *r, int lo, int hi)
+{
+    uint32_t ulo = rr_bits(lo), uhi = rr_bits(hi);
+    size_t removed = 0, nr = 0;
+
+    if (lo > hi)
+        return 0;
+
+    /* Compact the containers left in place as the others are dropped */
+    for (size_t i = 0; i < r->nr; i++) {
+        uint16_t high = r->keys[i];
+        struct rr_container *c = &r->c[i];
+
+        if (high >= ulo >> 16 && high <= uhi >> 16) {
+            uint32_t first = high == ulo >> 16 ? ulo & 0xffff : 0;
+            uint32_t last = high == uhi >> 16 ? uhi & 0xffff : 0xffff;
+            uint32_t card = c->card;
+
+            if (first == 0 && last == 0xffff)
+                c->card = 0;
+            else
+                rr_container_remove_range(c, first, last);
+            removed += card - c->card;
+            if (!c->card) {
+                free(c->data);
+                continue;
+            }
+        }
+
+        r->keys[nr] = high;
+        r->c[nr++] = *c;
+    }
+    r->nr = nr;
+
+    return removed;
+}
+
+size_t roaring_memsize(const struct roaring *r)
+{
+    size_t size = sizeof(*r) +
+                  r->cap * (sizeof(uint16_t) + sizeof(struct rr_container));
+
+    for (size_t i = 0; i < r->nr; i++) {
+        const struct rr_container *c = &r->c[i];
+        if (c->type == RR_ARRAY)
+            size += c->cap * sizeof(uint16_t);
+        else if (c->type == RR_BITMAP)
+            size += RR_BITMAP_WORDS * sizeof(uint64_t);
+        else
+            size += c->cap * sizeof(struct rr_run);
+    }
+    return size;
+}
@@ -0,0 +1,74 @@
+#ifndef ROARING_H
+#define ROARING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Roaring bitmap: a compressed set of int keys (Chambi, Lemire et al.).
+ *
+ * The keys are split by their high 16 bits into chunks of 65536 possible keys,
+ * and the low 16 bits of those present in a chunk are stored in a container
+ * picked to suit their density: a sorted array while there are few of them, a
+ * plain bitmap of 8KB once they are too many for that, or a list of runs of
+ * consecutive keys when those take even less room. The containers themselves
+ * are kept in an array sorted by their high bits.
+ *
+ * Dense keys thus cost a bit each at most, or nearly nothing when they form
+ * runs, and sparse ones 2 bytes each. Set operations work a container at a
+ * time, whole bitmaps being combined a register of words at a time.
+ */
+
+/* Largest array container, the size of a bitmap in bytes */
+#define RR_ARRAY_MAX 4096
+#define RR_BITMAP_WORDS 1024
+
+enum rr_type {
+    RR_ARRAY,
+    RR_BITMAP,
+    RR_RUN,
+};
+
+/* The keys start to start + len */
+struct rr_run {
+    uint16_t start, len;
+};
+
+struct rr_container {
+    enum rr_type type;
+    uint32_t card; /* number of keys */
+    uint32_t nr, cap; /* entries in use and allocated, arrays and runs only */
+    union {
+        void *data;
+        uint16_t *array;
+        uint64_t *bitmap;
+        struct rr_run *runs;
+    };
+};
+
+struct roaring {
+    uint16_t *keys; /* high bits of the keys of each container, sorted */
+    struct rr_container *c;
+    size_t nr, cap;
+};
+
+struct roaring *roaring_create(void);
+void roaring_destroy(struct roaring *r);
+int roaring_insert(struct roaring *r, int key);
+int roaring_remove(struct roaring *r, int key);
+int roaring_contains(const struct roaring *r, int key);
+/* Visit the keys in [lo, hi] in order, return how many */
+size_t roaring_range(const struct roaring *r,
+                     int lo,
+                     int hi,
+                     void (*cb)(int key, void *arg),
+                     void *arg);
+/* r = r op other, other being left empty */
+void roaring_union(struct roaring *r, struct roaring *other);
+void roaring_intersection(struct roaring *r, struct roaring *other);
+void roaring_difference(struct roaring *r, struct roaring *other);
+/* Remove the keys in [lo, hi] and return how many there were */
+size_t roaring_range_delete(struct roaring *r, int lo, int hi);
+/* Bytes held by the set, counting the room allocated ahead */
+size_t roaring_memsize(const struct roaring *r);
+
+#endif
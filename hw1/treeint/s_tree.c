@@ -23,6 +23,14 @@
  * optimality. However, it is important to consider that each update operation
  * incurs a certain time penalty.
  *
+ * The tree can defer its updates (see st_set_update_freq()): instead of running
+ * them right away, the nodes to update are marked dirty and collected in a
+ * list, which is processed in one batch once enough modifications piled up.
+ * A burst of writes then skips the rebalancing walk of each operation, and
+ * walks that reach the same ancestors stop early once the hints above are
+ * already up to date. The layout is temporarily less optimal, but lookups
+ * stay correct since the ordering of the keys is never affected.
+ *
  * The update function exhibits a relatively straightforward process: When a
  * specific node leans to the right or left beyond a defined threshold, a left
  * or right rotation is performed on the node, respectively. Concurrently, the
@@ -33,9 +41,19 @@
  */
 #include "s_tree.h"
 #include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdlib.h>
+#include "eytzinger.h"
+
+/* Subtrees smaller than this are not worth a thread of their own */
+#define ST_BUILD_SPLIT (1 << 14)
 
-enum st_dir { LEFT, RIGHT, NONE };
+/* Rotations a lookup can save up for a splay, deeper nodes are never splayed */
+#define ST_SPLAY_CREDIT_MAX 64
+
+/* Descents in flight in st_find_batch(), about what the cache can keep pending */
+#define ST_BATCH_WIDTH 16
 
 struct st_tree *st_create(cmp_t *cmp,
                           struct st_node *(*create_node)(),
@@ -46,42 +64,141 @@ struct st_tree *st_create(cmp_t *cmp,
     tree->cmp = cmp;
     tree->create_node = create_node;
     tree->destroy_node = destroy_node;
+    tree->update_freq = 1;
     return tree;
 }
 
+/* Free a subtree without recursion nor stack: while the current node has a
+ * left child, rotate that child up, which moves one more node onto the right
+ * spine. A node without left child can be freed once its right child has been
+ * picked as the next one. Every node is rotated at most once, so this takes
+ * linear time. The parent links are left stale since the nodes are going away.
+ */
 static void __st_destroy(struct st_tree *tree, struct st_node *n)
 {
-    if (st_left(n))
-        __st_destroy(tree, st_left(n));
+    while (n) {
+        struct st_node *l = st_left(n);
+
+        if (l) {
+            st_left(n) = st_right(l);
+            st_right(l) = n;
+            n = l;
+        } else {
+            struct st_node *r = st_right(n);
+            tree->destroy_node(n);
+            n = r;
+        }
+    }
+}
 
-    if (st_right(n))
-        __st_destroy(tree, st_right(n));
+void st_destroy(struct st_tree *tree)
+{
+    __st_destroy(tree, st_root(tree));
 
-    tree->destroy_node(n);
+    free(tree->dirty);
+    free(tree);
 }
 
-void st_destroy(struct st_tree *tree)
+struct st_destroy_job {
+    struct st_tree *tree;
+    struct st_node *root;
+    int spawn;
+};
+
+static void __st_destroy_parallel(struct st_tree *tree,
+                                  struct st_node *n,
+                                  int spawn);
+
+static void *st_destroy_worker(void *arg)
 {
-    if (st_root(tree))
-        __st_destroy(tree, st_root(tree));
+    struct st_destroy_job *job = arg;
+
+    __st_destroy_parallel(job->tree, job->root, job->spawn);
+    return NULL;
+}
+
+/* Hand the left subtree of the top levels to new threads, the same way as
+ * __st_build() does, and free the rest with __st_destroy().
+ */
+static void __st_destroy_parallel(struct st_tree *tree,
+                                  struct st_node *n,
+                                  int spawn)
+{
+    pthread_t worker;
+
+    if (!n)
+        return;
+
+    if (spawn > 0 && st_left(n) && st_right(n)) {
+        struct st_destroy_job job = {
+            .tree = tree,
+            .root = st_left(n),
+            .spawn = spawn - 1,
+        };
+
+        if (!pthread_create(&worker, NULL, st_destroy_worker, &job)) {
+            __st_destroy_parallel(tree, st_right(n), spawn - 1);
+            pthread_join(worker, NULL);
+            tree->destroy_node(n);
+            return;
+        }
+    }
+
+    __st_destroy(tree, n);
+}
 
+void st_destroy_parallel(struct st_tree *tree, int nr_threads)
+{
+    int spawn = 0;
+
+    while ((1 << spawn) < nr_threads)
+        spawn++;
+
+    __st_destroy_parallel(tree, st_root(tree), spawn);
+
+    free(tree->dirty);
     free(tree);
 }
 
 struct st_node *st_first(struct st_node *n)
 {
-    if (!st_left(n))
-        return n;
+    while (st_left(n))
+        n = st_left(n);
 
-    return st_first(st_left(n));
+    return n;
 }
 
 struct st_node *st_last(struct st_node *n)
 {
-    if (!st_right(n))
-        return n;
+    while (st_right(n))
+        n = st_right(n);
+
+    return n;
+}
+
+struct st_node *st_next(struct st_node *n)
+{
+    if (st_right(n))
+        return st_first(st_right(n));
+
+    /* climb until we come up from a left subtree */
+    struct st_node *p;
+    while ((p = st_parent(n)) && n == st_right(p))
+        n = p;
+
+    return p;
+}
+
+struct st_node *st_prev(struct st_node *n)
+{
+    if (st_left(n))
+        return st_last(st_left(n));
 
-    return st_last(st_right(n));
+    struct st_node *p;
+    while ((p = st_parent(n)) && n == st_left(p))
+        n = p;
+
+    return p;
 }
 
 static inline void st_rotate_left(struct st_node *n)
@@ -146,32 +263,163 @@ static inline int st_max_hint(struct st_node *n)
     return l > r ? l : r;
 }
 
+/* Walk up from n through the parent links for as long as the hints change */
 static inline void st_update(struct st_node **root, struct st_node *n)
 {
-    if (!n)
+    while (n) {
+        int b = st_balance(n);
+        int prev_hint = n->hint;
+        struct st_node *p = st_parent(n);
+
+        if (b < -1) {
+            /* leaning to the right */
+            if (n == *root)
+                *root = st_right(n);
+            st_rotate_right(n);
+        }
+
+        else if (b > 1) {
+            /* leaning to the left */
+            if (n == *root)
+                *root = st_left(n);
+            st_rotate_left(n);
+        }
+
+        n->hint = st_max_hint(n);
+        if (n->hint != 0 && n->hint == prev_hint)
+            break;
+
+        n = p;
+    }
+}
+
+static void st_mark_dirty(struct st_tree *tree, struct st_node *n)
+{
+    if (n->dirty)
+        return;
+
+    if (tree->nr_dirty == tree->dirty_cap) {
+        size_t cap = tree->dirty_cap ? tree->dirty_cap * 2 : 64;
+        struct st_node **dirty = realloc(tree->dirty, cap * sizeof(*dirty));
+        if (!dirty) {
+            /* fall back to an immediate update */
+            st_update(&st_root(tree), n);
+            return;
+        }
+        tree->dirty = dirty;
+        tree->dirty_cap = cap;
+    }
+
+    tree->dirty[tree->nr_dirty++] = n;
+    n->dirty = tree->nr_dirty;
+}
+
+/* Drop a node which is about to be freed from the pending updates */
+static void st_clear_dirty(struct st_tree *tree, struct st_node *n)
+{
+    if (!n->dirty)
         return;
 
-    int b = st_balance(n);
-    int prev_hint = n->hint;
+    struct st_node *last = tree->dirty[--tree->nr_dirty];
+    tree->dirty[n->dirty - 1] = last;
+    last->dirty = n->dirty;
+    n->dirty = 0;
+}
+
+void st_flush(struct st_tree *tree)
+{
+    while (tree->nr_dirty) {
+        struct st_node *n = tree->dirty[--tree->nr_dirty];
+        n->dirty = 0;
+        st_update(&st_root(tree), n);
+    }
+    tree->nr_pending = 0;
+}
+
+void st_set_update_freq(struct st_tree *tree, unsigned int freq)
+{
+    tree->update_freq = freq;
+    if (freq == 1)
+        st_flush(tree);
+}
+
+void st_set_lookup_budget(struct st_tree *tree, unsigned int budget)
+{
+    tree->lookup_budget = budget;
+}
+
+/* Rotate n above its parent, see st_rotate_left() and st_rotate_right() */
+static inline void st_rotate_up(struct st_node **root, struct st_node *n)
+{
     struct st_node *p = st_parent(n);
 
-    if (b < -1) {
-        /* leaning to the right */
-        if (n == *root)
-            *root = st_right(n);
-        st_rotate_right(n);
+    if (p == *root)
+        *root = n;
+
+    if (n == st_left(p))
+        st_rotate_left(p);
+    else
+        st_rotate_right(p);
+
+    p->hint = st_max_hint(p);
+    n->hint = st_max_hint(n);
+}
+
+/* Splay n up to the root: zig-zig steps when n and its parent are children on
+ * the same side, which roughly halve the depth of the nodes on the path,
+ * zig-zag steps otherwise, and a last single rotation below the root. Only a
+ * splay that goes all the way keeps the amortized bounds of splay trees,
+ * stopping halfway pushes the rest of the path down instead.
+ */
+static void st_splay(struct st_node **root, struct st_node *n)
+{
+    while (st_parent(n)) {
+        struct st_node *p = st_parent(n), *g = st_parent(p);
+
+        if (!g) {
+            st_rotate_up(root, n);
+            return;
+        }
+
+        if ((n == st_left(p)) == (p == st_left(g)))
+            st_rotate_up(root, p);
+        else
+            st_rotate_up(root, n);
+        st_rotate_up(root, n);
     }
+}
 
-    else if (b > 1) {
-        /* leaning to the left */
-        if (n == *root)
-            *root = st_left(n);
-        st_rotate_left(n);
+/* See st_set_lookup_budget() */
+static void st_adjust(struct st_tree *tree, struct st_node *n)
+{
+    unsigned int depth = 0;
+
+    tree->lookup_credit += tree->lookup_budget;
+    if (tree->lookup_credit > ST_SPLAY_CREDIT_MAX)
+        tree->lookup_credit = ST_SPLAY_CREDIT_MAX;
+
+    for (struct st_node *p = st_parent(n); p; p = st_parent(p)) {
+        if (++depth > tree->lookup_credit)
+            return;
     }
 
-    n->hint = st_max_hint(n);
-    if (n->hint == 0 || n->hint != prev_hint)
-        st_update(root, p);
+    tree->lookup_credit -= depth;
+    st_splay(&st_root(tree), n);
+}
+
+/* Run the update phase on n now or later, depending on the update frequency */
+static void st_schedule_update(struct st_tree *tree, struct st_node *n)
+{
+    if (tree->update_freq == 1) {
+        st_update(&st_root(tree), n);
+        return;
+    }
+
+    if (n)
+        st_mark_dirty(tree, n);
+
+    if (tree->update_freq && ++tree->nr_pending >= tree->update_freq)
+        st_flush(tree);
 }
 
 static struct st_node *__st_find(struct st_tree *tree,
@@ -190,10 +438,10 @@ static struct st_node *__st_find(struct st_tree *tree,
 
         if (cmp > 0) {
             n = st_left(n);
-            *d = LEFT;
+            *d = ST_LEFT;
         } else if (cmp < 0) {
             n = st_right(n);
-            *d = RIGHT;
+            *d = ST_RIGHT;
         }
     }
 
@@ -222,38 +470,48 @@ static struct st_node *__st_find2(struct st_tree *tree, void *key)
  * BST insertion techniques, an update operation is invoked on the newly
  * inserted node.
  */
-static void __st_insert(struct st_node **root,
-                        struct st_node *p,
-                        struct st_node *n,
-                        enum st_dir d)
+static void __st_insert(struct st_node *p, struct st_node *n, enum st_dir d)
 {
-    if (d == LEFT)
+    if (d == ST_LEFT)
         st_left(p) = n;
     else
         st_right(p) = n;
 
     st_parent(n) = p;
-    st_update(root, n);
 }
 
 int st_insert(struct st_tree *tree, void *key)
 {
     struct st_node *p = NULL;
-    enum st_dir d = NONE;
+    enum st_dir d = ST_NONE;
     struct st_node *n = __st_find(tree, key, &p, &d);
     if (n != NULL)
         return -1;
 
     n = tree->create_node(key);
     if (st_root(tree)) {
-        assert(d != NONE);
-        __st_insert(&st_root(tree), p, n, d);
+        assert(d != ST_NONE);
+        __st_insert(p, n, d);
+        st_schedule_update(tree, n);
     } else
         st_root(tree) = n;
 
     return 0;
 }
 
+void st_link(struct st_node **root,
+             struct st_node *p,
+             struct st_node *n,
+             enum st_dir d)
+{
+    if (*root) {
+        assert(p && d != ST_NONE);
+        __st_insert(p, n, d);
+        st_update(root, n);
+    } else
+        *root = n;
+}
+
 static inline void st_replace_right(struct st_node *n, struct st_node *r)
 {
     struct st_node *p = st_parent(n), *rp = st_parent(r);
@@ -329,17 +587,18 @@ static inline void st_replace_left(struct st_node *n, struct st_node *l)
  * In scenarios where the node to be deleted has no children (neither left nor
  * right), it can be directly removed from the tree, and an update operation is
  * invoked on the parent node of the deleted node.
+ *
+ * The node to update is returned, and the caller runs or schedules the update.
  */
-static void __st_remove(struct st_node **root, struct st_node *del)
+static struct st_node *__st_remove(struct st_node **root, struct st_node *del)
 {
     if (st_right(del)) {
         struct st_node *least = st_first(st_right(del));
         if (del == *root)
             *root = least;
 
-        st_replace_right(del, least);      // AAAA
-        st_update(root, st_right(least));  // BBBB
-        return;
+        st_replace_right(del, least);  // AAAA
+        return st_right(least);        // BBBB
     }
 
     if (st_left(del)) {
@@ -347,14 +606,13 @@ static void __st_remove(struct st_node **root, struct st_node *del)
         if (del == *root)
             *root = most;
 
-        st_replace_left(del, most);      // CCCC
-        st_update(root, st_left(most));  // DDDD
-        return;
+        st_replace_left(del, most);  // CCCC
+        return st_left(most);        // DDDD
     }
 
     if (del == *root) {
         *root = 0;
-        return;
+        return NULL;
     }
 
     /* empty node */
@@ -365,22 +623,476 @@ static void __st_remove(struct st_node **root, struct st_node *del)
     else
         st_right(parent) = 0;
 
-    st_update(root, parent);  // EEEE
+    return parent;  // EEEE
 }
 
 struct st_node *st_find(struct st_tree *tree, void *key)
 {
-    return __st_find2(tree, key);
+    struct st_node *n = __st_find2(tree, key);
+
+    if (n && tree->lookup_budget)
+        st_adjust(tree, n);
+
+    return n;
 }
 
+/* Keep ST_BATCH_WIDTH descents going, moving each by one node per round and
+ * prefetching the node it goes to, which will have arrived by the time the
+ * round comes back to it. A finished descent hands its slot over to the next
+ * key, so that short descents do not leave slots idle, as in AMAC.
+ */
+size_t st_find_batch(struct st_tree *tree,
+                     void *keys,
+                     size_t size,
+                     size_t nr,
+                     struct st_node **out)
+{
+    struct {
+        struct st_node *n;
+        size_t i;
+    } slot[ST_BATCH_WIDTH];
+    size_t next = 0, nr_slots = 0, found = 0;
+
+    if (!st_root(tree)) {
+        for (size_t i = 0; i < nr; i++)
+            out[i] = NULL;
+        return 0;
+    }
+
+    while (nr_slots < ST_BATCH_WIDTH && next < nr) {
+        slot[nr_slots].n = st_root(tree);
+        slot[nr_slots++].i = next++;
+    }
+
+    while (nr_slots) {
+        for (size_t s = 0; s < nr_slots;) {
+            struct st_node *n = slot[s].n;
+            size_t i = slot[s].i;
+            int cmp = tree->cmp(n, (char *) keys + i * size);
+
+            if (cmp)
+                n = cmp > 0 ? st_left(n) : st_right(n);
+
+            if (cmp && n) {
+                __builtin_prefetch(n);
+                slot[s++].n = n;
+                continue;
+            }
+
+            out[i] = n;
+            found += !!n;
+
+            /* The root stays in cache, no need to prefetch it */
+            if (next < nr) {
+                slot[s].n = st_root(tree);
+                slot[s++].i = next++;
+            } else {
+                slot[s] = slot[--nr_slots];
+            }
+        }
+    }
+
+    /* Splay once all the descents are over, not to move nodes under them */
+    for (size_t i = 0; tree->lookup_budget && i < nr; i++) {
+        if (out[i])
+            st_adjust(tree, out[i]);
+    }
+
+    return found;
+}
+
+struct st_node *st_lower_bound(struct st_tree *tree, void *key)
+{
+    struct st_node *lb = NULL;
+
+    for (struct st_node *n = st_root(tree); n;) {
+        int cmp = tree->cmp(n, key);
+        if (cmp == 0)
+            return n;
+
+        if (cmp > 0) {
+            lb = n;
+            n = st_left(n);
+        } else {
+            n = st_right(n);
+        }
+    }
+
+    return lb;
+}
+
+/* The hint of a node approximates its height, so a climb from a leaf up to p
+ * takes about as many steps as the descent from p back down. Unlike the top
+ * levels, which every search from the root keeps in cache, the nodes higher
+ * up than the last searches went are likely cold, so only climb through the
+ * bottom quarter of the tree.
+ */
+static inline bool st_climb_far(struct st_tree *tree, struct st_node *p)
+{
+    return 4 * p->hint > st_root(tree)->hint;
+}
+
+/* Look for key around the finger, see st_find_from(). When it is missing,
+ * *lo and *hi are left holding the nodes around the gap for it, and when it is
+ * found, its neighbours for the finger to move to it.
+ */
+static struct st_node *__st_find_from(struct st_tree *tree,
+                                      struct st_finger *f,
+                                      void *key,
+                                      struct st_node **lo,
+                                      struct st_node **hi)
+{
+    struct st_node *n = f->node, *top = st_root(tree);
+    int cmp;
+
+    *lo = *hi = NULL;
+    if (!n)
+        goto descend;
+
+    cmp = tree->cmp(n, key);
+    if (cmp == 0) {
+        *lo = f->prev;
+        *hi = f->next;
+        return n;
+    }
+
+    if (cmp < 0) {
+        if (f->next == n)
+            f->next = st_next(n);
+
+        *lo = n;
+        *hi = f->next;
+        if (!f->next || (cmp = tree->cmp(f->next, key)) > 0)
+            return NULL;
+        if (cmp == 0) {
+            n = f->next;
+            goto found;
+        }
+
+        /* Past the next node too. Ancestors reached from a right child are
+         * smaller than it, so only those reached from a left child can bound
+         * key from above. A key not bounded within the bottom of the tree is
+         * far away, and searched from the root instead, see st_climb_far().
+         */
+        *lo = *hi = NULL;
+        for (top = f->next; st_parent(top); top = st_parent(top)) {
+            struct st_node *p = st_parent(top);
+            if (st_climb_far(tree, p)) {
+                top = st_root(tree);
+                break;
+            }
+            if (top == st_right(p))
+                continue;
+
+            cmp = tree->cmp(p, key);
+            if (cmp > 0) {
+                *hi = p;
+                break;
+            }
+            if (cmp == 0) {
+                n = p;
+                goto found;
+            }
+        }
+    } else {
+        if (f->prev == n)
+            f->prev = st_prev(n);
+
+        *lo = f->prev;
+        *hi = n;
+        if (!f->prev || (cmp = tree->cmp(f->prev, key)) < 0)
+            return NULL;
+        if (cmp == 0) {
+            n = f->prev;
+            goto found;
+        }
+
+        *lo = *hi = NULL;
+        for (top = f->prev; st_parent(top); top = st_parent(top)) {
+            struct st_node *p = st_parent(top);
+            if (st_climb_far(tree, p)) {
+                top = st_root(tree);
+                break;
+            }
+            if (top == st_left(p))
+                continue;
+
+            cmp = tree->cmp(p, key);
+            if (cmp < 0) {
+                *lo = p;
+                break;
+            }
+            if (cmp == 0) {
+                n = p;
+                goto found;
+            }
+        }
+    }
+
+descend:
+    /* The bound missing from the climb, if any, is met on the way down: key
+     * lies past the neighbour we climbed from, which is below top.
+     */
+    for (n = top; n;) {
+        cmp = tree->cmp(n, key);
+        if (cmp == 0) {
+            if (st_left(n))
+                *lo = n;
+            if (st_right(n))
+                *hi = n;
+            return n;
+        }
+
+        if (cmp > 0) {
+            *hi = n;
+            n = st_left(n);
+        } else {
+            *lo = n;
+            n = st_right(n);
+        }
+    }
+
+    return NULL;
+
+found:
+    /* On a neighbour of the finger or an ancestor of one, off the path. The
+     * neighbours down a subtree are left to look up, see struct st_finger.
+     */
+    if (n == f->next)
+        *lo = f->node;
+    else
+        *lo = st_left(n) ? n : st_prev(n);
+
+    if (n == f->prev)
+        *hi = f->node;
+    else
+        *hi = st_right(n) ? n : st_next(n);
+
+    return n;
+}
+
+static inline void st_finger_move(struct st_finger *f,
+                                  struct st_node *n,
+                                  struct st_node *lo,
+                                  struct st_node *hi)
+{
+    f->node = n;
+    f->prev = lo;
+    f->next = hi;
+}
+
+struct st_node *st_find_from(struct st_tree *tree,
+                             struct st_finger *f,
+                             void *key)
+{
+    struct st_node *lo, *hi;
+    struct st_node *n = __st_find_from(tree, f, key, &lo, &hi);
+
+    if (n) {
+        st_finger_move(f, n, lo, hi);
+        /* The neighbours stay the same whatever the shape of the tree */
+        if (tree->lookup_budget)
+            st_adjust(tree, n);
+    }
+
+    return n;
+}
+
+int st_insert_hint(struct st_tree *tree, struct st_finger *f, void *key)
+{
+    struct st_node *lo, *hi;
+    struct st_node *n = __st_find_from(tree, f, key, &lo, &hi);
+
+    if (n) {
+        st_finger_move(f, n, lo, hi);
+        return -1;
+    }
+
+    /* Of two adjacent nodes, either the lower one has no right child or the
+     * higher one has no left child.
+     */
+    n = tree->create_node(key);
+    if (lo && !st_right(lo)) {
+        __st_insert(lo, n, ST_RIGHT);
+        st_schedule_update(tree, n);
+    } else if (hi) {
+        assert(!st_left(hi));
+        __st_insert(hi, n, ST_LEFT);
+        st_schedule_update(tree, n);
+    } else {
+        assert(!st_root(tree));
+        st_root(tree) = n;
+    }
+
+    st_finger_move(f, n, lo, hi);
+    return 0;
+}
+
+/* Looks the key up without st_adjust(): splaying the node right before it
+ * goes would only churn the tree.
+ */
 int st_remove(struct st_tree *tree, void *key)
 {
-    struct st_node *n = st_find(tree, key);
+    struct st_node *n = __st_find2(tree, key);
     if (!n)
         return -1;
 
-    __st_remove(&st_root(tree), n);
+    st_clear_dirty(tree, n);
+    st_schedule_update(tree, __st_remove(&st_root(tree), n));
     tree->destroy_node(n);
 
     return 0;
 }
+
+void st_erase(struct st_node **root, struct st_node *n)
+{
+    st_update(root, __st_remove(root, n));
+}
+
+static size_t st_count(struct st_node *n)
+{
+    size_t nr = 0;
+
+    for (n = n ? st_first(n) : NULL; n; n = st_next(n))
+        nr++;
+
+    return nr;
+}
+
+struct st_freeze_ctx {
+    char *base;
+    size_t size, nr, k;
+    void (*fill)(void *slot, struct st_node *n);
+};
+
+/* An in-order walk of the tree visits the keys in the same order as
+ * ez_next() visits the slots of the layout.
+ */
+static void __st_freeze(struct st_node *n, struct st_freeze_ctx *ctx)
+{
+    for (n = n ? st_first(n) : NULL; n; n = st_next(n)) {
+        ctx->fill(ctx->base + ctx->k * ctx->size, n);
+        ctx->k = ez_next(ctx->k, ctx->nr);
+    }
+}
+
+void *st_freeze(struct st_tree *tree,
+                size_t size,
+                void (*fill)(void *slot, struct st_node *n),
+                size_t *nr)
+{
+    struct st_freeze_ctx ctx = {
+        .size = size,
+        .nr = st_count(st_root(tree)),
+        .fill = fill,
+    };
+
+    ctx.base = ez_alloc(ctx.nr, size);
+    if (!ctx.base)
+        return NULL;
+
+    ctx.k = ez_first(ctx.nr);
+    __st_freeze(st_root(tree), &ctx);
+
+    *nr = ctx.nr;
+    return ctx.base;
+}
+
+struct st_build_ctx {
+    struct st_tree *tree;
+    char *keys;
+    size_t size;
+};
+
+struct st_build_job {
+    const struct st_build_ctx *ctx;
+    size_t lo, hi;
+    struct st_node *parent;
+    int spawn;
+    struct st_node *root;
+};
+
+static struct st_node *__st_build(const struct st_build_ctx *ctx,
+                                  size_t lo,
+                                  size_t hi,
+                                  struct st_node *parent,
+                                  int spawn);
+
+static void *st_build_worker(void *arg)
+{
+    struct st_build_job *job = arg;
+
+    job->root =
+        __st_build(job->ctx, job->lo, job->hi, job->parent, job->spawn);
+    return NULL;
+}
+
+/* Take the median of keys[lo, hi) as the root and build both halves below it.
+ * Since both halves differ in size by at most one, the result is balanced
+ * and the hints can be computed exactly on the way back up. While spawn is
+ * positive, the left half is handed to a new thread.
+ */
+static struct st_node *__st_build(const struct st_build_ctx *ctx,
+                                  size_t lo,
+                                  size_t hi,
+                                  struct st_node *parent,
+                                  int spawn)
+{
+    if (lo >= hi)
+        return NULL;
+
+    size_t mid = lo + (hi - lo) / 2;
+    struct st_node *n = ctx->tree->create_node(ctx->keys + mid * ctx->size);
+    st_parent(n) = parent;
+
+    pthread_t worker;
+    struct st_build_job job = {
+        .ctx = ctx,
+        .lo = lo,
+        .hi = mid,
+        .parent = n,
+        .spawn = spawn - 1,
+    };
+
+    if (spawn > 0 && hi - lo >= ST_BUILD_SPLIT &&
+        !pthread_create(&worker, NULL, st_build_worker, &job)) {
+        st_right(n) = __st_build(ctx, mid + 1, hi, n, spawn - 1);
+        pthread_join(worker, NULL);
+        st_left(n) = job.root;
+    } else {
+        st_left(n) = __st_build(ctx, lo, mid, n, spawn - 1);
+        st_right(n) = __st_build(ctx, mid + 1, hi, n, spawn - 1);
+    }
+
+    n->hint = st_max_hint(n);
+    return n;
+}
+
+int st_build_sorted_parallel(struct st_tree *tree,
+                             void *keys,
+                             size_t nr,
+                             size_t size,
+                             int nr_threads)
+{
+    struct st_build_ctx ctx = {
+        .tree = tree,
+        .keys = keys,
+        .size = size,
+    };
+    int spawn = 0;
+
+    if (st_root(tree))
+        return -1;
+
+    /* Each level of spawning doubles the number of threads */
+    while ((1 << spawn) < nr_threads)
+        spawn++;
+
+    st_root(tree) = __st_build(&ctx, 0, nr, NULL, spawn);
+    return 0;
+}
+
+int st_build_sorted(struct st_tree *tree, void *keys, size_t nr, size_t size)
+{
+    return st_build_sorted_parallel(tree, keys, nr, size, 1);
+}
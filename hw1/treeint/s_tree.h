@@ -1,6 +1,8 @@
 #ifndef STREE_H
 #define STREE_H
 
+#include <stddef.h>
+
 #define st_root(r) (r->root)
 #define st_left(n) (n->left)
 #define st_right(n) (n->right)
@@ -15,24 +17,132 @@
  */
 struct st_node {
     short hint;
+    /* 1 + position in the pending update list of the tree, 0 if none */
+    unsigned int dirty;
     struct st_node *parent;
     struct st_node *left, *right;
 };
 
+enum st_dir { ST_LEFT, ST_RIGHT, ST_NONE };
+
 typedef int cmp_t(struct st_node *node, void *key);
 struct st_tree {
     struct st_node *root;
     cmp_t *cmp;
     struct st_node *(*create_node)(void *key);
     void (*destroy_node)(struct st_node *n);
+
+    /* Deferred updates, see st_set_update_freq() */
+    unsigned int update_freq, nr_pending;
+    struct st_node **dirty;
+    size_t nr_dirty, dirty_cap;
+
+    /* Self-adjusting lookups, see st_set_lookup_budget() */
+    unsigned int lookup_budget, lookup_credit;
 };
 
 struct st_tree *st_create(cmp_t *cmp,
                           struct st_node *(*create_node)(void *key),
                           void (*destroy_node)(struct st_node *n));
 void st_destroy(struct st_tree *tree);
+/* Free the subtrees of the top levels on up to nr_threads threads, so
+ * destroy_node() must be thread-safe.
+ */
+void st_destroy_parallel(struct st_tree *tree, int nr_threads);
 int st_insert(struct st_tree *tree, void *key);
 int st_remove(struct st_tree *tree, void *key);
 struct st_node *st_find(struct st_tree *tree, void *key);
+/* Look up the nr keys of size bytes each stored at keys, storing the node of
+ * the i-th key or NULL in out[i], and return how many were found. The descents
+ * are interleaved so that their cache misses overlap instead of adding up.
+ */
+size_t st_find_batch(struct st_tree *tree,
+                     void *keys,
+                     size_t size,
+                     size_t nr,
+                     struct st_node **out);
+
+/* By default, the tree is updated right after every insertion and removal.
+ * With an update frequency freq > 1, the nodes to update are only recorded,
+ * and the pending updates are run in one batch every freq modifications. With
+ * freq 0, they only run when st_flush() is called.
+ */
+void st_set_update_freq(struct st_tree *tree, unsigned int freq);
+void st_flush(struct st_tree *tree);
+
+/* By default, lookups leave the tree alone. With a budget > 0, each lookup by
+ * st_find(), st_find_from() or st_find_batch() earns budget rotations, and the
+ * node found is splayed up to the root whenever the rotations saved up cover
+ * its depth. The hot keys, being the shallow ones, come up most often, so that
+ * under skewed accesses they gather near the root. The hints of the nodes
+ * rotated are kept up to date, and the next updates rebalance the paths they
+ * walk as usual.
+ */
+void st_set_lookup_budget(struct st_tree *tree, unsigned int budget);
+
+/* In-order traversal. st_lower_bound() returns the first node not less than
+ * key, and st_next()/st_prev() return NULL past either end of the tree.
+ */
+struct st_node *st_first(struct st_node *n);
+struct st_node *st_last(struct st_node *n);
+struct st_node *st_next(struct st_node *n);
+struct st_node *st_prev(struct st_node *n);
+struct st_node *st_lower_bound(struct st_tree *tree, void *key);
+
+/* Finger search, for keys close to the last one touched. A finger is a node
+ * of the tree along with its in-order neighbours, NULL past either end, or no
+ * node at all to start from the root. It stays valid across insertions and
+ * rebalancing, but not once any of its three nodes is removed. A neighbour
+ * down a subtree of the node is only looked up when needed, and until then
+ * prev or next points to the node itself.
+ *
+ * A key falling in the gap on either side of the finger, or on a neighbour,
+ * is settled without leaving it, so that runs of increasing or decreasing keys
+ * cost O(1) each. Otherwise the search climbs from the neighbour only as far
+ * as the first ancestor bounding the key, then walks down from there. Both
+ * move the finger to the node found or inserted, and st_insert_hint() returns
+ * -1 if the key is already present, like st_insert().
+ */
+struct st_finger {
+    struct st_node *node, *prev, *next;
+};
+
+struct st_node *st_find_from(struct st_tree *tree,
+                             struct st_finger *f,
+                             void *key);
+int st_insert_hint(struct st_tree *tree, struct st_finger *f, void *key);
+
+/* Low-level primitives for callers that perform the key search themselves,
+ * e.g. the specialized trees generated by ST_DEFINE() in s_tree_typed.h.
+ * st_link() attaches n as the d child of p (or as the root when p is NULL)
+ * and rebalances, while st_erase() unlinks n without freeing it.
+ */
+void st_link(struct st_node **root,
+             struct st_node *p,
+             struct st_node *n,
+             enum st_dir d);
+void st_erase(struct st_node **root, struct st_node *n);
+
+/* Build the tree from nr keys of the given size, sorted in ascending order and
+ * free of duplicates, in linear time. The tree must be empty. The parallel
+ * variant creates the nodes of disjoint subtrees on up to nr_threads threads,
+ * so create_node() must then be thread-safe.
+ */
+int st_build_sorted(struct st_tree *tree, void *keys, size_t nr, size_t size);
+int st_build_sorted_parallel(struct st_tree *tree,
+                             void *keys,
+                             size_t nr,
+                             size_t size,
+                             int nr_threads);
+
+/* Take a read-only snapshot of the tree in Eytzinger layout (see eytzinger.h).
+ * The returned array holds one element of the given size per node, the node at
+ * Eytzinger index k being copied to slot k by fill(). The number of elements
+ * is stored in *nr and the array is to be released with free().
+ */
+void *st_freeze(struct st_tree *tree,
+                size_t size,
+                void (*fill)(void *slot, struct st_node *n),
+                size_t *nr);
 
 #endif
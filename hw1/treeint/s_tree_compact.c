@@ -0,0 +1,378 @@
+/*
+ * Compact S-Tree: the algorithm of s_tree.c on 32-bit indices.
+ *
+ * The rotations, the replacement of removed nodes and the update phase are
+ * line-by-line the ones of the pointer-based tree, see the comments there.
+ * Only the representation differs: a link is an index into the arena, and
+ * the hint shares the parent word, so setting a parent must preserve the
+ * hint and the other way around.
+ *
+ * The helpers below expect the node array of the tree in a local 'nodes'.
+ * It is stable for the whole operation since only ia_alloc() moves it.
+ */
+#include "s_tree_compact.h"
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* Tag of the image files of the tree, see ia_save() */
+#define STC_IMAGE_TAG 0x31435453 /* "STC1" */
+
+#define stc_left(n) (nodes[n].left)
+#define stc_right(n) (nodes[n].right)
+#define stc_parent(n) ia_parent(nodes[n].parent_meta)
+#define stc_hint(n) ((int) ia_meta(nodes[n].parent_meta))
+#define stc_set_parent(n, p) ia_set_parent(&nodes[n], p)
+
+struct stc_tree *stc_create(void)
+{
+    struct stc_tree *tree = calloc(sizeof(struct stc_tree), 1);
+    if (!tree)
+        return NULL;
+
+    ia_init(&tree->arena);
+    tree->root = IA_NIL;
+    return tree;
+}
+
+/* All the nodes go away with the arena, no traversal needed */
+void stc_destroy(struct stc_tree *tree)
+{
+    ia_release(&tree->arena);
+    free(tree);
+}
+
+int stc_save(struct stc_tree *tree, const char *path)
+{
+    return ia_save(&tree->arena, tree->root, STC_IMAGE_TAG, path);
+}
+
+struct stc_tree *stc_load(const char *path)
+{
+    struct stc_tree *tree = calloc(sizeof(struct stc_tree), 1);
+    if (!tree)
+        return NULL;
+
+    ia_init(&tree->arena);
+    if (ia_map(&tree->arena, &tree->root, STC_IMAGE_TAG, path)) {
+        free(tree);
+        return NULL;
+    }
+    return tree;
+}
+
+static inline void stc_rotate_left(struct ia_node *nodes, uint32_t n)
+{
+    uint32_t l = stc_left(n), p = stc_parent(n);
+
+    stc_set_parent(l, p);
+    stc_left(n) = stc_right(l);
+    stc_set_parent(n, l);
+    stc_right(l) = n;
+
+    if (p && stc_left(p) == n)
+        stc_left(p) = l;
+    else if (p)
+        stc_right(p) = l;
+
+    if (stc_left(n))
+        stc_set_parent(stc_left(n), n);
+}
+
+static inline void stc_rotate_right(struct ia_node *nodes, uint32_t n)
+{
+    uint32_t r = stc_right(n), p = stc_parent(n);
+
+    stc_set_parent(r, p);
+    stc_right(n) = stc_left(r);
+    stc_set_parent(n, r);
+    stc_left(r) = n;
+
+    if (p && stc_left(p) == n)
+        stc_left(p) = r;
+    else if (p)
+        stc_right(p) = r;
+
+    if (stc_right(n))
+        stc_set_parent(stc_right(n), n);
+}
+
+static inline int stc_balance(struct ia_node *nodes, uint32_t n)
+{
+    int l = 0, r = 0;
+
+    if (stc_left(n))
+        l = stc_hint(stc_left(n)) + 1;
+
+    if (stc_right(n))
+        r = stc_hint(stc_right(n)) + 1;
+
+    return l - r;
+}
+
+static inline int stc_max_hint(struct ia_node *nodes, uint32_t n)
+{
+    int l = 0, r = 0;
+
+    if (stc_left(n))
+        l = stc_hint(stc_left(n)) + 1;
+
+    if (stc_right(n))
+        r = stc_hint(stc_right(n)) + 1;
+
+    l = l > r ? l : r;
+    return l < (int) IA_META_MASK ? l : (int) IA_META_MASK;
+}
+
+static void stc_update(struct stc_tree *tree, uint32_t n)
+{
+    struct ia_node *nodes = tree->arena.nodes;
+
+    while (n) {
+        int b = stc_balance(nodes, n);
+        int prev_hint = stc_hint(n);
+        uint32_t p = stc_parent(n);
+
+        if (b < -1) {
+            /* leaning to the right */
+            if (n == tree->root)
+                tree->root = stc_right(n);
+            stc_rotate_right(nodes, n);
+        }
+
+        else if (b > 1) {
+            /* leaning to the left */
+            if (n == tree->root)
+                tree->root = stc_left(n);
+            stc_rotate_left(nodes, n);
+        }
+
+        int hint = stc_max_hint(nodes, n);
+        ia_set_meta(&nodes[n], hint);
+        if (hint != 0 && hint == prev_hint)
+            break;
+
+        n = p;
+    }
+}
+
+int stc_insert(struct stc_tree *tree, int key)
+{
+    struct ia_node *nodes = tree->arena.nodes;
+    uint32_t p = IA_NIL;
+    bool left = false;
+
+    for (uint32_t n = tree->root; n;) {
+        if (nodes[n].key == key)
+            return -1;
+
+        p = n;
+        left = nodes[n].key > key;
+        n = left ? stc_left(n) : stc_right(n);
+    }
+
+    ia_cow(&tree->arena);
+    uint32_t n = ia_alloc(&tree->arena);
+    if (!n)
+        return -1;
+
+    nodes = tree->arena.nodes;
+    nodes[n].key = key;
+
+    if (!p) {
+        tree->root = n;
+        return 0;
+    }
+
+    if (left)
+        stc_left(p) = n;
+    else
+        stc_right(p) = n;
+    stc_set_parent(n, p);
+
+    stc_update(tree, n);
+    return 0;
+}
+
+static inline uint32_t stc_first(struct ia_node *nodes, uint32_t n)
+{
+    while (stc_left(n))
+        n = stc_left(n);
+
+    return n;
+}
+
+static inline uint32_t stc_last(struct ia_node *nodes, uint32_t n)
+{
+    while (stc_right(n))
+        n = stc_right(n);
+
+    return n;
+}
+
+static inline void stc_replace_right(struct ia_node *nodes,
+                                     uint32_t n,
+                                     uint32_t r)
+{
+    uint32_t p = stc_parent(n), rp = stc_parent(r);
+
+    if (stc_left(rp) == r) {
+        stc_left(rp) = stc_right(r);
+        if (stc_right(r))
+            stc_set_parent(stc_right(r), rp);
+    }
+
+    if (stc_parent(rp) == n)
+        stc_set_parent(rp, r);
+
+    stc_set_parent(r, p);
+    stc_left(r) = stc_left(n);
+
+    if (stc_right(n) != r) {
+        stc_right(r) = stc_right(n);
+        stc_set_parent(stc_right(n), r);
+    }
+
+    if (p && stc_left(p) == n)
+        stc_left(p) = r;
+    else if (p)
+        stc_right(p) = r;
+
+    if (stc_left(n))
+        stc_set_parent(stc_left(n), r);
+}
+
+static inline void stc_replace_left(struct ia_node *nodes,
+                                    uint32_t n,
+                                    uint32_t l)
+{
+    uint32_t p = stc_parent(n), lp = stc_parent(l);
+
+    if (stc_right(lp) == l) {
+        stc_right(lp) = stc_left(l);
+        if (stc_left(l))
+            stc_set_parent(stc_left(l), lp);
+    }
+
+    if (stc_parent(lp) == n)
+        stc_set_parent(lp, l);
+
+    stc_set_parent(l, p);
+    stc_right(l) = stc_right(n);
+
+    if (stc_left(n) != l) {
+        stc_left(l) = stc_left(n);
+        stc_set_parent(stc_left(n), l);
+    }
+
+    if (p && stc_left(p) == n)
+        stc_left(p) = l;
+    else if (p)
+        stc_right(p) = l;
+
+    if (stc_right(n))
+        stc_set_parent(stc_right(n), l);
+}
+
+/* Unlink del as __st_remove() does, and return the node to update */
+static uint32_t __stc_remove(struct stc_tree *tree, uint32_t del)
+{
+    struct ia_node *nodes = tree->arena.nodes;
+
+    if (stc_right(del)) {
+        uint32_t least = stc_first(nodes, stc_right(del));
+        if (del == tree->root)
+            tree->root = least;
+
+        stc_replace_right(nodes, del, least);
+        return stc_right(least);
+    }
+
+    if (stc_left(del)) {
+        uint32_t most = stc_last(nodes, stc_left(del));
+        if (del == tree->root)
+            tree->root = most;
+
+        stc_replace_left(nodes, del, most);
+        return stc_left(most);
+    }
+
+    if (del == tree->root) {
+        tree->root = IA_NIL;
+        return IA_NIL;
+    }
+
+    uint32_t parent = stc_parent(del);
+
+    if (stc_left(parent) == del)
+        stc_left(parent) = IA_NIL;
+    else
+        stc_right(parent) = IA_NIL;
+
+    return parent;
+}
+
+static uint32_t __stc_find(struct stc_tree *tree, int key)
+{
+    struct ia_node *nodes = tree->arena.nodes;
+
+    for (uint32_t n = tree->root; n;) {
+        if (nodes[n].key == key)
+            return n;
+
+        n = nodes[n].key > key ? stc_left(n) : stc_right(n);
+    }
+
+    return IA_NIL;
+}
+
+struct ia_node *stc_find(struct stc_tree *tree, int key)
+{
+    uint32_t n = __stc_find(tree, key);
+    return n ? &tree->arena.nodes[n] : NULL;
+}
+
+int stc_remove(struct stc_tree *tree, int key)
+{
+    uint32_t n = __stc_find(tree, key);
+    if (!n)
+        return -1;
+
+    ia_cow(&tree->arena);
+    stc_update(tree, __stc_remove(tree, n));
+    ia_free(&tree->arena, n);
+    return 0;
+}
+
+uint32_t stc_lower_bound(struct stc_tree *tree, int key)
+{
+    struct ia_node *nodes = tree->arena.nodes;
+    uint32_t lb = IA_NIL;
+
+    for (uint32_t n = tree->root; n;) {
+        if (nodes[n].key == key)
+            return n;
+
+        if (nodes[n].key > key) {
+            lb = n;
+            n = stc_left(n);
+        } else {
+            n = stc_right(n);
+        }
+    }
+
+    return lb;
+}
+
+uint32_t stc_next(struct stc_tree *tree, uint32_t n)
+{
+    struct ia_node *nodes = tree->arena.nodes;
+
+    if (stc_right(n))
+        return stc_first(nodes, stc_right(n));
+
+    uint32_t p;
+    while ((p = stc_parent(n)) && n == stc_right(p))
+        n = p;
+
+    return p;
+}
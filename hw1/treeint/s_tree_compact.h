@@ -0,0 +1,35 @@
+#ifndef STREE_COMPACT_H
+#define STREE_COMPACT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+
+/* Compact S-Tree of int keys: the same balancing as s_tree.c, but the nodes
+ * live in an index arena (see arena.h) and take 16 bytes instead of 40. The
+ * hint is kept in the IA_META_BITS of the parent word, saturating at 63,
+ * which is far more than any tree that fits in the arena needs.
+ */
+struct stc_tree {
+    struct ia_arena arena;
+    uint32_t root;
+};
+
+struct stc_tree *stc_create(void);
+void stc_destroy(struct stc_tree *tree);
+int stc_insert(struct stc_tree *tree, int key);
+int stc_remove(struct stc_tree *tree, int key);
+/* The returned node stays valid until the next insertion */
+struct ia_node *stc_find(struct stc_tree *tree, int key);
+
+/* Write the tree to an image file, and map one back as a new tree that is
+ * queried in place, without a rebuild, and copied on write (see ia_map())
+ */
+int stc_save(struct stc_tree *tree, const char *path);
+struct stc_tree *stc_load(const char *path);
+
+/* In-order traversal by index, IA_NIL past the end */
+uint32_t stc_lower_bound(struct stc_tree *tree, int key);
+uint32_t stc_next(struct stc_tree *tree, uint32_t n);
+
+#endif
@@ -0,0 +1,340 @@
+/*
+ * Lock-coupling S-Tree.
+ *
+ * Locks are always taken from the top down: the lock of the tree (standing for
+ * the parent of the root) before the root, and a parent before its child.
+ * Since a parent/child relation can only be changed by a rotation holding the
+ * locks of both nodes, two threads can never wait on each other in opposite
+ * order, and the tree needs no deadlock detection.
+ *
+ * Rotations preserve the set of keys below every node they do not lock, so a
+ * descent holding the lock of any node is never misled by a rotation above.
+ *
+ * The update phase walks up from the inserted node as st_update() does, but
+ * holds no lock on the way. At each step, it locks the parent, validates that
+ * it is still the parent (a rotation may have moved the node in between, in
+ * which case the step is retried), then the node itself and, for a rotation,
+ * the child that rotates up. The hints of the children are read without their
+ * locks: they may be slightly stale, which hints tolerate by design.
+ *
+ * Removal descends with the lock of the parent kept as well, since unlinking a
+ * node takes the locks of both. A node with two children takes the key of its
+ * successor instead, found by a descent that keeps the node locked, and the
+ * successor is unlinked in its place. An unlinked node loses its children and
+ * is marked removed, so that an update walking up through it sees that it is
+ * not the parent of anything anymore, or that there is nothing left to update.
+ * The remover then walks up from the parent of the unlinked node, as after an
+ * insertion, since the subtree lost some height.
+ */
+#include "s_tree_lc.h"
+#include <sched.h>
+#include <stdlib.h>
+#include "common.h"
+#include "ebr.h"
+
+/* Spin that many times on a busy lock before yielding the CPU to its owner */
+#define STL_SPIN_LIMIT 128
+
+static inline void stl_lock(int *lock)
+{
+    while (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE)) {
+        for (int spins = 0; __atomic_load_n(lock, __ATOMIC_RELAXED); spins++) {
+            if (spins >= STL_SPIN_LIMIT)
+                sched_yield();
+        }
+    }
+}
+
+static inline void stl_unlock(int *lock)
+{
+    __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+/* The parents are read without their locks by stl_update(), which may meet a
+ * node that was just inserted.
+ */
+static inline void stl_set_parent(struct stl_node *n, struct stl_node *p)
+{
+    __atomic_store_n(&n->parent, p, __ATOMIC_RELEASE);
+}
+
+/* The lock guarding the link to n, i.e. the one of its parent p */
+static inline int *stl_link_lock(struct stl_tree *tree, struct stl_node *p)
+{
+    return p ? &p->lock : &tree->lock;
+}
+
+struct stl_tree *stl_create(void)
+{
+    return calloc(sizeof(struct stl_tree), 1);
+}
+
+/* see __st_destroy() */
+void stl_destroy(struct stl_tree *tree)
+{
+    struct stl_node *n = tree->root;
+
+    /* Nodes retired by this thread are not linked anymore */
+    ebr_flush_local();
+
+    while (n) {
+        struct stl_node *l = n->left;
+
+        if (l) {
+            n->left = l->right;
+            l->right = n;
+            n = l;
+        } else {
+            struct stl_node *r = n->right;
+            free(n);
+            n = r;
+        }
+    }
+
+    free(tree);
+}
+
+/* Descend hand over hand to key. Return the node holding key with its lock
+ * held, and the lock guarding the link to it as well if keep_parent, or NULL
+ * with the lock of the would-be parent held. *parent and *link tell where the
+ * node is, or where to attach a new one.
+ */
+static struct stl_node *stl_lookup(struct stl_tree *tree,
+                                   int key,
+                                   bool keep_parent,
+                                   struct stl_node **parent,
+                                   struct stl_node ***link)
+{
+    struct stl_node *p = NULL, *n, **l = &tree->root;
+
+    stl_lock(&tree->lock);
+    for (n = *l; n; n = *l) {
+        stl_lock(&n->lock);
+        if (n->key == key)
+            break;
+        stl_unlock(stl_link_lock(tree, p));
+
+        p = n;
+        l = key < n->key ? &n->left : &n->right;
+    }
+
+    if (n && !keep_parent)
+        stl_unlock(stl_link_lock(tree, p));
+
+    *parent = p;
+    *link = l;
+    return n;
+}
+
+static inline int stl_child_hint(struct stl_node *c)
+{
+    return c ? READ_ONCE(c->hint) + 1 : 0;
+}
+
+static inline int stl_balance(struct stl_node *n)
+{
+    return stl_child_hint(n->left) - stl_child_hint(n->right);
+}
+
+static inline int stl_max_hint(struct stl_node *n)
+{
+    int l = stl_child_hint(n->left), r = stl_child_hint(n->right);
+
+    return l > r ? l : r;
+}
+
+/* Rotate the left child l of n up, with p (or the tree), n and l locked */
+static void stl_rotate_left(struct stl_tree *tree,
+                            struct stl_node *p,
+                            struct stl_node *n,
+                            struct stl_node *l)
+{
+    stl_set_parent(l, p);
+    n->left = l->right;
+    stl_set_parent(n, l);
+    l->right = n;
+
+    if (!p)
+        tree->root = l;
+    else if (p->left == n)
+        p->left = l;
+    else
+        p->right = l;
+
+    if (n->left)
+        stl_set_parent(n->left, n);
+}
+
+static void stl_rotate_right(struct stl_tree *tree,
+                             struct stl_node *p,
+                             struct stl_node *n,
+                             struct stl_node *r)
+{
+    stl_set_parent(r, p);
+    n->right = r->left;
+    stl_set_parent(n, r);
+    r->left = n;
+
+    if (!p)
+        tree->root = r;
+    else if (p->left == n)
+        p->left = r;
+    else
+        p->right = r;
+
+    if (n->right)
+        stl_set_parent(n->right, n);
+}
+
+static void stl_update(struct stl_tree *tree, struct stl_node *n)
+{
+    while (n) {
+        struct stl_node *p = __atomic_load_n(&n->parent, __ATOMIC_ACQUIRE);
+        int *plock = stl_link_lock(tree, p);
+
+        stl_lock(plock);
+        if (p ? (p->left != n && p->right != n) : tree->root != n) {
+            /* n was rotated away from p in the meantime, or removed, which
+             * leaves its remover to update its former parents
+             */
+            stl_unlock(plock);
+            if (__atomic_load_n(&n->removed, __ATOMIC_ACQUIRE))
+                break;
+            continue;
+        }
+        stl_lock(&n->lock);
+
+        int b = stl_balance(n);
+        int prev_hint = n->hint;
+        struct stl_node *c = NULL;
+
+        if (b < -1) {
+            /* leaning to the right */
+            c = n->right;
+            stl_lock(&c->lock);
+            stl_rotate_right(tree, p, n, c);
+        } else if (b > 1) {
+            /* leaning to the left */
+            c = n->left;
+            stl_lock(&c->lock);
+            stl_rotate_left(tree, p, n, c);
+        }
+
+        int hint = stl_max_hint(n);
+        WRITE_ONCE(n->hint, hint);
+        if (c) {
+            /* c is locked anyway, so bring its hint up to date as well */
+            WRITE_ONCE(c->hint, stl_max_hint(c));
+            stl_unlock(&c->lock);
+        }
+
+        stl_unlock(&n->lock);
+        stl_unlock(plock);
+
+        if (hint != 0 && hint == prev_hint)
+            break;
+
+        n = p;
+    }
+}
+
+int stl_insert(struct stl_tree *tree, int key)
+{
+    struct stl_node *p, **link;
+    struct stl_node *n = stl_lookup(tree, key, false, &p, &link);
+
+    if (n) {
+        stl_unlock(&n->lock);
+        return -1;
+    }
+
+    n = calloc(sizeof(struct stl_node), 1);
+    if (!n) {
+        stl_unlock(stl_link_lock(tree, p));
+        return -1;
+    }
+
+    n->key = key;
+    n->parent = p;
+    *link = n;
+    __atomic_fetch_add(&tree->nr_nodes, 1, __ATOMIC_RELAXED);
+
+    /* n may be removed and retired as soon as the link is unlocked */
+    ebr_read_lock();
+    stl_unlock(stl_link_lock(tree, p));
+    stl_update(tree, n);
+    ebr_read_unlock();
+    return 0;
+}
+
+int stl_remove(struct stl_tree *tree, int key)
+{
+    struct stl_node *p, **link;
+    struct stl_node *n = stl_lookup(tree, key, true, &p, &link);
+    int *plock = stl_link_lock(tree, p);
+
+    if (!n) {
+        stl_unlock(plock);
+        return -1;
+    }
+
+    struct stl_node *del = n;
+    if (n->left && n->right) {
+        /* n stays, the link to it is left alone */
+        stl_unlock(plock);
+
+        p = n;
+        link = &n->right;
+        del = n->right;
+        stl_lock(&del->lock);
+        while (del->left) {
+            struct stl_node *l = del->left;
+
+            stl_lock(&l->lock);
+            if (p != n)
+                stl_unlock(&p->lock);
+            p = del;
+            link = &del->left;
+            del = l;
+        }
+
+        n->key = del->key;
+        plock = &p->lock;
+    }
+
+    /* del has one child at most, and both it and the link to it are locked */
+    struct stl_node *c = del->left ? del->left : del->right;
+    *link = c;
+    if (c)
+        stl_set_parent(c, p);
+    del->left = del->right = NULL;
+    __atomic_store_n(&del->removed, true, __ATOMIC_RELEASE);
+    __atomic_fetch_sub(&tree->nr_nodes, 1, __ATOMIC_RELAXED);
+
+    /* p may be removed and retired as soon as it is unlocked */
+    ebr_read_lock();
+    stl_unlock(&del->lock);
+    if (p != n)
+        stl_unlock(plock);
+    if (del != n)
+        stl_unlock(&n->lock);
+    ebr_retire_local(del);
+
+    stl_update(tree, p);
+    ebr_read_unlock();
+    return 0;
+}
+
+struct stl_node *stl_find(struct stl_tree *tree, int key)
+{
+    struct stl_node *p, **link;
+    struct stl_node *n = stl_lookup(tree, key, false, &p, &link);
+
+    if (!n) {
+        stl_unlock(stl_link_lock(tree, p));
+        return NULL;
+    }
+
+    stl_unlock(&n->lock);
+    return n;
+}
@@ -0,0 +1,46 @@
+#ifndef STREE_LC_H
+#define STREE_LC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Concurrent S-Tree of int keys with per-node locks.
+ *
+ * Every operation descends hand over hand (lock coupling): the lock of a
+ * child is taken before the one of its parent is dropped, so threads working
+ * in disjoint parts of the tree only meet at the top levels, and briefly.
+ * The update phase after an insertion locks nothing but the neighbourhood of
+ * each step, see stl_update().
+ *
+ * Removal unlinks the node under the locks of its parent and of itself, or
+ * moves the key of its successor into it and unlinks the successor instead.
+ * The update phase walks up through the parents without their locks, so the
+ * unlinked nodes are freed through ebr_retire_local(), and updates run in a
+ * read section.
+ */
+struct stl_node {
+    int key;
+    short hint;
+    bool removed; /* unlinked, see stl_update() */
+    int lock;
+    struct stl_node *parent;
+    struct stl_node *left, *right;
+};
+
+struct stl_tree {
+    struct stl_node *root;
+    int lock; /* guards the root link, taken as the lock of its parent */
+    size_t nr_nodes;
+};
+
+struct stl_tree *stl_create(void);
+/* Not thread-safe, all the other threads must be done with the tree */
+void stl_destroy(struct stl_tree *tree);
+int stl_insert(struct stl_tree *tree, int key);
+int stl_remove(struct stl_tree *tree, int key);
+/* The node may be removed as soon as it is returned: only tell whether the key
+ * was found, unless the caller knows that nobody removes it.
+ */
+struct stl_node *stl_find(struct stl_tree *tree, int key);
+
+#endif
@@ -0,0 +1,343 @@
+/*
+ * Persistent S-Tree.
+ *
+ * An update first takes a reference to the current root for the version it
+ * builds, then makes each node it is about to modify private to that version
+ * (see stp_own()), which copies the shared ones. A node is private to the
+ * update that created it, as told by its generation: the generations come
+ * from a global counter, so that trees sharing nodes through snapshots never
+ * mistake the nodes of one another for their own. The copies replace the
+ * originals in the new version only, the old one keeps all of its nodes until
+ * its root is dropped, once the new root is published.
+ *
+ * Without parent links, the path of an update is kept in a stack of links on
+ * the way down, and the hints are recomputed on the way back up. Since every
+ * update walks back up its whole path, the hints stay exact heights, and the
+ * tree is rebalanced by the rules of AVL trees, double rotations included, so
+ * that an update copies O(log n) nodes at most. A rotation copies the child it
+ * lifts as well, and the grandchild moving to the other side for a double
+ * rotation, the subtrees below them being shared.
+ */
+#include "s_tree_persistent.h"
+#include <assert.h>
+#include <stdlib.h>
+#include "common.h"
+#include "ebr.h"
+
+/* Longest path of an AVL tree of 2^32 keys, about 1.44 * 32 nodes */
+#define STP_MAX_HEIGHT 64
+
+static unsigned long stp_gen;
+
+static struct stp_node *stp_alloc(int key, unsigned long gen)
+{
+    struct stp_node *n = malloc(sizeof(struct stp_node));
+    assert(n);
+
+    n->gen = gen;
+    n->left = n->right = NULL;
+    n->key = key;
+    n->ref = 1;
+    n->hint = 0;
+    return n;
+}
+
+static inline void stp_get(struct stp_node *n)
+{
+    if (n)
+        __atomic_add_fetch(&n->ref, 1, __ATOMIC_RELAXED);
+}
+
+/* Drop a reference to n, then the references of n to its children once it
+ * has none left. ebr_retire_local() only flushes at the end of a read section,
+ * so this runs in one.
+ */
+static void stp_put(struct stp_node *n)
+{
+    while (n && !__atomic_sub_fetch(&n->ref, 1, __ATOMIC_ACQ_REL)) {
+        struct stp_node *r = n->right;
+
+        stp_put(n->left);
+        ebr_retire_local(n);
+        n = r;
+    }
+}
+
+/* Make the node at *link private to the update gen, so that it can be
+ * modified in place. A shared node is replaced by a copy, which takes over the
+ * reference of *link to it and shares its children. The reference dropped
+ * never is the last one: the version the update started from still holds the
+ * node, and is only released after the new one is published.
+ */
+static struct stp_node *stp_own(struct stp_node **link, unsigned long gen)
+{
+    struct stp_node *n = *link, *c;
+
+    if (n->gen == gen)
+        return n;
+
+    c = stp_alloc(n->key, gen);
+    c->left = n->left;
+    c->right = n->right;
+    c->hint = n->hint;
+    stp_get(c->left);
+    stp_get(c->right);
+    __atomic_sub_fetch(&n->ref, 1, __ATOMIC_RELAXED);
+
+    *link = c;
+    return c;
+}
+
+static inline int stp_height(struct stp_node *n)
+{
+    return n ? n->hint + 1 : 0;
+}
+
+static inline int stp_balance(struct stp_node *n)
+{
+    return stp_height(n->left) - stp_height(n->right);
+}
+
+static inline int stp_max_hint(struct stp_node *n)
+{
+    int l = stp_height(n->left), r = stp_height(n->right);
+
+    return l > r ? l : r;
+}
+
+/* Lift the left child of the subtree at *link, as st_rotate_left() does */
+static void stp_rotate_left(struct stp_node **link, unsigned long gen)
+{
+    struct stp_node *n = stp_own(link, gen);
+    struct stp_node *l = stp_own(&n->left, gen);
+
+    n->left = l->right;
+    l->right = n;
+    *link = l;
+
+    n->hint = stp_max_hint(n);
+    l->hint = stp_max_hint(l);
+}
+
+/* Lift the right child of the subtree at *link */
+static void stp_rotate_right(struct stp_node **link, unsigned long gen)
+{
+    struct stp_node *n = stp_own(link, gen);
+    struct stp_node *r = stp_own(&n->right, gen);
+
+    n->right = r->left;
+    r->left = n;
+    *link = r;
+
+    n->hint = stp_max_hint(n);
+    r->hint = stp_max_hint(r);
+}
+
+/* The node at *link is private, its subtrees are balanced */
+static void stp_rebalance(struct stp_node **link, unsigned long gen)
+{
+    struct stp_node *n = *link;
+    int b = stp_balance(n);
+
+    if (b > 1) {
+        /* leaning to the left */
+        if (stp_balance(n->left) < 0)
+            stp_rotate_right(&n->left, gen);
+        stp_rotate_left(link, gen);
+    } else if (b < -1) {
+        /* leaning to the right */
+        if (stp_balance(n->right) > 0)
+            stp_rotate_left(&n->right, gen);
+        stp_rotate_right(link, gen);
+    } else {
+        n->hint = stp_max_hint(n);
+    }
+}
+
+struct stp_tree *stp_create(void)
+{
+    struct stp_tree *tree = calloc(sizeof(struct stp_tree), 1);
+    if (!tree)
+        return NULL;
+
+    pthread_mutex_init(&tree->lock, NULL);
+    return tree;
+}
+
+void stp_destroy(struct stp_tree *tree)
+{
+    ebr_read_lock();
+    stp_put(tree->root);
+    ebr_read_unlock();
+
+    pthread_mutex_destroy(&tree->lock);
+    free(tree);
+}
+
+/* The writers are locked out just long enough to take the reference, which
+ * the root cannot lose in the meantime.
+ */
+struct stp_tree *stp_snapshot(struct stp_tree *tree)
+{
+    struct stp_tree *snap = stp_create();
+    if (!snap)
+        return NULL;
+
+    pthread_mutex_lock(&tree->lock);
+    snap->root = tree->root;
+    snap->nr = tree->nr;
+    stp_get(snap->root);
+    pthread_mutex_unlock(&tree->lock);
+
+    return snap;
+}
+
+static struct stp_node *__stp_find(struct stp_node *n, int key)
+{
+    while (n && n->key != key)
+        n = key < n->key ? n->left : n->right;
+
+    return n;
+}
+
+struct stp_node *stp_find(struct stp_tree *tree, int key)
+{
+    return __stp_find(__atomic_load_n(&tree->root, __ATOMIC_ACQUIRE), key);
+}
+
+/* Publish root in place of old, and drop the reference of the tree to old once
+ * the writers are let in again.
+ */
+static void stp_publish(struct stp_tree *tree,
+                        struct stp_node *root,
+                        struct stp_node *old)
+{
+    __atomic_store_n(&tree->root, root, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&tree->lock);
+
+    ebr_read_lock();
+    stp_put(old);
+    ebr_read_unlock();
+}
+
+int stp_insert(struct stp_tree *tree, int key)
+{
+    struct stp_node **path[STP_MAX_HEIGHT];
+    int depth = 0;
+
+    pthread_mutex_lock(&tree->lock);
+
+    /* Only copy the path once the key is known to be missing */
+    struct stp_node *old = tree->root, *root = old, **link = &root;
+    if (__stp_find(old, key)) {
+        pthread_mutex_unlock(&tree->lock);
+        return -1;
+    }
+
+    unsigned long gen = __atomic_add_fetch(&stp_gen, 1, __ATOMIC_RELAXED);
+    stp_get(root);
+
+    while (*link) {
+        struct stp_node *n = stp_own(link, gen);
+
+        path[depth++] = link;
+        link = key < n->key ? &n->left : &n->right;
+    }
+    *link = stp_alloc(key, gen);
+
+    while (depth--)
+        stp_rebalance(path[depth], gen);
+
+    tree->nr++;
+    stp_publish(tree, root, old);
+    return 0;
+}
+
+int stp_remove(struct stp_tree *tree, int key)
+{
+    struct stp_node **path[STP_MAX_HEIGHT];
+    int depth = 0;
+
+    pthread_mutex_lock(&tree->lock);
+
+    struct stp_node *old = tree->root, *root = old, **link = &root;
+    if (!__stp_find(old, key)) {
+        pthread_mutex_unlock(&tree->lock);
+        return -1;
+    }
+
+    unsigned long gen = __atomic_add_fetch(&stp_gen, 1, __ATOMIC_RELAXED);
+    stp_get(root);
+
+    struct stp_node *n;
+    for (;;) {
+        n = stp_own(link, gen);
+        if (n->key == key)
+            break;
+
+        path[depth++] = link;
+        link = key < n->key ? &n->left : &n->right;
+    }
+
+    if (n->left && n->right) {
+        /* The private copy of the node takes the key of its successor, which
+         * is removed instead.
+         */
+        struct stp_node *del = n;
+
+        path[depth++] = link;
+        link = &n->right;
+        while (stp_own(link, gen)->left) {
+            path[depth++] = link;
+            link = &(*link)->left;
+        }
+
+        n = *link;
+        del->key = n->key;
+    }
+
+    /* n is private and was never published, its one child moves up */
+    *link = n->left ? n->left : n->right;
+    free(n);
+
+    while (depth--)
+        stp_rebalance(path[depth], gen);
+
+    tree->nr--;
+    stp_publish(tree, root, old);
+    return 0;
+}
+
+static size_t __stp_range(struct stp_node *n,
+                          int lo,
+                          int hi,
+                          void (*cb)(int key, void *arg),
+                          void *arg)
+{
+    size_t nr = 0;
+
+    while (n) {
+        if (n->key < lo) {
+            n = n->right;
+        } else if (n->key > hi) {
+            n = n->left;
+        } else {
+            nr += __stp_range(n->left, lo, hi, cb, arg);
+            cb(n->key, arg);
+            nr++;
+            n = n->right;
+        }
+    }
+
+    return nr;
+}
+
+size_t stp_range(struct stp_tree *tree,
+                 int lo,
+                 int hi,
+                 void (*cb)(int key, void *arg),
+                 void *arg)
+{
+    return __stp_range(__atomic_load_n(&tree->root, __ATOMIC_ACQUIRE), lo, hi,
+                       cb, arg);
+}
@@ -0,0 +1,56 @@
+#ifndef STREE_PERSISTENT_H
+#define STREE_PERSISTENT_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+/* Persistent S-Tree of int keys.
+ *
+ * The nodes have no parent links and are never modified once a version of the
+ * tree holding them has been published. An update copies the nodes on its path
+ * from the root instead, and publishes a new root sharing every other subtree
+ * with the version before it. Each node counts the parents and roots pointing
+ * to it, and is freed once the last of them goes away, so that a snapshot is
+ * nothing more than one more reference to the current root.
+ *
+ * Lookups and scans never lock: they load the root once and see a consistent
+ * version of the tree, whatever the writers do meanwhile. Writers of the same
+ * tree are serialized by its lock. Since a lockless reader may still walk an
+ * old version whose last reference was just dropped, the nodes are freed
+ * through ebr_retire_local(), and such readers must run in a read section.
+ */
+struct stp_node {
+    unsigned long gen; /* update that created the node, see stp_own() */
+    struct stp_node *left, *right;
+    int key;
+    unsigned int ref; /* parents and roots pointing to the node */
+    short hint;
+};
+
+struct stp_tree {
+    struct stp_node *root;
+    size_t nr; /* number of keys */
+    pthread_mutex_t lock; /* serializes the writers */
+};
+
+struct stp_tree *stp_create(void);
+/* Drop the reference of the tree to its root, any snapshot keeps its nodes */
+void stp_destroy(struct stp_tree *tree);
+/* A new tree holding the current keys of tree, in O(1): the two share all
+ * their nodes, and later updates of either leave the other unchanged
+ */
+struct stp_tree *stp_snapshot(struct stp_tree *tree);
+int stp_insert(struct stp_tree *tree, int key);
+int stp_remove(struct stp_tree *tree, int key);
+/* The node stays valid until the end of the read section */
+struct stp_node *stp_find(struct stp_tree *tree, int key);
+/* Visit the keys in [lo, hi] in order, all from the same version of the tree,
+ * and return how many
+ */
+size_t stp_range(struct stp_tree *tree,
+                 int lo,
+                 int hi,
+                 void (*cb)(int key, void *arg),
+                 void *arg);
+
+#endif
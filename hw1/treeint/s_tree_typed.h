@@ -0,0 +1,121 @@
+#ifndef STREE_TYPED_H
+#define STREE_TYPED_H
+
+#include <stdlib.h>
+#include "common.h"
+#include "s_tree.h"
+
+/* ST_DEFINE() generates an S-Tree specialized for a concrete key type.
+ *
+ * The generic st_tree reaches the key of a node through the cmp_t callback,
+ * so every step of the descent pays for an indirect call and a trip through
+ * void *. The specialized tree keeps the key next to the st_node links and
+ * evaluates cmp_expr in place, which lets the compiler inline the comparison
+ * into the search loop. Only the descent is generated: linking, removal and
+ * rebalancing are shared with the generic tree through st_link()/st_erase().
+ *
+ * cmp_expr is evaluated with the key of the visited node bound to 'a' and the
+ * searched key bound to 'b'. It must follow the convention of cmp_t, i.e. be
+ * positive when a sorts after b. For example:
+ *
+ *     ST_DEFINE(st_int, int, (a > b) - (a < b))
+ */
+#define ST_DEFINE(name, key_t, cmp_expr)                                     \
+    struct name##_node {                                                     \
+        key_t key;                                                           \
+        struct st_node st_n;                                                 \
+    };                                                                       \
+                                                                             \
+    struct name##_tree {                                                     \
+        struct st_node *root;                                                \
+    };                                                                       \
+                                                                             \
+    static inline struct name##_node *name##_entry(struct st_node *n)        \
+    {                                                                        \
+        return container_of(n, struct name##_node, st_n);                    \
+    }                                                                        \
+                                                                             \
+    static inline int name##_cmp(key_t a, key_t b)                           \
+    {                                                                        \
+        return (cmp_expr);                                                   \
+    }                                                                        \
+                                                                             \
+    static inline void name##_init(struct name##_tree *tree)                 \
+    {                                                                        \
+        tree->root = NULL;                                                   \
+    }                                                                        \
+                                                                             \
+    static inline struct name##_node *name##_find(struct name##_tree *tree,  \
+                                                  key_t key)                 \
+    {                                                                        \
+        for (struct st_node *n = st_root(tree); n;) {                        \
+            int cmp = name##_cmp(name##_entry(n)->key, key);                 \
+            if (cmp == 0)                                                    \
+                return name##_entry(n);                                      \
+            n = cmp > 0 ? st_left(n) : st_right(n);                          \
+        }                                                                    \
+        return NULL;                                                         \
+    }                                                                        \
+                                                                             \
+    static inline int name##_insert(struct name##_tree *tree, key_t key)     \
+    {                                                                        \
+        struct st_node *p = NULL;                                            \
+        enum st_dir d = ST_NONE;                                             \
+                                                                             \
+        for (struct st_node *n = st_root(tree); n;) {                        \
+            int cmp = name##_cmp(name##_entry(n)->key, key);                 \
+            if (cmp == 0)                                                    \
+                return -1;                                                   \
+            p = n;                                                           \
+            if (cmp > 0) {                                                   \
+                n = st_left(n);                                              \
+                d = ST_LEFT;                                                 \
+            } else {                                                         \
+                n = st_right(n);                                             \
+                d = ST_RIGHT;                                                \
+            }                                                                \
+        }                                                                    \
+                                                                             \
+        struct name##_node *i = calloc(sizeof(struct name##_node), 1);       \
+        if (!i)                                                              \
+            return -1;                                                       \
+        i->key = key;                                                        \
+        st_link(&st_root(tree), p, &i->st_n, d);                             \
+        return 0;                                                            \
+    }                                                                        \
+                                                                             \
+    static inline int name##_remove(struct name##_tree *tree, key_t key)     \
+    {                                                                        \
+        struct name##_node *i = name##_find(tree, key);                      \
+        if (!i)                                                              \
+            return -1;                                                       \
+                                                                             \
+        st_erase(&st_root(tree), &i->st_n);                                  \
+        free(i);                                                             \
+        return 0;                                                            \
+    }                                                                        \
+                                                                             \
+    /* see __st_destroy() */                                                 \
+    static inline void __##name##_destroy(struct st_node *n)                 \
+    {                                                                        \
+        while (n) {                                                          \
+            struct st_node *l = st_left(n);                                  \
+            if (l) {                                                         \
+                st_left(n) = st_right(l);                                    \
+                st_right(l) = n;                                             \
+                n = l;                                                       \
+            } else {                                                         \
+                struct st_node *r = st_right(n);                             \
+                free(name##_entry(n));                                       \
+                n = r;                                                       \
+            }                                                                \
+        }                                                                    \
+    }                                                                        \
+                                                                             \
+    static inline void name##_destroy(struct name##_tree *tree)              \
+    {                                                                        \
+        __##name##_destroy(st_root(tree));                                   \
+        tree->root = NULL;                                                   \
+    }
+
+#endif
@@ -0,0 +1,38 @@
+#!/usr/bin/env python3
+
+import numpy as np
+import matplotlib.pyplot as plt
+import os
+
+def bench(algo, threads, n, seed):
+    binary = 'build/treeint'
+
+    # the line of -p is the third one: insertions, lookups, then -p
+    out = os.popen(f"./{binary} -p -j {threads} {algo} {n} {seed}").read()
+    keys, insert, find, remove = map(int, out.splitlines()[2].split(','))
+
+    # operations per second of each step
+    return [keys * 1e9 / insert, keys * 1e9 / find, keys * 1e9 / remove]
+
+# make sure we do make before everything start
+os.system("make")
+
+# the locked trees run behind one mutex, see treeint_ops.concurrent
+algo_list=["rbtree", "s-tree", "rbtree-seq", "s-tree-lc", "skiplist"]
+nthreads = [1, 2, 4, 8, 16, 32, 64]
+n = 1000000
+ts = np.array([[bench(algo, j, n, 1) for j in nthreads] for algo in algo_list])
+
+pat_name = ["insert", "find", "remove"]
+fig, ax = plt.subplots(3, figsize=(6, 10))
+for pat in range(0, 3):
+    for idx, t in enumerate(ts):
+        ax[pat].plot(nthreads, t[:,pat], label=algo_list[idx])
+    ax[pat].set_title(pat_name[pat])
+    ax[pat].set_xscale('log', base=2)
+    ax[pat].set_ylim(bottom=0, top=None)
+    ax[pat].legend()
+
+plt.ylabel('Throughput(ops/s)')
+plt.xlabel('Threads')
+plt.show()
@@ -0,0 +1,50 @@
+#ifndef SEQCOUNT_H
+#define SEQCOUNT_H
+
+#include "common.h"
+
+/* Sequence counter, after the Linux seqcount_t.
+ *
+ * Writers, which must be serialized by other means, make the counter odd for
+ * the duration of a modification. A reader samples the counter, reads the
+ * protected data without any lock, and retries if the counter was odd or has
+ * moved in the meantime, since it may then have observed a half-done update.
+ * Unlike the Linux read_seqcount_begin(), raw_read_seqcount() does not wait
+ * for a writer to finish, so that readers which can validate their result by
+ * themselves (e.g. a lookup that found its key) never wait at all.
+ */
+typedef struct {
+    unsigned int sequence;
+} seqcount_t;
+
+static inline unsigned int raw_read_seqcount(const seqcount_t *s)
+{
+    return __atomic_load_n(&s->sequence, __ATOMIC_ACQUIRE);
+}
+
+static inline int read_seqcount_retry(const seqcount_t *s, unsigned int start)
+{
+    /* order the reads of the data before the second read of the counter */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return unlikely((start & 1) ||
+                    __atomic_load_n(&s->sequence, __ATOMIC_RELAXED) != start);
+}
+
+/* No fence here: the data must be updated with release stores, so that a
+ * reader which sees any of them also sees the counter made odd here.
+ */
+static inline void write_seqcount_begin(seqcount_t *s)
+{
+    unsigned int seq = __atomic_load_n(&s->sequence, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&s->sequence, seq + 1, __ATOMIC_RELAXED);
+}
+
+static inline void write_seqcount_end(seqcount_t *s)
+{
+    unsigned int seq = __atomic_load_n(&s->sequence, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&s->sequence, seq + 1, __ATOMIC_RELEASE);
+}
+
+#endif
@@ -0,0 +1,286 @@
+/*
+ * Lock-free skip list.
+ *
+ * A node is gone from the set once the link on its bottom level is marked, but
+ * it is only safe to free once it is unlinked from every level, which two
+ * threads may still be busy with: its remover, which walks the path to the key
+ * once more to unlink it, and its inserter, which may be linking an upper
+ * level while the node is being removed. Each holds a reference, and the last
+ * one to let go retires the node, see sl_release().
+ *
+ * After that point no link can lead to the node anymore: a marked node is
+ * never used as a predecessor, so the node cannot be hanging behind another
+ * removed one, and the inserter checks for a removal after linking its last
+ * level. Threads that picked up a pointer to the node before are covered by
+ * the grace period of epoch-based reclamation.
+ */
+#include "skiplist.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include "common.h"
+#include "ebr.h"
+
+#define SL_MARK 1UL
+
+static inline struct sl_node *sl_ptr(uintptr_t link)
+{
+    return (struct sl_node *) (link & ~SL_MARK);
+}
+
+static inline uintptr_t sl_load(uintptr_t *link)
+{
+    return __atomic_load_n(link, __ATOMIC_ACQUIRE);
+}
+
+static inline bool sl_cas(uintptr_t *link, uintptr_t old, uintptr_t new)
+{
+    return __atomic_compare_exchange_n(link, &old, new, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+/* Geometric distribution of ratio 1/2, from a per-thread xorshift generator */
+static int sl_random_height(void)
+{
+    static __thread uint32_t seed;
+
+    if (unlikely(!seed))
+        seed = (uint32_t) (uintptr_t) &seed | 1;
+
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    return __builtin_ctz(seed | (1U << (SL_MAX_LEVEL - 1))) + 1;
+}
+
+static struct sl_node *sl_node_alloc(int key, int height)
+{
+    struct sl_node *node =
+        malloc(sizeof(struct sl_node) + height * sizeof(uintptr_t));
+    if (!node)
+        return NULL;
+
+    node->key = key;
+    node->height = height;
+    node->refs = 2;
+    return node;
+}
+
+struct skiplist *sl_create(void)
+{
+    struct skiplist *sl = calloc(sizeof(struct skiplist), 1);
+    if (!sl)
+        return NULL;
+
+    sl->head = sl_node_alloc(0, SL_MAX_LEVEL);
+    if (!sl->head) {
+        free(sl);
+        return NULL;
+    }
+    for (int level = 0; level < SL_MAX_LEVEL; level++)
+        sl->head->next[level] = 0;
+
+    return sl;
+}
+
+void sl_destroy(struct skiplist *sl)
+{
+    /* Nodes retired by this thread may not be linked anymore */
+    ebr_flush_local();
+
+    struct sl_node *node = sl->head;
+    while (node) {
+        struct sl_node *next = sl_ptr(node->next[0]);
+        free(node);
+        node = next;
+    }
+
+    free(sl);
+}
+
+/* Drop the reference of the inserter or of the remover of a removed node */
+static void sl_release(struct sl_node *node)
+{
+    if (__atomic_sub_fetch(&node->refs, 1, __ATOMIC_ACQ_REL) == 0)
+        ebr_retire_local(node);
+}
+
+/* Find the predecessor and successor of key on every level, unlinking the
+ * marked nodes met on the way. Return whether succs[0] holds key.
+ */
+static bool sl_search(struct skiplist *sl,
+                      int key,
+                      struct sl_node **preds,
+                      struct sl_node **succs)
+{
+    struct sl_node *pred, *curr;
+
+retry:
+    pred = sl->head;
+    for (int level = SL_MAX_LEVEL - 1; level >= 0; level--) {
+        curr = sl_ptr(sl_load(&pred->next[level]));
+
+        while (curr) {
+            uintptr_t succ = sl_load(&curr->next[level]);
+
+            if (succ & SL_MARK) {
+                /* pred may have been marked or relinked in the meantime */
+                if (!sl_cas(&pred->next[level], (uintptr_t) curr,
+                            succ & ~SL_MARK))
+                    goto retry;
+                curr = sl_ptr(succ);
+                continue;
+            }
+
+            if (curr->key >= key)
+                break;
+
+            pred = curr;
+            curr = sl_ptr(succ);
+        }
+
+        preds[level] = pred;
+        succs[level] = curr;
+    }
+
+    return curr && curr->key == key;
+}
+
+int sl_insert(struct skiplist *sl, int key)
+{
+    struct sl_node *preds[SL_MAX_LEVEL], *succs[SL_MAX_LEVEL];
+    struct sl_node *node = NULL;
+    int ret = -1;
+
+    ebr_read_lock();
+
+    do {
+        if (sl_search(sl, key, preds, succs))
+            goto out;
+
+        if (!node) {
+            node = sl_node_alloc(key, sl_random_height());
+            if (!node)
+                goto out;
+        }
+        for (int level = 0; level < node->height; level++)
+            node->next[level] = (uintptr_t) succs[level];
+    } while (!sl_cas(&preds[0]->next[0], (uintptr_t) succs[0],
+                     (uintptr_t) node));
+
+    /* The node is in the set, the upper levels only speed up the searches */
+    __atomic_fetch_add(&sl->nr_nodes, 1, __ATOMIC_RELAXED);
+    ret = 0;
+
+    for (int level = 1; level < node->height; level++) {
+        for (;;) {
+            uintptr_t next = sl_load(&node->next[level]);
+
+            /* Stop as soon as a remover started marking the node */
+            if (next & SL_MARK)
+                goto linked;
+            if (sl_ptr(next) != succs[level] &&
+                !sl_cas(&node->next[level], next, (uintptr_t) succs[level]))
+                goto linked;
+
+            if (sl_cas(&preds[level]->next[level], (uintptr_t) succs[level],
+                       (uintptr_t) node))
+                break;
+
+            sl_search(sl, key, preds, succs);
+            if (succs[0] != node)
+                goto linked;
+        }
+    }
+
+linked:
+    /* A remover may have missed the levels linked after it passed by */
+    if (sl_load(&node->next[0]) & SL_MARK)
+        sl_search(sl, key, preds, succs);
+    sl_release(node);
+    node = NULL;
+
+out:
+    ebr_read_unlock();
+    free(node);
+    return ret;
+}
+
+int sl_remove(struct skiplist *sl, int key)
+{
+    struct sl_node *preds[SL_MAX_LEVEL], *succs[SL_MAX_LEVEL];
+    int ret = -1;
+
+    ebr_read_lock();
+
+    if (!sl_search(sl, key, preds, succs))
+        goto out;
+
+    struct sl_node *node = succs[0];
+
+    for (int level = node->height - 1; level > 0; level--) {
+        uintptr_t next = sl_load(&node->next[level]);
+
+        while (!(next & SL_MARK)) {
+            if (sl_cas(&node->next[level], next, next | SL_MARK))
+                break;
+            next = sl_load(&node->next[level]);
+        }
+    }
+
+    for (;;) {
+        uintptr_t next = sl_load(&node->next[0]);
+
+        if (next & SL_MARK)
+            goto out; /* another remover won */
+        if (sl_cas(&node->next[0], next, next | SL_MARK))
+            break;
+    }
+
+    __atomic_fetch_sub(&sl->nr_nodes, 1, __ATOMIC_RELAXED);
+    ret = 0;
+
+    /* Unlink the node from every level it is linked on */
+    sl_search(sl, key, preds, succs);
+    sl_release(node);
+
+out:
+    ebr_read_unlock();
+    return ret;
+}
+
+/* Read-only descent, marked nodes are stepped over rather than unlinked */
+struct sl_node *sl_lower_bound(struct skiplist *sl, int key)
+{
+    struct sl_node *pred = sl->head, *curr = NULL;
+
+    for (int level = SL_MAX_LEVEL - 1; level >= 0; level--) {
+        curr = sl_ptr(sl_load(&pred->next[level]));
+
+        while (curr && curr->key < key) {
+            pred = curr;
+            curr = sl_ptr(sl_load(&curr->next[level]));
+        }
+    }
+
+    while (curr && (sl_load(&curr->next[0]) & SL_MARK))
+        curr = sl_ptr(sl_load(&curr->next[0]));
+
+    return curr;
+}
+
+struct sl_node *sl_find(struct skiplist *sl, int key)
+{
+    struct sl_node *node = sl_lower_bound(sl, key);
+
+    return node && node->key == key ? node : NULL;
+}
+
+struct sl_node *sl_next(struct sl_node *node)
+{
+    do
+        node = sl_ptr(sl_load(&node->next[0]));
+    while (node && (sl_load(&node->next[0]) & SL_MARK));
+
+    return node;
+}
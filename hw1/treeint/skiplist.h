@@ -0,0 +1,45 @@
+#ifndef SKIPLIST_H
+#define SKIPLIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Lock-free skip list of int keys (Fraser, Herlihy & Shavit).
+ *
+ * Every operation runs inside an EBR read section and never blocks: an
+ * insertion is published by a single CAS on the bottom level, the upper levels
+ * being mere shortcuts linked afterwards, and a removal marks the next
+ * pointers of the node from the top level down, the mark on the bottom level
+ * deciding which remover wins. Marked nodes are unlinked by whichever thread
+ * walks past them next, see sl_search().
+ */
+
+#define SL_MAX_LEVEL 24
+
+struct sl_node {
+    int key;
+    int height;
+    int refs; /* see sl_release() */
+    /* The lowest bit of a link marks the node holding it as removed */
+    uintptr_t next[];
+};
+
+struct skiplist {
+    struct sl_node *head; /* sentinel of SL_MAX_LEVEL levels, key unused */
+    size_t nr_nodes;
+};
+
+struct skiplist *sl_create(void);
+/* Not thread-safe, all the other threads must be done with the list */
+void sl_destroy(struct skiplist *sl);
+int sl_insert(struct skiplist *sl, int key);
+int sl_remove(struct skiplist *sl, int key);
+/* Must be called inside an EBR read section, which the node outlives only if
+ * no one removes it.
+ */
+struct sl_node *sl_find(struct skiplist *sl, int key);
+/* Same, for the first node with a key not less than key */
+struct sl_node *sl_lower_bound(struct skiplist *sl, int key);
+struct sl_node *sl_next(struct sl_node *node);
+
+#endif
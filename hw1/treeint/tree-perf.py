@@ -2,41 +2,34 @@
 
 import numpy as np
 import matplotlib.pyplot as plt
+import csv
 import os
 
-def stat(data):
-    mean, std = data.mean(), data.std()
-    # identify outliers: 2 std = 95%
-    cut_off = std * 2
-    lower, upper = mean - cut_off, mean + cut_off
-    data = data[data > lower]
-    data = data[data < upper]
-
-    return int(data.mean())
-
-def bench(algo, n, seed):
+def bench(algo, n, step, seed):
     binary = 'build/treeint'
 
-    times = os.popen(f"taskset -c 15 ./{binary} {algo} {n} {seed}").read()
-    times = np.fromstring(times, dtype=int, sep=',')
-    times = times[:-1] # remove the last seperator
-    l = int(len(times) / 3)
-    times = times.reshape(l, 3)
-
-    insert = times[:,0]
-    find = times[:,1]
-    remove = times[:,2]
+    # one run grows the tree step keys at a time, and records each phase at
+    # every size it reaches, see -e
+    cmd = f"taskset -c 15 ./{binary} -O csv -e {step} {algo} {n} {seed}"
+    rows = list(csv.DictReader(os.popen(cmd)))
 
-    return [stat(insert), stat(find), stat(remove)]
+    # the median latency is robust to the outliers of a noisy machine
+    return [[int(r["p50"]) for r in rows if r["phase"] == pat]
+            for pat in pat_name]
 
 # make sure we do make before everything start
 os.system("make")
 
-algo_list=["s-tree", "rbtree"]
-nsize = list(k for k in range(50, 100000, 50))
-ts = np.array([[bench(algo, size, size) for size in nsize] for algo in algo_list])
-
+algo_list=["s-tree", "s-tree-finger", "s-tree-typed", "s-tree-compact",
+           "rbtree", "rbtree-compact", "rbtree-os", "rbtree-seq", "s-tree-lc",
+           "s-tree-persistent", "skiplist", "interval-tree", "bptree",
+           "bptree-simd", "art", "roaring", "hashtable"]
 pat_name = ["insert", "find", "remove"]
+step = 50
+nsize = list(range(step, 100000, step))
+ts = np.array([np.transpose(bench(algo, nsize[-1], step, 1))
+               for algo in algo_list])
+
 fig, ax = plt.subplots(3, figsize=(6, 10))
 for pat in range(0, 3):
     for idx, t in enumerate(ts):
@@ -1,11 +1,39 @@
 #include <assert.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 #include "common.h"
+#include "eytzinger.h"
+#include "heap.h"
+#include "hist.h"
+#include "treeint_art.h"
+#include "treeint_bp.h"
+#include "treeint_ht.h"
+#include "treeint_it.h"
 #include "treeint_rb.h"
+#include "treeint_rbc.h"
+#include "treeint_rbo.h"
+#include "treeint_rbs.h"
+#include "treeint_rr.h"
+#include "treeint_sl.h"
 #include "treeint_st.h"
+#include "treeint_stc.h"
+#include "treeint_stl.h"
+#include "treeint_stp.h"
+#include "treeint_stt.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TREEINT_TSC
+#endif
 
 struct treeint_ops {
     void *(*init)();
@@ -14,6 +42,73 @@ struct treeint_ops {
     void *(*find)(void *, int);
     int (*remove)(void *, int);
     void (*dump)(void *ctx, enum dump_mode);
+    /* Optional: find() for nr keys at once, storing the i-th result in out[i],
+     * return how many were found
+     */
+    size_t (*find_batch)(void *ctx, const int *keys, size_t nr, void **out);
+    /* Optional: take a read-only snapshot of the tree as a struct ez_tree */
+    void *(*freeze)(void *ctx);
+    /* Optional: a snapshot of the tree in O(1), itself a tree of the same
+     * algorithm that later updates of either leave unchanged, freed with
+     * destroy()
+     */
+    void *(*snapshot)(void *ctx);
+    /* Optional: write the tree to an image file, and map one back as a tree
+     * queried in place
+     */
+    int (*save)(void *ctx, const char *path);
+    void *(*load)(const char *path);
+    /* Optional: bulk-load an empty tree from sorted, distinct keys */
+    int (*build)(void *ctx, int *keys, size_t nr, int nr_threads);
+    /* Optional: visit the keys in [lo, hi] in order, return how many */
+    size_t (*range)(void *ctx,
+                    int lo,
+                    int hi,
+                    treeint_scan_cb *cb,
+                    void *arg);
+    /* Optional: free the whole tree on up to nr_threads threads */
+    int (*destroy_parallel)(void *ctx, int nr_threads);
+    /* Optional: rebalance once every freq modifications */
+    void (*set_update_freq)(void *ctx, unsigned int freq);
+    /* Optional: splay the keys looked up to the root, saving up budget
+     * rotations per lookup to pay for it
+     */
+    void (*set_lookup_budget)(void *ctx, unsigned int budget);
+    /* Optional: bytes held by the tree */
+    size_t (*memsize)(void *ctx);
+    /* Optional: ctx = ctx op other, other being consumed, and the removal of
+     * the keys in [lo, hi] at once, both on up to nr_threads threads
+     */
+    int (*set_op)(void *ctx,
+                  void *other,
+                  enum treeint_set_op op,
+                  int nr_threads);
+    size_t (*range_delete)(void *ctx, int lo, int hi, int nr_threads);
+    /* Optional: the number of keys less than key, and the k-th smallest key
+     * counting from 0, stored in *key
+     */
+    size_t (*rank)(void *ctx, int key);
+    int (*select)(void *ctx, size_t k, int *key);
+    /* Optional: intervals [start, last], overlap() visiting the start of those
+     * overlapping [lo, hi]
+     */
+    int (*insert_interval)(void *ctx, int start, int last);
+    size_t (*overlap)(void *ctx,
+                      int lo,
+                      int hi,
+                      treeint_scan_cb *cb,
+                      void *arg);
+    /* Optional: priority queue, the smallest key being the most urgent, and
+     * decrease_key() moving key down to new_key
+     */
+    int (*peek_min)(void *ctx, int *key);
+    int (*pop_min)(void *ctx, int *key);
+    int (*decrease_key)(void *ctx, int key, int new_key);
+    /* find() may run concurrently with any operation but destroy(), and
+     * insert()/remove() concurrently with each other. Otherwise, concurrent
+     * benchmarks serialize all the operations behind one mutex.
+     */
+    bool concurrent;
 };
 
 static struct treeint_ops *ops;
@@ -21,22 +116,270 @@ static struct treeint_ops *ops;
 static struct treeint_ops st_ops = {
     .init = treeint_st_init,
     .destroy = treeint_st_destroy,
+    .destroy_parallel = treeint_st_destroy_parallel,
     .insert = treeint_st_insert,
     .find = treeint_st_find,
+    .find_batch = treeint_st_find_batch,
     .remove = treeint_st_remove,
+    .range = treeint_st_range,
+    .set_update_freq = treeint_st_set_update_freq,
+    .set_lookup_budget = treeint_st_set_lookup_budget,
     .dump = treeint_st_dump,
+    .freeze = treeint_st_freeze,
+    .build = treeint_st_build,
+    .memsize = treeint_st_memsize,
+};
+
+/* The S-tree, its insertions and lookups starting from the last key touched */
+static struct treeint_ops stf_ops = {
+    .init = treeint_st_init,
+    .destroy = treeint_st_destroy,
+    .destroy_parallel = treeint_st_destroy_parallel,
+    .insert = treeint_st_finger_insert,
+    .find = treeint_st_finger_find,
+    .find_batch = treeint_st_find_batch,
+    .remove = treeint_st_finger_remove,
+    .range = treeint_st_range,
+    .set_update_freq = treeint_st_set_update_freq,
+    .set_lookup_budget = treeint_st_set_lookup_budget,
+    .dump = treeint_st_dump,
+    .freeze = treeint_st_freeze,
+    .build = treeint_st_build,
+    .memsize = treeint_st_memsize,
+};
+
+static struct treeint_ops stt_ops = {
+    .init = treeint_stt_init,
+    .destroy = treeint_stt_destroy,
+    .insert = treeint_stt_insert,
+    .find = treeint_stt_find,
+    .remove = treeint_stt_remove,
+    .dump = treeint_stt_dump,
+    .memsize = treeint_stt_memsize,
+};
+
+static struct treeint_ops stc_ops = {
+    .init = treeint_stc_init,
+    .destroy = treeint_stc_destroy,
+    .insert = treeint_stc_insert,
+    .find = treeint_stc_find,
+    .remove = treeint_stc_remove,
+    .save = treeint_stc_save,
+    .load = treeint_stc_load,
+    .range = treeint_stc_range,
+    .dump = treeint_stc_dump,
+    .memsize = treeint_stc_memsize,
+};
+
+static struct treeint_ops stl_ops = {
+    .init = treeint_stl_init,
+    .destroy = treeint_stl_destroy,
+    .insert = treeint_stl_insert,
+    .find = treeint_stl_find,
+    .remove = treeint_stl_remove,
+    .dump = treeint_stl_dump,
+    .memsize = treeint_stl_memsize,
+    .concurrent = true,
+};
+
+static struct treeint_ops stp_ops = {
+    .init = treeint_stp_init,
+    .destroy = treeint_stp_destroy,
+    .insert = treeint_stp_insert,
+    .find = treeint_stp_find,
+    .remove = treeint_stp_remove,
+    .range = treeint_stp_range,
+    .snapshot = treeint_stp_snapshot,
+    .dump = treeint_stp_dump,
+    .memsize = treeint_stp_memsize,
+    .concurrent = true,
 };
 
 static struct treeint_ops rbtree_ops = {
     .init = treeint_rb_init,
     .destroy = treeint_rb_destroy,
+    .destroy_parallel = treeint_rb_destroy_parallel,
     .insert = treeint_rb_insert,
     .find = treeint_rb_find,
+    .find_batch = treeint_rb_find_batch,
     .remove = treeint_rb_remove,
+    .range = treeint_rb_range,
     .dump = treeint_rb_dump,
+    .freeze = treeint_rb_freeze,
+    .build = treeint_rb_build,
+    .memsize = treeint_rb_memsize,
+    .set_op = treeint_rb_set_op,
+    .range_delete = treeint_rb_range_delete,
+    .peek_min = treeint_rb_peek_min,
+    .pop_min = treeint_rb_pop_min,
+    .decrease_key = treeint_rb_decrease_key,
+};
+
+static struct treeint_ops rbc_ops = {
+    .init = treeint_rbc_init,
+    .destroy = treeint_rbc_destroy,
+    .insert = treeint_rbc_insert,
+    .find = treeint_rbc_find,
+    .remove = treeint_rbc_remove,
+    .save = treeint_rbc_save,
+    .load = treeint_rbc_load,
+    .range = treeint_rbc_range,
+    .dump = treeint_rbc_dump,
+    .memsize = treeint_rbc_memsize,
+};
+
+static struct treeint_ops rbo_ops = {
+    .init = treeint_rbo_init,
+    .destroy = treeint_rbo_destroy,
+    .insert = treeint_rbo_insert,
+    .find = treeint_rbo_find,
+    .remove = treeint_rbo_remove,
+    .range = treeint_rbo_range,
+    .dump = treeint_rbo_dump,
+    .memsize = treeint_rbo_memsize,
+    .rank = treeint_rbo_rank,
+    .select = treeint_rbo_select,
+};
+
+static struct treeint_ops it_ops = {
+    .init = treeint_it_init,
+    .destroy = treeint_it_destroy,
+    .insert = treeint_it_insert,
+    .find = treeint_it_find,
+    .remove = treeint_it_remove,
+    .range = treeint_it_range,
+    .dump = treeint_it_dump,
+    .memsize = treeint_it_memsize,
+    .insert_interval = treeint_it_insert_interval,
+    .overlap = treeint_it_overlap,
+};
+
+static struct treeint_ops rbs_ops = {
+    .init = treeint_rbs_init,
+    .destroy = treeint_rbs_destroy,
+    .insert = treeint_rbs_insert,
+    .find = treeint_rbs_find,
+    .remove = treeint_rbs_remove,
+    .dump = treeint_rbs_dump,
+    .memsize = treeint_rbs_memsize,
+    .concurrent = true,
+};
+
+static struct treeint_ops sl_ops = {
+    .init = treeint_sl_init,
+    .destroy = treeint_sl_destroy,
+    .insert = treeint_sl_insert,
+    .find = treeint_sl_find,
+    .remove = treeint_sl_remove,
+    .range = treeint_sl_range,
+    .dump = treeint_sl_dump,
+    .memsize = treeint_sl_memsize,
+    .concurrent = true,
+};
+
+static struct treeint_ops bptree_ops = {
+    .init = treeint_bp_init,
+    .destroy = treeint_bp_destroy,
+    .insert = treeint_bp_insert,
+    .find = treeint_bp_find,
+    .remove = treeint_bp_remove,
+    .range = treeint_bp_range,
+    .dump = treeint_bp_dump,
+    .memsize = treeint_bp_memsize,
+};
+
+static struct treeint_ops bptree_simd_ops = {
+    .init = treeint_bp_simd_init,
+    .destroy = treeint_bp_destroy,
+    .insert = treeint_bp_insert,
+    .find = treeint_bp_find,
+    .remove = treeint_bp_remove,
+    .range = treeint_bp_range,
+    .dump = treeint_bp_dump,
+    .memsize = treeint_bp_memsize,
 };
 
-#define rand_key(sz) rand() % ((sz) -1)
+static struct treeint_ops art_ops = {
+    .init = treeint_art_init,
+    .destroy = treeint_art_destroy,
+    .insert = treeint_art_insert,
+    .find = treeint_art_find,
+    .remove = treeint_art_remove,
+    .range = treeint_art_range,
+    .dump = treeint_art_dump,
+    .memsize = treeint_art_memsize,
+};
+
+static struct treeint_ops rr_ops = {
+    .init = treeint_rr_init,
+    .destroy = treeint_rr_destroy,
+    .insert = treeint_rr_insert,
+    .find = treeint_rr_find,
+    .remove = treeint_rr_remove,
+    .range = treeint_rr_range,
+    .dump = treeint_rr_dump,
+    .memsize = treeint_rr_memsize,
+    .set_op = treeint_rr_set_op,
+    .range_delete = treeint_rr_range_delete,
+};
+
+/* Unordered, for the baseline cost of point operations */
+static struct treeint_ops ht_ops = {
+    .init = treeint_ht_init,
+    .destroy = treeint_ht_destroy,
+    .insert = treeint_ht_insert,
+    .find = treeint_ht_find,
+    .remove = treeint_ht_remove,
+    .dump = treeint_ht_dump,
+    .memsize = treeint_ht_memsize,
+};
+
+#define rand_key(sz) rand() % ((sz) > 1 ? (sz) -1 : 1)
+
+/* Zipf-distributed ranks in [0, n), the rank r coming up with a probability
+ * proportional to 1 / (r + 1)^theta, for 0 < theta < 1. This is the generator
+ * of Gray et al., "Quickly generating billion-record synthetic databases",
+ * which YCSB uses too: O(n) setup, then O(1) per rank.
+ */
+struct zipf {
+    size_t n;
+    double theta, alpha, zetan, eta;
+};
+
+static void zipf_init(struct zipf *z, size_t n, double theta)
+{
+    z->n = n;
+    z->theta = theta;
+    z->zetan = 0;
+    for (size_t i = 1; i <= n; i++)
+        z->zetan += 1 / pow(i, theta);
+
+    double zeta2 = 1 + pow(0.5, theta);
+    z->alpha = 1 / (1 - theta);
+    z->eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - zeta2 / z->zetan);
+}
+
+static size_t zipf_next(const struct zipf *z, unsigned int *seed)
+{
+    double u = rand_r(seed) / ((double) RAND_MAX + 1), uz = u * z->zetan;
+
+    if (uz < 1)
+        return 0;
+    if (uz < 1 + pow(0.5, z->theta))
+        return 1;
+
+    size_t r = z->n * pow(z->eta * u - z->eta + 1, z->alpha);
+    return r < z->n ? r : z->n - 1;
+}
+
+/* Same range as rand_key(), the ranks being scattered over it so that the hot
+ * keys are not all the smallest ones. The multiplier is a prime larger than
+ * any tree size, which makes the mapping a permutation.
+ */
+static int zipf_key(const struct zipf *z, unsigned int *seed)
+{
+    return (zipf_next(z, seed) * 2147483647UL) % z->n;
+}
 
 /* Just a naive implementation to benchmark a code block. */
 #define bench(statement)                                                  \
@@ -50,28 +393,1556 @@ static struct treeint_ops rbtree_ops = {
         time;                                                             \
     })
 
+/* Clock of the operations timed one by one in the summary records (see -O):
+ * the time stamp counter where there is one, a fraction of the cost of
+ * clock_gettime(), in ticks that tick_calibrate() converts to nanoseconds.
+ *
+ * rdtsc is not ordered with the instructions around it, so the CPU could
+ * start an operation before the first read or finish it after the second:
+ * tick_start() waits for the code before it, and keeps the operation from
+ * starting before the read, while rdtscp in tick_stop() waits for the
+ * operation and the lfence after it keeps the code that follows out.
+ */
+#ifdef TREEINT_TSC
+static inline uint64_t tick_start(void)
+{
+    _mm_lfence();
+    uint64_t t = __rdtsc();
+    _mm_lfence();
+    return t;
+}
+
+static inline uint64_t tick_stop(void)
+{
+    unsigned int aux;
+    uint64_t t = __rdtscp(&aux);
+    _mm_lfence();
+    return t;
+}
+#else
+static inline uint64_t tick_start(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+#define tick_stop tick_start
+#endif
+
+static double ns_per_tick = 1;
+/* Ticks of an empty timed operation, taken off every sample */
+static uint64_t tick_overhead;
+
+static void tick_calibrate(void)
+{
+#ifdef TREEINT_TSC
+    /* Count the ticks of 10ms of clock_gettime() */
+    struct timespec t0, t;
+    uint64_t start = tick_start(), end;
+    long long time;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        end = tick_stop();
+        time = (t.tv_sec - t0.tv_sec) * 1000000000LL + t.tv_nsec - t0.tv_nsec;
+    } while (time < 10000000);
+    ns_per_tick = (double) time / (end - start);
+#endif
+
+    tick_overhead = UINT64_MAX;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t t = tick_start(), d = tick_stop() - t;
+        if (d < tick_overhead)
+            tick_overhead = d;
+    }
+}
+
+/* Output of the insertions, lookups and removals: the time of every operation,
+ * or a summary record per phase, in CSV or in JSON lines
+ */
+enum out_format { OUT_RAW, OUT_CSV, OUT_JSON };
+static enum out_format out_format;
+
+/* A phase of the summary records. The latency of each operation goes to a
+ * histogram, while the throughput comes from the clock read once around the
+ * whole phase, as a batch.
+ */
+struct phase {
+    const char *name;
+    size_t size; /* of the tree the phase ran on */
+    struct hist lat; /* in ticks */
+    struct timespec start;
+};
+
+static const struct {
+    double p;
+    const char *name;
+} phase_percentiles[] = {{50, "p50"}, {90, "p90"}, {99, "p99"}, {99.9, "p999"}};
+
+static void phase_begin(struct phase *p, const char *name, size_t size)
+{
+    p->name = name;
+    p->size = size;
+    hist_init(&p->lat);
+    clock_gettime(CLOCK_MONOTONIC, &p->start);
+}
+
+/* Time statement as an operation of phase p, and return its ticks */
+#define phase_op(p, statement)                                     \
+    ({                                                             \
+        uint64_t _t = tick_start();                                \
+        statement;                                                 \
+        _t = tick_stop() - _t;                                     \
+        _t = _t > tick_overhead ? _t - tick_overhead : 0;          \
+        hist_record(&(p)->lat, _t);                                \
+        _t;                                                        \
+    })
+
+/* Time statement in the output format: printed right away followed by sep in
+ * the raw output, or recorded in phase p otherwise
+ */
+#define time_op(p, sep, statement)                       \
+    do {                                                 \
+        if (out_format == OUT_RAW)                       \
+            printf("%lld" sep, bench(statement));        \
+        else                                             \
+            phase_op(p, statement);                      \
+    } while (0)
+
+/* A summary record: its name, the tree size, the number of operations, the
+ * wall-clock time, the operations per second, then the mean, the percentiles
+ * and the maximum of the latency, all times in ns. The phases timed as a whole
+ * have no latency histogram: their mean is the time per operation, and the
+ * rest is left out. Only the memory record has bytes, used by its ops keys.
+ */
+struct record {
+    const char *name;
+    size_t size;
+    uint64_t ops;
+    long long ns;
+    const struct hist *lat; /* in ticks, NULL if timed as a whole */
+    size_t bytes;
+};
+
+static void record_print(const struct record *r)
+{
+    static bool header;
+    const struct hist *h = r->lat;
+    double ops_per_sec = r->ns ? r->ops * 1e9 / r->ns : 0;
+    double mean = h ? (h->nr ? (double) h->sum / h->nr * ns_per_tick : 0)
+                    : (r->ops ? (double) r->ns / r->ops : 0);
+
+    if (out_format == OUT_JSON) {
+        printf("{\"phase\":\"%s\",\"size\":%zu,\"ops\":%" PRIu64
+               ",\"ns\":%lld,\"ops_per_sec\":%.0f,\"mean\":%.1f",
+               r->name, r->size, r->ops, r->ns, ops_per_sec, mean);
+        for (size_t i = 0; h && i < ARRAY_SIZE(phase_percentiles); i++)
+            printf(",\"%s\":%.0f", phase_percentiles[i].name,
+                   hist_percentile(h, phase_percentiles[i].p) * ns_per_tick);
+        if (h)
+            printf(",\"max\":%.0f", h->max * ns_per_tick);
+        if (r->bytes)
+            printf(",\"bytes\":%zu", r->bytes);
+        printf("}\n");
+        return;
+    }
+
+    if (!header) {
+        printf("phase,size,ops,ns,ops_per_sec,mean");
+        for (size_t i = 0; i < ARRAY_SIZE(phase_percentiles); i++)
+            printf(",%s", phase_percentiles[i].name);
+        printf(",max,bytes\n");
+        header = true;
+    }
+
+    printf("%s,%zu,%" PRIu64 ",%lld,%.0f,%.1f", r->name, r->size, r->ops,
+           r->ns, ops_per_sec, mean);
+    for (size_t i = 0; i < ARRAY_SIZE(phase_percentiles); i++) {
+        if (h)
+            printf(",%.0f",
+                   hist_percentile(h, phase_percentiles[i].p) * ns_per_tick);
+        else
+            printf(",");
+    }
+    if (h)
+        printf(",%.0f", h->max * ns_per_tick);
+    else
+        printf(",");
+    if (r->bytes)
+        printf(",%zu\n", r->bytes);
+    else
+        printf(",\n");
+}
+
+/* Record of a phase timed as a whole: ops operations in ns */
+static void record_total(const char *name,
+                         size_t size,
+                         uint64_t ops,
+                         long long ns)
+{
+    record_print(&(struct record){
+        .name = name,
+        .size = size,
+        .ops = ops,
+        .ns = ns,
+    });
+}
+
+/* End the line of the raw output, or print the record of the phase */
+static void phase_end(struct phase *p, bool raw)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (raw) {
+        printf("\n");
+        return;
+    }
+
+    long long time = (end.tv_sec - p->start.tv_sec) * 1000000000LL +
+                     end.tv_nsec - p->start.tv_nsec;
+    record_print(&(struct record){
+        .name = p->name,
+        .size = p->size,
+        .ops = p->lat.nr,
+        .ns = time,
+        .lat = &p->lat,
+    });
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+    int x = *(const int *) a, y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+static void scan_cb(int key, void *arg)
+{
+    *(long *) arg += key;
+}
+
+/* Keeps the result of benchmarked lookups that could otherwise be optimized
+ * out, e.g. the inlined ez_find(). Worker threads store to it atomically.
+ */
+static void *volatile sink;
+
+/* Concurrent lookups: nr_threads readers look up nr keys each, while a writer
+ * keeps removing and re-inserting random keys until they are done.
+ */
+struct mt_job {
+    void *ctx;
+    pthread_mutex_t *lock; /* serializes everything unless ops->concurrent */
+    size_t tree_size, nr;
+    int base; /* first key of the slice of a mixed workload thread */
+    int *keys; /* the keys of a scaling thread, see bench_scaling() */
+    unsigned int seed;
+    bool *stop;
+    size_t nr_ops;
+};
+
+static void *mt_reader(void *arg)
+{
+    struct mt_job *job = arg;
+
+    for (size_t i = 0; i < job->nr; i++) {
+        int v = job->seed && job->tree_size > 1
+                    ? rand_r(&job->seed) % (job->tree_size - 1)
+                    : i % job->tree_size;
+        if (job->lock)
+            pthread_mutex_lock(job->lock);
+        __atomic_store_n(&sink, ops->find(job->ctx, v), __ATOMIC_RELAXED);
+        if (job->lock)
+            pthread_mutex_unlock(job->lock);
+    }
+
+    job->nr_ops = job->nr;
+    return NULL;
+}
+
+static void *mt_writer(void *arg)
+{
+    struct mt_job *job = arg;
+
+    /* Removing and re-inserting the same key leaves the set of keys unchanged
+     * for the phases that follow.
+     */
+    while (!__atomic_load_n(job->stop, __ATOMIC_RELAXED)) {
+        int v = job->tree_size > 1 ? rand_r(&job->seed) % (job->tree_size - 1)
+                                   : 0;
+        if (job->lock)
+            pthread_mutex_lock(job->lock);
+        if (!ops->remove(job->ctx, v))
+            ops->insert(job->ctx, v);
+        if (job->lock)
+            pthread_mutex_unlock(job->lock);
+        job->nr_ops++;
+    }
+
+    return NULL;
+}
+
+/* Mixed workload: each thread owns a disjoint slice of tree_size keys starting
+ * at base, and runs a random mix of half lookups, a quarter insertions and a
+ * quarter removals in it.
+ */
+static void *mt_mixed(void *arg)
+{
+    struct mt_job *job = arg;
+
+    for (size_t i = 0; i < job->nr; i++) {
+        unsigned int r = rand_r(&job->seed);
+        int v = job->base + (r >> 2) % job->tree_size;
+
+        if (job->lock)
+            pthread_mutex_lock(job->lock);
+        switch (r & 3) {
+        case 0:
+            ops->insert(job->ctx, v);
+            break;
+        case 1:
+            ops->remove(job->ctx, v);
+            break;
+        default:
+            __atomic_store_n(&sink, ops->find(job->ctx, v), __ATOMIC_RELAXED);
+            break;
+        }
+        if (job->lock)
+            pthread_mutex_unlock(job->lock);
+    }
+
+    job->nr_ops = job->nr;
+    return NULL;
+}
+
+/* Run tree_size operations of the mixed workload on each of nr_threads
+ * threads, the key range being split evenly between them. Print the number of
+ * operations, the wall-clock time and the resulting operations per second.
+ */
+static void bench_mixed(void *ctx,
+                        size_t tree_size,
+                        unsigned int seed,
+                        int nr_threads)
+{
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    struct mt_job jobs[nr_threads];
+    pthread_t threads[nr_threads];
+    size_t slice = tree_size / nr_threads ? tree_size / nr_threads : 1;
+
+    for (int i = 0; i < nr_threads; i++) {
+        jobs[i] = (struct mt_job){
+            .ctx = ctx,
+            .lock = ops->concurrent ? NULL : &lock,
+            .tree_size = slice,
+            .nr = tree_size,
+            .base = i * slice,
+            .seed = seed + i,
+        };
+    }
+
+    long long time = bench({
+        for (int i = 0; i < nr_threads; i++)
+            pthread_create(&threads[i], NULL, mt_mixed, &jobs[i]);
+        for (int i = 0; i < nr_threads; i++)
+            pthread_join(threads[i], NULL);
+    });
+
+    size_t nr_ops = 0;
+    for (int i = 0; i < nr_threads; i++)
+        nr_ops += jobs[i].nr_ops;
+
+    if (out_format == OUT_RAW)
+        printf("%zu,%lld,%.0f\n", nr_ops, time,
+               time ? nr_ops * 1e9 / time : 0);
+    else
+        record_total("mixed", tree_size, nr_ops, time);
+}
+
+static void *mt_insert(void *arg)
+{
+    struct mt_job *job = arg;
+
+    for (size_t i = 0; i < job->nr; i++) {
+        if (job->lock)
+            pthread_mutex_lock(job->lock);
+        ops->insert(job->ctx, job->keys[i]);
+        if (job->lock)
+            pthread_mutex_unlock(job->lock);
+    }
+
+    return NULL;
+}
+
+static void *mt_find(void *arg)
+{
+    struct mt_job *job = arg;
+
+    for (size_t i = 0; i < job->nr; i++) {
+        if (job->lock)
+            pthread_mutex_lock(job->lock);
+        __atomic_store_n(&sink, ops->find(job->ctx, job->keys[i]),
+                         __ATOMIC_RELAXED);
+        if (job->lock)
+            pthread_mutex_unlock(job->lock);
+    }
+
+    return NULL;
+}
+
+static void *mt_remove(void *arg)
+{
+    struct mt_job *job = arg;
+
+    for (size_t i = 0; i < job->nr; i++) {
+        if (job->lock)
+            pthread_mutex_lock(job->lock);
+        ops->remove(job->ctx, job->keys[i]);
+        if (job->lock)
+            pthread_mutex_unlock(job->lock);
+    }
+
+    return NULL;
+}
+
+static long long mt_run(void *(*fn)(void *),
+                        struct mt_job *jobs,
+                        int nr_threads)
+{
+    pthread_t threads[nr_threads];
+
+    return bench({
+        for (int i = 0; i < nr_threads; i++)
+            pthread_create(&threads[i], NULL, fn, &jobs[i]);
+        for (int i = 0; i < nr_threads; i++)
+            pthread_join(threads[i], NULL);
+    });
+}
+
+/* Insertion and lookup scaling: nr_threads threads insert tree_size fresh keys
+ * in total, above the ones of the tree, then look them all up and remove them,
+ * each thread in its own slice and in a shuffled order unless seed is 0. Print
+ * the number of keys and the wall-clock time of each of the three steps.
+ */
+static void bench_scaling(void *ctx,
+                          size_t tree_size,
+                          unsigned int seed,
+                          int nr_threads)
+{
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    struct mt_job jobs[nr_threads];
+    size_t slice = tree_size / nr_threads ? tree_size / nr_threads : 1;
+
+    for (int i = 0; i < nr_threads; i++) {
+        jobs[i] = (struct mt_job){
+            .ctx = ctx,
+            .lock = ops->concurrent ? NULL : &lock,
+            .nr = slice,
+            .keys = malloc(sizeof(int) * slice),
+            .seed = seed + i,
+        };
+        assert(jobs[i].keys);
+
+        for (size_t j = 0; j < slice; j++)
+            jobs[i].keys[j] = tree_size + i * slice + j;
+        for (size_t j = slice - 1; seed && j > 0; j--) {
+            size_t k = rand_r(&jobs[i].seed) % (j + 1);
+            int tmp = jobs[i].keys[j];
+            jobs[i].keys[j] = jobs[i].keys[k];
+            jobs[i].keys[k] = tmp;
+        }
+    }
+
+    long long insert_time = mt_run(mt_insert, jobs, nr_threads);
+    long long find_time = mt_run(mt_find, jobs, nr_threads);
+    long long remove_time = mt_run(mt_remove, jobs, nr_threads);
+
+    size_t nr = slice * nr_threads;
+    if (out_format == OUT_RAW) {
+        printf("%zu,%lld,%lld,%lld\n", nr, insert_time, find_time,
+               remove_time);
+    } else {
+        record_total("scaling-insert", tree_size, nr, insert_time);
+        record_total("scaling-find", tree_size, nr, find_time);
+        record_total("scaling-remove", tree_size, nr, remove_time);
+    }
+
+    for (int i = 0; i < nr_threads; i++)
+        free(jobs[i].keys);
+}
+
+/* Batched lookups: look tree_size keys up one at a time, then again batch keys
+ * at a time with find_batch(). The keys are drawn from a separate generator to
+ * leave the keys of the other phases unchanged. Print the number of keys, the
+ * total time of each pass and the speedup of the batches.
+ */
+static void bench_batch(void *ctx,
+                        size_t tree_size,
+                        unsigned int seed,
+                        size_t batch)
+{
+    int *keys = malloc(sizeof(int) * tree_size);
+    void **out = malloc(sizeof(void *) * batch);
+    size_t found = 0, found_batch = 0;
+    assert(keys && out);
+
+    for (size_t i = 0; i < tree_size; i++)
+        keys[i] = seed && tree_size > 1 ? rand_r(&seed) % (tree_size - 1) : i;
+
+    long long time = bench({
+        for (size_t i = 0; i < tree_size; i++)
+            found += (sink = ops->find(ctx, keys[i])) != NULL;
+    });
+    long long batch_time = bench({
+        for (size_t i = 0; i < tree_size; i += batch) {
+            size_t nr = tree_size - i < batch ? tree_size - i : batch;
+            found_batch += ops->find_batch(ctx, keys + i, nr, out);
+        }
+    });
+    assert(found == found_batch);
+
+    if (out_format == OUT_RAW) {
+        printf("%zu,%lld,%lld,%.2f\n", tree_size, time, batch_time,
+               batch_time ? (double) time / batch_time : 0);
+    } else {
+        record_total("find-unbatched", tree_size, tree_size, time);
+        record_total("find-batch", tree_size, tree_size, batch_time);
+    }
+
+    free(out);
+    free(keys);
+}
+
+/* Stops counting once the key of rank k is found, the walk goes on anyway */
+struct walk_select {
+    size_t i, k;
+    int key;
+};
+
+static void walk_select_cb(int key, void *arg)
+{
+    struct walk_select *ws = arg;
+
+    if (ws->i++ == ws->k)
+        ws->key = key;
+}
+
+/* Percentile queries: select the keys of tree_size random ranks, then rank
+ * tree_size random keys. For comparison, also find the 10th, 20th... 100th
+ * percentiles with a full in-order walk of range(), which is what order
+ * statistics cost without the augmentation. Print the average time of each
+ * kind of query.
+ */
+static void bench_percentiles(void *ctx, size_t tree_size, unsigned int seed)
+{
+    size_t nr_keys = ops->rank(ctx, INT_MAX) + !!ops->find(ctx, INT_MAX);
+    long long select_time = 0, rank_time = 0, walk_time = 0;
+    long sum = 0;
+
+    for (size_t i = 0; nr_keys && i < tree_size; i++) {
+        size_t k = seed ? rand_r(&seed) % nr_keys : i % nr_keys;
+        int key;
+        select_time += bench(ops->select(ctx, k, &key));
+        sum += key;
+    }
+
+    for (size_t i = 0; nr_keys && i < tree_size; i++) {
+        int v = seed ? rand_r(&seed) % tree_size : i;
+        rank_time += bench(sum += ops->rank(ctx, v));
+    }
+
+    size_t nr_queries = nr_keys ? tree_size : 0;
+    for (int p = 10; nr_keys && p <= 100; p += 10) {
+        struct walk_select ws = {.k = (nr_keys - 1) * p / 100};
+        walk_time += bench(ops->range(ctx, INT_MIN, INT_MAX, walk_select_cb,
+                                      &ws));
+        sum += ws.key;
+    }
+
+    sink = (void *) sum;
+    if (out_format == OUT_RAW) {
+        printf("%.1f,%.1f,%.1f\n",
+               nr_queries ? (double) select_time / nr_queries : 0,
+               nr_queries ? (double) rank_time / nr_queries : 0,
+               walk_time / 10.0);
+    } else {
+        record_total("select", tree_size, nr_queries, select_time);
+        record_total("rank", tree_size, nr_queries, rank_time);
+        record_total("select-walk", tree_size, nr_keys ? 10 : 0, walk_time);
+    }
+}
+
+struct interval {
+    int start, last;
+};
+
+static int cmp_interval(const void *a, const void *b)
+{
+    int x = ((const struct interval *) a)->start;
+    int y = ((const struct interval *) b)->start;
+    return (x > y) - (x < y);
+}
+
+static size_t linear_overlap(const struct interval *iv,
+                             size_t nr,
+                             int lo,
+                             int hi)
+{
+    size_t count = 0;
+
+    for (size_t i = 0; i < nr; i++)
+        count += iv[i].start <= hi && iv[i].last >= lo;
+
+    return count;
+}
+
+/* No interval covers more than span keys, so the ones starting before
+ * lo - span + 1 cannot reach lo: binary-search the first start from there.
+ */
+static size_t sorted_overlap(const struct interval *iv,
+                             size_t nr,
+                             int lo,
+                             int hi,
+                             int span)
+{
+    long from = (long) lo - span + 1;
+    size_t l = 0, r = nr, count = 0;
+
+    while (l < r) {
+        size_t m = l + (r - l) / 2;
+        if (iv[m].start < from)
+            l = m + 1;
+        else
+            r = m;
+    }
+
+    for (; l < nr && iv[l].start <= hi; l++)
+        count += iv[l].last >= lo;
+
+    return count;
+}
+
+/* Overlap queries: load tree_size intervals of random starts below tree_size,
+ * covering 1 to span keys, into a fresh tree, then run tree_size stabbing
+ * queries at random points and tree_size queries for the intervals
+ * overlapping span keys. The same queries go to an array of the intervals
+ * sorted by start, see sorted_overlap(), and the first 1000 of them to a
+ * linear scan of the array. Print the average time of a stabbing query on the
+ * tree, with the scan and on the sorted array, then the same for the others.
+ */
+static void bench_overlap(size_t tree_size, unsigned int seed, int span)
+{
+    struct interval *iv = malloc(sizeof(struct interval) * tree_size);
+    void *ctx = ops->init();
+    long sum = 0;
+    assert(iv);
+
+    for (size_t i = 0; i < tree_size; i++) {
+        iv[i].start = seed ? rand_r(&seed) % tree_size : i;
+        int len = seed ? rand_r(&seed) % span : (int) (i % span);
+
+        iv[i].last = iv[i].start + len;
+        ops->insert_interval(ctx, iv[i].start, iv[i].last);
+    }
+    qsort(iv, tree_size, sizeof(struct interval), cmp_interval);
+
+    size_t nr_scans = tree_size < 1000 ? tree_size : 1000;
+    for (int stab = 1; stab >= 0; stab--) {
+        long long tree_time = 0, scan_time = 0, array_time = 0;
+
+        for (size_t i = 0; i < tree_size; i++) {
+            int lo = seed ? rand_r(&seed) % tree_size : i;
+            int hi = stab ? lo : lo + span - 1;
+            size_t nr, nr_array, nr_scan;
+
+            tree_time += bench(nr = ops->overlap(ctx, lo, hi, scan_cb, &sum));
+            array_time +=
+                bench(nr_array = sorted_overlap(iv, tree_size, lo, hi, span));
+            assert(nr_array == nr);
+
+            if (i < nr_scans) {
+                scan_time +=
+                    bench(nr_scan = linear_overlap(iv, tree_size, lo, hi));
+                assert(nr_scan == nr);
+            }
+        }
+
+        if (out_format == OUT_RAW) {
+            printf("%.1f,%.1f,%.1f%s", (double) tree_time / tree_size,
+                   (double) scan_time / nr_scans,
+                   (double) array_time / tree_size, stab ? "," : "\n");
+        } else {
+            record_total(stab ? "stab" : "overlap", tree_size, tree_size,
+                         tree_time);
+            record_total(stab ? "stab-scan" : "overlap-scan", tree_size,
+                         nr_scans, scan_time);
+            record_total(stab ? "stab-array" : "overlap-array", tree_size,
+                         tree_size, array_time);
+        }
+    }
+
+    sink = (void *) sum;
+    ops->destroy(ctx);
+    free(iv);
+}
+
+/* Delay of the i-th timer armed, spread over 64 times the number pending so
+ * that few deadlines collide
+ */
+static int timer_delay(unsigned int *seed, size_t i, size_t tree_size)
+{
+    size_t horizon = 64 * tree_size;
+
+    return 1 + (*seed ? rand_r(seed) % horizon : i * 64 % horizon);
+}
+
+/* Timer workload on a queue of tree_size pending deadlines, in the hold model:
+ * each step peeks at the earliest deadline, pops it and arms a new timer some
+ * delay after it, and one step in four then pulls the new timer in to half its
+ * delay. Run tree_size steps on a fresh tree, then the same on a binary heap
+ * and a pairing heap, and print the average time of a step on each. The tree
+ * only holds distinct keys, so a timer colliding with a pending one is moved
+ * one later instead.
+ */
+static void bench_timers(size_t tree_size, unsigned int seed)
+{
+    struct bheap_node *bn = malloc(sizeof(struct bheap_node) * tree_size);
+    struct pheap_node *pn = malloc(sizeof(struct pheap_node) * tree_size);
+    struct bheap bh = BHEAP_INIT;
+    struct pheap ph = {NULL};
+    void *ctx = ops->init();
+    long sum = 0, bheap_sum = 0, pheap_sum = 0;
+    unsigned int s = seed;
+    int now, delay, key;
+    assert(bn && pn);
+
+    for (size_t i = 0; i < tree_size; i++) {
+        for (key = timer_delay(&s, i, tree_size); ops->insert(ctx, key); key++)
+            ;
+    }
+
+    long long tree_time = bench({
+        for (size_t i = 0; i < tree_size; i++) {
+            if (ops->peek_min(ctx, &now) || ops->pop_min(ctx, &now))
+                break;
+
+            delay = timer_delay(&s, i, tree_size);
+            for (key = now + delay; ops->insert(ctx, key); key++)
+                ;
+            if (i % 4 == 0 && delay > 1)
+                ops->decrease_key(ctx, key, now + delay / 2);
+            sum += now;
+        }
+    });
+
+    s = seed;
+    for (size_t i = 0; i < tree_size; i++) {
+        bn[i].key = timer_delay(&s, i, tree_size);
+        if (bheap_push(&bh, &bn[i]))
+            abort();
+    }
+
+    long long bheap_time = bench({
+        for (size_t i = 0; i < tree_size; i++) {
+            struct bheap_node *n = bheap_peek(&bh);
+            if (!n)
+                break;
+
+            bheap_pop(&bh);
+            now = n->key;
+            delay = timer_delay(&s, i, tree_size);
+            n->key = now + delay;
+            bheap_push(&bh, n);
+            if (i % 4 == 0 && delay > 1)
+                bheap_decrease(&bh, n, now + delay / 2);
+            bheap_sum += now;
+        }
+    });
+
+    s = seed;
+    for (size_t i = 0; i < tree_size; i++) {
+        pn[i].key = timer_delay(&s, i, tree_size);
+        pheap_push(&ph, &pn[i]);
+    }
+
+    long long pheap_time = bench({
+        for (size_t i = 0; i < tree_size; i++) {
+            struct pheap_node *n = pheap_peek(&ph);
+            if (!n)
+                break;
+
+            pheap_pop(&ph);
+            now = n->key;
+            delay = timer_delay(&s, i, tree_size);
+            n->key = now + delay;
+            pheap_push(&ph, n);
+            if (i % 4 == 0 && delay > 1)
+                pheap_decrease(&ph, n, now + delay / 2);
+            pheap_sum += now;
+        }
+    });
+
+    /* Both heaps see the very same workload */
+    assert(bheap_sum == pheap_sum);
+    sink = (void *) (sum + bheap_sum);
+
+    size_t nr_steps = tree_size ? tree_size : 1;
+    if (out_format == OUT_RAW) {
+        printf("%.1f,%.1f,%.1f\n", (double) tree_time / nr_steps,
+               (double) bheap_time / nr_steps, (double) pheap_time / nr_steps);
+    } else {
+        record_total("timers", tree_size, tree_size, tree_time);
+        record_total("timers-binary-heap", tree_size, tree_size, bheap_time);
+        record_total("timers-pairing-heap", tree_size, tree_size, pheap_time);
+    }
+
+    ops->destroy(ctx);
+    bheap_destroy(&bh);
+    free(bn);
+    free(pn);
+}
+
+static void *tree_of(const int *keys, size_t nr)
+{
+    void *ctx = ops->init();
+
+    for (size_t i = 0; i < nr; i++)
+        ops->insert(ctx, keys[i]);
+
+    return ctx;
+}
+
+/* Records of the bulk set operations, then of the same one key at a time */
+static const char *const set_op_names[][2] = {
+    [SET_UNION] = {"union", "union-naive"},
+    [SET_INTERSECTION] = {"intersection", "intersection-naive"},
+    [SET_DIFFERENCE] = {"difference", "difference-naive"},
+};
+
+/* Set operations on two separate trees a and b of tree_size keys each, drawn
+ * from twice that range so that they share about a quarter of them, or
+ * overlapping by half when seed is 0. For union, intersection and difference,
+ * then the removal of the middle half of the key range from a, print the time
+ * of the bulk operation then the time of the same done one key at a time.
+ */
+static void bench_set_ops(size_t tree_size, unsigned int seed, int nr_threads)
+{
+    int *a = malloc(sizeof(int) * tree_size);
+    int *b = malloc(sizeof(int) * tree_size);
+    assert(a && b);
+
+    for (size_t i = 0; i < tree_size; i++) {
+        a[i] = seed ? rand_r(&seed) % (2 * tree_size) : i;
+        b[i] = seed ? rand_r(&seed) % (2 * tree_size) : i + tree_size / 2;
+    }
+
+    for (int op = SET_UNION; op <= SET_DIFFERENCE; op++) {
+        void *x = tree_of(a, tree_size), *y = tree_of(b, tree_size);
+        long long time = bench(ops->set_op(x, y, op, nr_threads));
+        ops->destroy(x);
+
+        x = tree_of(a, tree_size);
+        y = tree_of(b, tree_size);
+        long long naive_time = bench({
+            for (size_t i = 0; i < tree_size; i++) {
+                if (op == SET_UNION)
+                    ops->insert(x, b[i]);
+                else if (op == SET_DIFFERENCE)
+                    ops->remove(x, b[i]);
+                else if (!ops->find(y, a[i]))
+                    ops->remove(x, a[i]);
+            }
+        });
+        ops->destroy(x);
+        ops->destroy(y);
+
+        if (out_format == OUT_RAW) {
+            printf("%lld,%lld,", time, naive_time);
+        } else {
+            record_total(set_op_names[op][0], tree_size, tree_size, time);
+            record_total(set_op_names[op][1], tree_size, tree_size,
+                         naive_time);
+        }
+    }
+
+    int lo = tree_size / 2, hi = lo + tree_size - 1;
+    void *x = tree_of(a, tree_size);
+    long long time = bench(ops->range_delete(x, lo, hi, nr_threads));
+    ops->destroy(x);
+
+    x = tree_of(a, tree_size);
+    long long naive_time = bench({
+        for (int v = lo; v <= hi; v++)
+            ops->remove(x, v);
+    });
+    ops->destroy(x);
+
+    if (out_format == OUT_RAW) {
+        printf("%lld,%lld\n", time, naive_time);
+    } else {
+        record_total("range-delete", tree_size, tree_size, time);
+        record_total("range-delete-naive", tree_size, tree_size, naive_time);
+    }
+
+    free(a);
+    free(b);
+}
+
+/* Print the number of lookups, the wall-clock time, the resulting lookups per
+ * second and the number of writes done in the meantime.
+ */
+static void bench_concurrent(void *ctx,
+                             size_t tree_size,
+                             unsigned int seed,
+                             int nr_threads)
+{
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    struct mt_job jobs[nr_threads + 1];
+    pthread_t threads[nr_threads + 1];
+    bool stop = false;
+
+    for (int i = 0; i <= nr_threads; i++) {
+        jobs[i] = (struct mt_job){
+            .ctx = ctx,
+            .lock = ops->concurrent ? NULL : &lock,
+            .tree_size = tree_size,
+            .nr = tree_size,
+            /* seed 0 keeps the lookups linear */
+            .seed = seed ? seed + i : 0,
+            .stop = &stop,
+        };
+    }
+    jobs[nr_threads].seed = seed + nr_threads + 1;
+
+    long long time = bench({
+        for (int i = 0; i < nr_threads; i++)
+            pthread_create(&threads[i], NULL, mt_reader, &jobs[i]);
+        if (tree_size > 1)
+            pthread_create(&threads[nr_threads], NULL, mt_writer,
+                           &jobs[nr_threads]);
+
+        for (int i = 0; i < nr_threads; i++)
+            pthread_join(threads[i], NULL);
+    });
+
+    __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+    if (tree_size > 1)
+        pthread_join(threads[nr_threads], NULL);
+
+    size_t lookups = 0;
+    for (int i = 0; i < nr_threads; i++)
+        lookups += jobs[i].nr_ops;
+
+    if (out_format == OUT_RAW) {
+        printf("%zu,%lld,%.0f,%zu\n", lookups, time,
+               time ? lookups * 1e9 / time : 0, jobs[nr_threads].nr_ops);
+    } else {
+        /* the writer runs as long as the readers */
+        record_total("concurrent-find", tree_size, lookups, time);
+        record_total("concurrent-update", tree_size, jobs[nr_threads].nr_ops,
+                     time);
+    }
+}
+
+/* Snapshot readers: each of nr_threads readers takes snapshots of the tree in
+ * turn and scans each of them twice, while a writer keeps updating the tree as
+ * in bench_concurrent(). A snapshot is unaffected by the writer, so both scans
+ * must visit the same keys, which the sum of the keys checks.
+ */
+#define SNAPSHOT_SCANS 16
+
+struct snap_job {
+    void *ctx;
+    long long snapshot_time;
+    size_t visited, nr_torn;
+};
+
+static void *snap_reader(void *arg)
+{
+    struct snap_job *job = arg;
+
+    for (int i = 0; i < SNAPSHOT_SCANS; i++) {
+        void *snap;
+        long first = 0, second = 0;
+
+        job->snapshot_time += bench(snap = ops->snapshot(job->ctx));
+        size_t nr = ops->range(snap, INT_MIN, INT_MAX, scan_cb, &first);
+        if (ops->range(snap, INT_MIN, INT_MAX, scan_cb, &second) != nr ||
+            first != second)
+            job->nr_torn++;
+        job->visited += 2 * nr;
+        ops->destroy(snap);
+    }
+
+    return NULL;
+}
+
+/* Print the number of keys visited, the wall-clock time, the resulting keys
+ * per second, the mean time to take a snapshot, the number of writes done in
+ * the meantime and the number of snapshots whose scans disagreed.
+ */
+static void bench_snapshots(void *ctx,
+                            size_t tree_size,
+                            unsigned int seed,
+                            int nr_threads)
+{
+    struct snap_job jobs[nr_threads];
+    pthread_t threads[nr_threads + 1];
+    bool stop = false;
+    struct mt_job writer = {
+        .ctx = ctx,
+        .tree_size = tree_size,
+        .seed = seed + nr_threads + 1,
+        .stop = &stop,
+    };
+
+    for (int i = 0; i < nr_threads; i++)
+        jobs[i] = (struct snap_job){.ctx = ctx};
+
+    long long time = bench({
+        for (int i = 0; i < nr_threads; i++)
+            pthread_create(&threads[i], NULL, snap_reader, &jobs[i]);
+        if (tree_size > 1)
+            pthread_create(&threads[nr_threads], NULL, mt_writer, &writer);
+
+        for (int i = 0; i < nr_threads; i++)
+            pthread_join(threads[i], NULL);
+    });
+
+    __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+    if (tree_size > 1)
+        pthread_join(threads[nr_threads], NULL);
+
+    size_t visited = 0, nr_torn = 0;
+    long long snapshot_time = 0;
+    for (int i = 0; i < nr_threads; i++) {
+        visited += jobs[i].visited;
+        nr_torn += jobs[i].nr_torn;
+        snapshot_time += jobs[i].snapshot_time;
+    }
+
+    if (out_format == OUT_RAW) {
+        printf("%zu,%lld,%.0f,%lld,%zu,%zu\n", visited, time,
+               time ? visited * 1e9 / time : 0,
+               snapshot_time / (nr_threads * SNAPSHOT_SCANS), writer.nr_ops,
+               nr_torn);
+    } else {
+        /* A scan is torn if its snapshot changed under it, which never
+         * happens unless the tree is broken.
+         */
+        if (nr_torn)
+            fprintf(stderr, "%zu torn snapshot scans\n", nr_torn);
+        record_total("snapshot-scan", tree_size, visited, time);
+        record_total("snapshot", tree_size, nr_threads * SNAPSHOT_SCANS,
+                     snapshot_time);
+        record_total("snapshot-update", tree_size, writer.nr_ops, time);
+    }
+}
+
+/* YCSB-like workloads: the percentages of lookups, updates (the removal then
+ * the insertion of a key), insertions of fresh keys, range scans of up to span
+ * keys and read-modify-writes (a lookup then an update). The presets are the
+ * core workloads of YCSB, the keys following the distribution picked by -z and
+ * the seed instead: Zipf, sequential for seed 0, uniform otherwise.
+ */
+enum ycsb_op {
+    YCSB_READ,
+    YCSB_UPDATE,
+    YCSB_INSERT,
+    YCSB_SCAN,
+    YCSB_RMW,
+    YCSB_NR_OPS,
+};
+
+static const char *ycsb_names[YCSB_NR_OPS] = {
+    "ycsb-read", "ycsb-update", "ycsb-insert", "ycsb-scan", "ycsb-rmw",
+};
+
+struct ycsb_mix {
+    int pct[YCSB_NR_OPS];
+};
+
+static const struct {
+    char name;
+    struct ycsb_mix mix;
+} ycsb_presets[] = {
+    {'A', {{50, 50, 0, 0, 0}}},  /* update heavy */
+    {'B', {{95, 5, 0, 0, 0}}},   /* read mostly */
+    {'C', {{100, 0, 0, 0, 0}}},  /* read only */
+    {'D', {{95, 0, 5, 0, 0}}},   /* read latest, here without the skew */
+    {'E', {{0, 0, 5, 95, 0}}},   /* short ranges */
+    {'F', {{50, 0, 0, 0, 50}}},  /* read-modify-write */
+};
+
+/* A preset letter, or read:update:insert:scan[:rmw] percentages adding up to
+ * 100
+ */
+static int ycsb_parse(const char *str, struct ycsb_mix *mix)
+{
+    int *pct = mix->pct, sum = 0;
+
+    memset(mix, 0, sizeof(*mix));
+    if (str[0] && !str[1]) {
+        for (size_t i = 0; i < ARRAY_SIZE(ycsb_presets); i++) {
+            if (ycsb_presets[i].name == toupper(str[0])) {
+                *mix = ycsb_presets[i].mix;
+                return 0;
+            }
+        }
+        return -1;
+    }
+
+    if (sscanf(str, "%d:%d:%d:%d:%d", &pct[0], &pct[1], &pct[2], &pct[3],
+               &pct[4]) < 4)
+        return -1;
+
+    for (int op = 0; op < YCSB_NR_OPS; op++) {
+        if (pct[op] < 0)
+            return -1;
+        sum += pct[op];
+    }
+
+    return sum == 100 ? 0 : -1;
+}
+
+static inline void ycsb_run(void *ctx, enum ycsb_op op, int lo, int hi)
+{
+    long sum = 0;
+
+    switch (op) {
+    case YCSB_READ:
+        sink = ops->find(ctx, lo);
+        break;
+    case YCSB_RMW:
+        sink = ops->find(ctx, lo);
+        /* fall through */
+    case YCSB_UPDATE:
+        /* leaves the key as it was, see mt_writer() */
+        if (!ops->remove(ctx, lo))
+            ops->insert(ctx, lo);
+        break;
+    case YCSB_INSERT:
+        ops->insert(ctx, lo);
+        break;
+    case YCSB_SCAN:
+        ops->range(ctx, lo, hi, scan_cb, &sum);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Run warmup operations of the mix untimed, then tree_size timed ones, and
+ * print a record of the whole run then one for each kind of operation of the
+ * mix, whose throughput counts them against the time of the whole run. Fresh
+ * keys are negative, below the loaded ones. The keys and operations are drawn
+ * from separate generators, leaving the keys of the other phases unchanged.
+ */
+static void bench_ycsb(void *ctx,
+                       size_t tree_size,
+                       unsigned int seed,
+                       const struct ycsb_mix *mix,
+                       size_t warmup,
+                       const struct zipf *zipf,
+                       int spread,
+                       int span)
+{
+    struct phase all, phases[YCSB_NR_OPS];
+    unsigned int op_seed = seed + 1, key_seed = seed;
+    size_t n = tree_size > 1 ? tree_size - 1 : 1;
+    int fresh = 0;
+
+    for (size_t i = 0; i < warmup + tree_size; i++) {
+        if (i == warmup) {
+            phase_begin(&all, "ycsb", tree_size);
+            for (int op = 0; op < YCSB_NR_OPS; op++)
+                phase_begin(&phases[op], ycsb_names[op], tree_size);
+        }
+
+        int r = rand_r(&op_seed) % 100, op = 0;
+        while (r >= mix->pct[op])
+            r -= mix->pct[op++];
+
+        int lo = zipf ? zipf_key(zipf, &key_seed)
+                      : (int) (seed ? rand_r(&key_seed) % n : i % n);
+        lo *= spread;
+        int hi = lo;
+        if (op == YCSB_INSERT) {
+            lo = -1 - fresh++;
+        } else if (op == YCSB_SCAN) {
+            long end = lo + (long) (rand_r(&key_seed) % span) * spread;
+            hi = end < INT_MAX ? end : INT_MAX;
+        }
+
+        if (i < warmup)
+            ycsb_run(ctx, op, lo, hi);
+        else
+            hist_record(&all.lat,
+                        phase_op(&phases[op], ycsb_run(ctx, op, lo, hi)));
+    }
+
+    phase_end(&all, false);
+    for (int op = 0; op < YCSB_NR_OPS; op++) {
+        if (mix->pct[op])
+            phase_end(&phases[op], false);
+    }
+}
+
+/* Growing tree, for the curves of tree-perf.py in a single run: insert the
+ * keys step at a time, and after each step record the insertions of the step,
+ * lookups of as many keys as the tree holds, and the removal of step of them,
+ * put back untimed, all at the size the tree reached. The keys are distinct,
+ * shuffled unless seed is 0, and only the inserted ones are looked up and
+ * removed. Return the number of keys.
+ */
+static size_t bench_series(void *ctx,
+                           size_t tree_size,
+                           unsigned int seed,
+                           size_t step,
+                           int spread)
+{
+    int *keys = malloc(sizeof(int) * tree_size);
+    struct phase p;
+    assert(keys);
+
+    for (size_t i = 0; i < tree_size; i++)
+        keys[i] = i * spread;
+    for (size_t i = tree_size; seed && i > 1; i--) {
+        size_t j = rand_r(&seed) % i;
+        int tmp = keys[i - 1];
+        keys[i - 1] = keys[j];
+        keys[j] = tmp;
+    }
+
+    for (size_t n = 0; n < tree_size;) {
+        size_t end = n + step < tree_size ? n + step : tree_size;
+
+        phase_begin(&p, "insert", end);
+        for (; n < end; n++)
+            phase_op(&p, ops->insert(ctx, keys[n]));
+        phase_end(&p, false);
+
+        phase_begin(&p, "find", n);
+        for (size_t i = 0; i < n; i++) {
+            int v = keys[seed ? rand_r(&seed) % n : i];
+            phase_op(&p, sink = ops->find(ctx, v));
+        }
+        phase_end(&p, false);
+
+        /* A window of shuffled keys is a random sample */
+        size_t nr = step < n ? step : n;
+        size_t first = seed ? rand_r(&seed) % (n - nr + 1) : n - nr;
+
+        phase_begin(&p, "remove", n);
+        for (size_t i = first; i < first + nr; i++)
+            phase_op(&p, ops->remove(ctx, keys[i]));
+        phase_end(&p, false);
+
+        for (size_t i = first; i < first + nr; i++)
+            ops->insert(ctx, keys[i]);
+    }
+
+    free(keys);
+    return tree_size;
+}
+
 int main(int argc, char *argv[])
 {
+    bool frozen = false, bulk = false, teardown = false, mem = false;
+    bool concurrent = false, mixed = false, scaling = false, set_ops = false;
+    bool percentiles = false, timers = false, snapshots = false;
+    int nr_threads = 1, span = 0, update_freq = 0, interval_span = 0;
+    int lookup_budget = 0, batch = 0, spread = 1;
+    double zipf_theta = 0;
+    const char *image = NULL, *workload = NULL;
+    struct ycsb_mix mix;
+    size_t warmup = 0, step = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv,
+                         "fbj:r:u:Dmcxpsqo:ta:z:k:w:ni:O:y:W:e:")) != -1) {
+        switch (opt) {
+        case 'f':
+            frozen = true;
+            break;
+        case 'b':
+            bulk = true;
+            break;
+        case 'j':
+            nr_threads = atoi(optarg);
+            if (nr_threads < 1)
+                argc = 0;
+            break;
+        case 'r':
+            span = atoi(optarg);
+            if (span < 1)
+                argc = 0;
+            break;
+        case 'u':
+            update_freq = atoi(optarg);
+            if (update_freq < 1)
+                argc = 0;
+            break;
+        case 'D':
+            teardown = true;
+            break;
+        case 'm':
+            mem = true;
+            break;
+        case 'c':
+            concurrent = true;
+            break;
+        case 'x':
+            mixed = true;
+            break;
+        case 'p':
+            scaling = true;
+            break;
+        case 's':
+            set_ops = true;
+            break;
+        case 'q':
+            percentiles = true;
+            break;
+        case 'o':
+            interval_span = atoi(optarg);
+            if (interval_span < 1)
+                argc = 0;
+            break;
+        case 't':
+            timers = true;
+            break;
+        case 'a':
+            lookup_budget = atoi(optarg);
+            if (lookup_budget < 1)
+                argc = 0;
+            break;
+        case 'z':
+            zipf_theta = atof(optarg);
+            if (zipf_theta <= 0 || zipf_theta >= 1)
+                argc = 0;
+            break;
+        case 'k':
+            batch = atoi(optarg);
+            if (batch < 1)
+                argc = 0;
+            break;
+        case 'w':
+            spread = atoi(optarg);
+            if (spread < 1)
+                argc = 0;
+            break;
+        case 'n':
+            snapshots = true;
+            break;
+        case 'i':
+            image = optarg;
+            break;
+        case 'O':
+            if (strcmp(optarg, "csv") == 0)
+                out_format = OUT_CSV;
+            else if (strcmp(optarg, "json") == 0)
+                out_format = OUT_JSON;
+            else
+                argc = 0;
+            break;
+        case 'y':
+            workload = optarg;
+            if (ycsb_parse(workload, &mix))
+                argc = 0;
+            break;
+        case 'W':
+            warmup = atol(optarg);
+            break;
+        case 'e':
+            step = atol(optarg);
+            if (step < 1)
+                argc = 0;
+            break;
+        default:
+            argc = 0;
+            break;
+        }
+    }
+    /* The growing tree replaces the insertions and lookups of the raw output */
+    if (step && (out_format == OUT_RAW || bulk || frozen))
+        argc = 0;
+
+    /* Shift the positional arguments back to argv[1] */
+    argc -= optind - 1;
+    argv += optind - 1;
+
     if (argc < 4) {
-        printf("usage: treeint <algo> <tree size> <seed>\n");
+        printf("usage: treeint [-f] [-b] [-j threads] [-r span] [-u freq] [-D] "
+               "[-m] [-c] [-x] [-p] [-s] [-q] [-o span] [-t] [-a budget] "
+               "[-z theta] [-k batch] [-w spread] [-n] [-i image] "
+               "[-O csv|json] [-y workload] [-W warmup] [-e step] <algo> "
+               "<tree size> <seed>\n");
+        printf("  -f: also benchmark lookups on a frozen snapshot\n");
+        printf("  -b: bulk-load the tree from sorted keys, not by insertion\n");
+        printf("  -j: number of threads for the parallel operations\n");
+        printf("  -r: also benchmark range scans over span keys\n");
+        printf("  -u: rebalance in batches, once every freq modifications\n");
+        printf("  -D: destroy the full tree instead of removing the keys\n");
+        printf("  -m: report the memory held by the tree after insertions\n");
+        printf("  -c: also benchmark lookups on threads against one writer\n");
+        printf("  -x: also benchmark a mixed workload on threads\n");
+        printf("  -p: also benchmark insertions and lookups on threads\n");
+        printf("  -s: also benchmark set operations on separate trees\n");
+        printf("  -q: also benchmark percentile queries\n");
+        printf("  -o: also benchmark overlap queries on intervals of up to "
+               "span keys\n");
+        printf("  -t: also benchmark a timer workload against heaps\n");
+        printf("  -a: splay the keys looked up, saving up budget rotations "
+               "per lookup\n");
+        printf("  -z: draw the keys looked up from a Zipf distribution of "
+               "parameter theta\n");
+        printf("  -k: also benchmark lookups in batches of batch keys\n");
+        printf("  -w: spread the keys inserted, looked up and removed over "
+               "spread times the tree size\n");
+        printf("  -n: also benchmark scans of snapshots on threads against "
+               "one writer\n");
+        printf("  -i: write the tree to image after insertions, and run the "
+               "other phases on\n      the image mapped back\n");
+        printf("  -O: print a csv or json record per phase instead of the "
+               "time of every\n      operation\n");
+        printf("  -y: also benchmark a YCSB workload, A to F or "
+               "read:update:insert:scan[:rmw]\n      percentages, scans "
+               "covering up to span keys (-r, 100 by default)\n");
+        printf("  -W: run warmup untimed lookups before the lookups, and "
+               "operations before the\n      workload\n");
+        printf("  -e: grow the tree step keys at a time, recording "
+               "insertions, lookups and\n      removals at each size, "
+               "with -O only\n");
         return -1;
     }
 
     if (strcmp(argv[1], "s-tree") == 0) {
         ops = &st_ops;
+    } else if (strcmp(argv[1], "s-tree-finger") == 0) {
+        ops = &stf_ops;
+    } else if (strcmp(argv[1], "s-tree-typed") == 0) {
+        ops = &stt_ops;
+    } else if (strcmp(argv[1], "s-tree-compact") == 0) {
+        ops = &stc_ops;
+    } else if (strcmp(argv[1], "s-tree-lc") == 0) {
+        ops = &stl_ops;
+    } else if (strcmp(argv[1], "s-tree-persistent") == 0) {
+        ops = &stp_ops;
     } else if (strcmp(argv[1], "rbtree") == 0) {
         ops = &rbtree_ops;
+    } else if (strcmp(argv[1], "rbtree-compact") == 0) {
+        ops = &rbc_ops;
+    } else if (strcmp(argv[1], "rbtree-os") == 0) {
+        ops = &rbo_ops;
+    } else if (strcmp(argv[1], "rbtree-seq") == 0) {
+        ops = &rbs_ops;
+    } else if (strcmp(argv[1], "skiplist") == 0) {
+        ops = &sl_ops;
+    } else if (strcmp(argv[1], "interval-tree") == 0) {
+        ops = &it_ops;
+    } else if (strcmp(argv[1], "bptree") == 0) {
+        ops = &bptree_ops;
+    } else if (strcmp(argv[1], "bptree-simd") == 0) {
+        ops = &bptree_simd_ops;
+    } else if (strcmp(argv[1], "art") == 0) {
+        ops = &art_ops;
+    } else if (strcmp(argv[1], "roaring") == 0) {
+        ops = &rr_ops;
+    } else if (strcmp(argv[1], "hashtable") == 0) {
+        ops = &ht_ops;
     } else {
         printf("Invalid algorithm %s\n", argv[1]);
         return -2;
     }
 
+    if (frozen && !ops->freeze) {
+        printf("Algorithm %s can't be frozen\n", argv[1]);
+        return -2;
+    }
+
+    if (bulk && !ops->build) {
+        printf("Algorithm %s can't be bulk-loaded\n", argv[1]);
+        return -2;
+    }
+
+    if (span && !ops->range) {
+        printf("Algorithm %s can't do range scans\n", argv[1]);
+        return -2;
+    }
+
+    if (teardown && nr_threads > 1 && !ops->destroy_parallel) {
+        printf("Algorithm %s can't be destroyed in parallel\n", argv[1]);
+        return -2;
+    }
+
+    if (update_freq && !ops->set_update_freq) {
+        printf("Algorithm %s can't defer its updates\n", argv[1]);
+        return -2;
+    }
+
+    if (lookup_budget && !ops->set_lookup_budget) {
+        printf("Algorithm %s can't adjust itself on lookups\n", argv[1]);
+        return -2;
+    }
+
+    if (batch && !ops->find_batch) {
+        printf("Algorithm %s can't look keys up in batches\n", argv[1]);
+        return -2;
+    }
+
+    if (set_ops && (!ops->set_op || !ops->range_delete)) {
+        printf("Algorithm %s can't do set operations\n", argv[1]);
+        return -2;
+    }
+
+    if (percentiles && (!ops->rank || !ops->select || !ops->range)) {
+        printf("Algorithm %s can't do order statistics\n", argv[1]);
+        return -2;
+    }
+
+    if (interval_span && (!ops->insert_interval || !ops->overlap)) {
+        printf("Algorithm %s can't hold intervals\n", argv[1]);
+        return -2;
+    }
+
+    if (timers && (!ops->peek_min || !ops->pop_min || !ops->decrease_key)) {
+        printf("Algorithm %s can't be used as a priority queue\n", argv[1]);
+        return -2;
+    }
+
+    if (snapshots && (!ops->snapshot || !ops->range)) {
+        printf("Algorithm %s can't take snapshots\n", argv[1]);
+        return -2;
+    }
+
+    if (image && (!ops->save || !ops->load)) {
+        printf("Algorithm %s can't be saved to an image\n", argv[1]);
+        return -2;
+    }
+
+    if (workload && mix.pct[YCSB_SCAN] && !ops->range) {
+        printf("Algorithm %s can't do range scans\n", argv[1]);
+        return -2;
+    }
+
+    if (mem && !ops->memsize) {
+        printf("Algorithm %s can't report its memory usage\n", argv[1]);
+        return -2;
+    }
+
     size_t tree_size = 0;
     if (!sscanf(argv[2], "%ld", &tree_size)) {
         printf("Invalid tree size %s\n", argv[2]);
         return -3;
     }
 
+    if (tree_size > (size_t) INT_MAX / spread) {
+        printf("Keys spread over %zu * %d overflow an int\n", tree_size,
+               spread);
+        return -3;
+    }
+
     /* Note: seed 0 is reserved as special value, it will
      * perform linear operatoion. */
     size_t seed = 0;
@@ -81,36 +1952,247 @@ int main(int argc, char *argv[])
     }
 
     srand(seed);
+    if (out_format != OUT_RAW || workload)
+        tick_calibrate();
+    bool raw = out_format == OUT_RAW;
 
     void *ctx = ops->init();
+    if (update_freq)
+        ops->set_update_freq(ctx, update_freq);
+    if (lookup_budget)
+        ops->set_lookup_budget(ctx, lookup_budget);
 
-    long long insert_time = 0;
-    for (size_t i = 0; i < tree_size; ++i) {
-        int v = seed ? rand_key(tree_size) : i;
-        insert_time = bench(ops->insert(ctx, v));
-        printf("%lld,", insert_time);
+    struct phase phase;
+    size_t nr_keys = 0;
+    if (step) {
+        nr_keys = bench_series(ctx, tree_size, seed, step, spread);
+    } else if (bulk) {
+        /* Bulk-load the keys that would have been inserted one by one, and
+         * report the time of the whole build instead of per-key times.
+         */
+        int *sorted = malloc(sizeof(int) * tree_size);
+        assert(sorted);
+
+        size_t nr = 0;
+        for (size_t i = 0; i < tree_size; ++i)
+            sorted[i] = (seed ? rand_key(tree_size) : i) * spread;
+        if (seed) {
+            qsort(sorted, tree_size, sizeof(int), cmp_int);
+            for (size_t i = 0; i < tree_size; ++i) {
+                if (!nr || sorted[nr - 1] != sorted[i])
+                    sorted[nr++] = sorted[i];
+            }
+        } else {
+            nr = tree_size;
+        }
+
+        phase_begin(&phase, "build", nr);
+        time_op(&phase, ",", ops->build(ctx, sorted, nr, nr_threads));
+        phase_end(&phase, raw);
+        free(sorted);
+        nr_keys = nr;
+    } else {
+        phase_begin(&phase, "insert", tree_size);
+        for (size_t i = 0; i < tree_size; ++i) {
+            int v = (seed ? rand_key(tree_size) : i) * spread;
+            int ret;
+            time_op(&phase, ",", ret = ops->insert(ctx, v));
+            if (!ret)
+                nr_keys++;
+        }
+        phase_end(&phase, raw);
+    }
+
+    if (mem) {
+        /* Total bytes and bytes per key, duplicate keys are not counted */
+        size_t bytes = ops->memsize(ctx);
+        if (raw)
+            printf("%zu,%.2f\n", bytes,
+                   nr_keys ? (double) bytes / nr_keys : 0);
+        else
+            record_print(&(struct record){
+                .name = "memory",
+                .size = tree_size,
+                .ops = nr_keys,
+                .bytes = bytes,
+            });
+    }
+
+    if (image) {
+        /* Replace the tree with its image, as a restart would, and report the
+         * time to write the image then to map it back. The phases that follow
+         * query the image in place and copy the pages they modify.
+         */
+        int ret;
+        long long save_time = bench(ret = ops->save(ctx, image));
+        if (ret) {
+            printf("Can't write image %s\n", image);
+            return -3;
+        }
+        ops->destroy(ctx);
+
+        long long load_time = bench(ctx = ops->load(image));
+        if (!ctx) {
+            printf("Can't map image %s\n", image);
+            return -3;
+        }
+        if (raw) {
+            printf("%lld,%lld\n", save_time, load_time);
+        } else {
+            record_total("save", tree_size, 1, save_time);
+            record_total("load", tree_size, 1, load_time);
+        }
     }
-    printf("\n");
 
     pr_debug("[ After insertions ]\n");
     ops->dump(ctx, LEVEL_ORDER);
 
-    long long find_time = 0;
-    for (size_t i = 0; i < tree_size; ++i) {
-        int v = seed ? rand_key(tree_size) : i;
-        find_time = bench(ops->find(ctx, v));
-        printf("%lld, ", find_time);
+    /* Frozen lookups replay the keys of the live ones */
+    int *keys = NULL;
+    if (frozen) {
+        keys = malloc(sizeof(int) * tree_size);
+        assert(keys);
+    }
+
+    /* Skewed lookups follow the same Zipf distribution whatever the seed */
+    struct zipf zipf = {0};
+    unsigned int zipf_seed = seed;
+    if (zipf_theta)
+        zipf_init(&zipf, tree_size > 1 ? tree_size - 1 : 1, zipf_theta);
+
+    /* Warm the caches and branch predictors up with lookups of their own,
+     * leaving the keys of the phases unchanged
+     */
+    unsigned int warmup_seed = seed;
+    for (size_t i = 0; !step && i < warmup; ++i) {
+        int v = seed && tree_size > 1 ? rand_r(&warmup_seed) % (tree_size - 1)
+                                      : i % tree_size;
+        sink = ops->find(ctx, v * spread);
+    }
+
+    if (!step) {
+        phase_begin(&phase, "find", tree_size);
+        for (size_t i = 0; i < tree_size; ++i) {
+            int v = seed ? rand_key(tree_size) : i;
+            if (zipf_theta)
+                v = zipf_key(&zipf, &zipf_seed);
+            v *= spread;
+            if (keys)
+                keys[i] = v;
+            time_op(&phase, ", ", sink = ops->find(ctx, v));
+        }
+        phase_end(&phase, raw);
+    }
+
+    if (frozen) {
+        struct ez_tree *ez = ops->freeze(ctx);
+
+        phase_begin(&phase, "find-frozen", tree_size);
+        for (size_t i = 0; i < tree_size; ++i)
+            time_op(&phase, ", ", sink = ez_find(ez, keys[i]));
+        phase_end(&phase, raw);
+
+        ez_destroy(ez);
+        free(keys);
+    }
+
+    if (span) {
+        /* Scan tree_size / span ranges, and report the number of keys visited,
+         * the total time and the resulting keys per second. The start of the
+         * ranges is drawn from a separate generator to leave the keys of the
+         * other phases unchanged. The summary records count the scans instead.
+         */
+        unsigned int scan_seed = seed;
+        size_t n = tree_size > 1 ? tree_size - 1 : 1;
+        size_t nr_scans = tree_size / span ? tree_size / span : 1;
+        size_t visited = 0;
+        long long scan_time = 0;
+        long sum = 0;
+
+        /* Untimed, every key at once, which also checks the range bounds */
+        if (ops->range(ctx, INT_MIN, INT_MAX, scan_cb, &sum) != nr_keys) {
+            printf("Algorithm %s missed keys in a scan of the int range\n",
+                   argv[1]);
+            return -3;
+        }
+
+        phase_begin(&phase, "range", tree_size);
+        for (size_t i = 0; i < nr_scans; ++i) {
+            /* span keys apart by spread, as inserted */
+            int lo = (seed ? rand_r(&scan_seed) % n : i * span) * spread;
+            long end = lo + (long) (span - 1) * spread;
+            int hi = end < INT_MAX ? end : INT_MAX;
+            if (raw)
+                scan_time += bench(
+                    visited += ops->range(ctx, lo, hi, scan_cb, &sum));
+            else
+                phase_op(&phase, ops->range(ctx, lo, hi, scan_cb, &sum));
+        }
+        if (raw)
+            printf("%zu,%lld,%.0f\n", visited, scan_time,
+                   scan_time ? visited * 1e9 / scan_time : 0);
+        else
+            phase_end(&phase, false);
+    }
+
+    if (batch)
+        bench_batch(ctx, tree_size, seed, batch);
+
+    if (workload)
+        bench_ycsb(ctx, tree_size, seed, &mix, warmup,
+                   zipf_theta ? &zipf : NULL, spread, span ? span : 100);
+
+    if (concurrent)
+        bench_concurrent(ctx, tree_size, seed, nr_threads);
+
+    if (snapshots)
+        bench_snapshots(ctx, tree_size, seed, nr_threads);
+
+    if (mixed)
+        bench_mixed(ctx, tree_size, seed, nr_threads);
+
+    if (scaling)
+        bench_scaling(ctx, tree_size, seed, nr_threads);
+
+    if (set_ops)
+        bench_set_ops(tree_size, seed, nr_threads);
+
+    if (percentiles)
+        bench_percentiles(ctx, tree_size, seed);
+
+    if (interval_span)
+        bench_overlap(tree_size, seed, interval_span);
+
+    if (timers)
+        bench_timers(tree_size, seed);
+
+    if (teardown) {
+        /* Report the time to free the whole tree in place of the removals */
+        long long destroy_time;
+        if (nr_threads > 1)
+            destroy_time = bench(ops->destroy_parallel(ctx, nr_threads));
+        else
+            destroy_time = bench(ops->destroy(ctx));
+        if (raw)
+            printf("%lld,\n", destroy_time);
+        else
+            record_total("destroy", tree_size, nr_keys, destroy_time);
+        return 0;
+    }
+
+    if (step) {
+        /* The removals were recorded along the way */
+        ops->destroy(ctx);
+        return 0;
     }
-    printf("\n");
 
     pr_debug("Removing...\n");
-    long long remove_time = 0;
+    phase_begin(&phase, "remove", tree_size);
     for (size_t i = 0; i < tree_size; ++i) {
-        int v = seed ? rand_key(tree_size) : i;
-        remove_time = bench(ops->remove(ctx, v));
-        printf("%lld, ", remove_time);
+        int v = (seed ? rand_key(tree_size) : i) * spread;
+        time_op(&phase, ", ", ops->remove(ctx, v));
     }
-    printf("\n");
+    phase_end(&phase, raw);
 
     pr_debug("[ After removals ]\n");
     ops->dump(ctx, LEVEL_ORDER);
@@ -0,0 +1,69 @@
+#include "treeint_art.h"
+#include <assert.h>
+#include <limits.h>
+#include "art.h"
+#include "common.h"
+
+void *treeint_art_init()
+{
+    struct art *tree = art_create();
+    assert(tree);
+    return tree;
+}
+
+int treeint_art_destroy(void *ctx)
+{
+    struct art *tree = (struct art *) ctx;
+
+    assert(tree);
+    art_destroy(tree);
+    return 0;
+}
+
+int treeint_art_insert(void *ctx, int a)
+{
+    return art_insert((struct art *) ctx, a);
+}
+
+void *treeint_art_find(void *ctx, int a)
+{
+    return art_find((struct art *) ctx, a);
+}
+
+int treeint_art_remove(void *ctx, int a)
+{
+    return art_remove((struct art *) ctx, a);
+}
+
+size_t treeint_art_range(void *ctx,
+                         int lo,
+                         int hi,
+                         treeint_scan_cb *cb,
+                         void *arg)
+{
+    return art_range((struct art *) ctx, lo, hi, cb, arg);
+}
+
+size_t treeint_art_memsize(void *ctx)
+{
+    return art_memsize((struct art *) ctx);
+}
+
+#ifdef PRINT_DEBUG
+static void treeint_art_dump_cb(int key, __unused void *arg)
+{
+    pr_debug("%d,", key);
+}
+
+/* The keys are not stored in nodes of their own, so both modes list them in
+ * order
+ */
+void treeint_art_dump(void *ctx, __unused enum dump_mode mode)
+{
+    pr_debug("[");
+    art_range((struct art *) ctx, INT_MIN, INT_MAX, treeint_art_dump_cb, NULL);
+    pr_debug("]\n");
+}
+#else
+void treeint_art_dump(__unused void *ctx, __unused enum dump_mode mode) {}
+#endif
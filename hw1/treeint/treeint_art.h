@@ -0,0 +1,20 @@
+#ifndef TREEINT_ART_H
+#define TREEINT_ART_H
+
+#include <stddef.h>
+#include "treeint_common.h"
+
+extern void *treeint_art_init();
+extern int treeint_art_destroy(void *ctx);
+extern int treeint_art_insert(void *ctx, int a);
+extern void *treeint_art_find(void *ctx, int a);
+extern int treeint_art_remove(void *ctx, int a);
+extern size_t treeint_art_range(void *ctx,
+                                int lo,
+                                int hi,
+                                treeint_scan_cb *cb,
+                                void *arg);
+extern size_t treeint_art_memsize(void *ctx);
+extern void treeint_art_dump(void *ctx, enum dump_mode mode);
+
+#endif
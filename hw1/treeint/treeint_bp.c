@@ -0,0 +1,146 @@
+#include "treeint_bp.h"
+#include <assert.h>
+#include "bptree.h"
+#include "common.h"
+
+void *treeint_bp_init()
+{
+    struct bptree *tree = bptree_create(0);
+    assert(tree);
+    return tree;
+}
+
+void *treeint_bp_simd_init()
+{
+    struct bptree *tree = bptree_create(BPTREE_SIMD);
+    assert(tree);
+    return tree;
+}
+
+int treeint_bp_destroy(void *ctx)
+{
+    struct bptree *tree = (struct bptree *) ctx;
+
+    assert(tree);
+    bptree_destroy(tree);
+    return 0;
+}
+
+int treeint_bp_insert(void *ctx, int a)
+{
+    return bptree_insert((struct bptree *) ctx, a);
+}
+
+void *treeint_bp_find(void *ctx, int a)
+{
+    return bptree_find((struct bptree *) ctx, a);
+}
+
+int treeint_bp_remove(void *ctx, int a)
+{
+    return bptree_remove((struct bptree *) ctx, a);
+}
+
+size_t treeint_bp_memsize(void *ctx)
+{
+    return bptree_memsize((struct bptree *) ctx);
+}
+
+size_t treeint_bp_range(void *ctx,
+                        int lo,
+                        int hi,
+                        treeint_scan_cb *cb,
+                        void *arg)
+{
+    struct bptree *tree = (struct bptree *) ctx;
+    unsigned int i;
+    size_t nr = 0;
+
+    for (struct bp_leaf *leaf = bptree_lower_bound(tree, lo, &i); leaf;
+         leaf = leaf->next, i = 0) {
+        /* the next leaf is only reachable through this one, fetch it while
+         * the keys of the current one are being visited
+         */
+        if (leaf->next)
+            __builtin_prefetch(leaf->next);
+
+        for (; i < leaf->hdr.nr; i++) {
+            if (leaf->keys[i] > hi)
+                return nr;
+            cb(leaf->keys[i], arg);
+            nr++;
+        }
+    }
+
+    return nr;
+}
+
+#ifdef PRINT_DEBUG
+static void treeint_bp_dump_preorder(struct bp_node *n, int height)
+{
+    if (!height) {
+        struct bp_leaf *leaf = (struct bp_leaf *) n;
+        for (unsigned int i = 0; i < n->nr; i++)
+            pr_debug("%d\n", leaf->keys[i]);
+        return;
+    }
+
+    struct bp_inner *in = (struct bp_inner *) n;
+    for (unsigned int i = 0; i <= n->nr; i++)
+        treeint_bp_dump_preorder(in->child[i], height - 1);
+}
+
+static void __treeint_bp_dump_lvorder(struct bp_node *n, int level)
+{
+    struct bp_inner *in = (struct bp_inner *) n;
+
+    /* Only called for inner levels, the leaves are dumped separately */
+    if (level == 0) {
+        pr_debug("(");
+        for (unsigned int i = 0; i < n->nr; i++)
+            pr_debug("%d%s", in->keys[i], i + 1 < n->nr ? " " : "");
+        pr_debug("),");
+        return;
+    }
+
+    for (unsigned int i = 0; i <= n->nr; i++)
+        __treeint_bp_dump_lvorder(in->child[i], level - 1);
+}
+
+static void treeint_bp_dump_lvorder(struct bptree *tree)
+{
+    if (!tree->root)
+        return;
+
+    for (int i = 0; i < tree->height; i++)
+        __treeint_bp_dump_lvorder(tree->root, i);
+
+    /* leaves are chained, so walk them through the sibling links */
+    struct bp_node *n = tree->root;
+    for (int h = 0; h < tree->height; h++)
+        n = ((struct bp_inner *) n)->child[0];
+
+    for (struct bp_leaf *leaf = (struct bp_leaf *) n; leaf;
+         leaf = leaf->next) {
+        pr_debug("(");
+        for (unsigned int i = 0; i < leaf->hdr.nr; i++)
+            pr_debug("%d%s", leaf->keys[i], i + 1 < leaf->hdr.nr ? " " : "");
+        pr_debug("),");
+    }
+}
+
+void treeint_bp_dump(void *ctx, enum dump_mode mode)
+{
+    struct bptree *tree = (struct bptree *) ctx;
+
+    pr_debug("[");
+    if (mode == PRE_ORDER) {
+        if (tree->root)
+            treeint_bp_dump_preorder(tree->root, tree->height);
+    } else
+        treeint_bp_dump_lvorder(tree);
+    pr_debug("]\n");
+}
+#else
+void treeint_bp_dump(__unused void *ctx, __unused enum dump_mode mode) {}
+#endif
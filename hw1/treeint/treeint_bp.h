@@ -0,0 +1,21 @@
+#ifndef TREEINT_BP_H
+#define TREEINT_BP_H
+
+#include <stddef.h>
+#include "treeint_common.h"
+
+extern void *treeint_bp_init();
+extern void *treeint_bp_simd_init();
+extern int treeint_bp_destroy(void *ctx);
+extern int treeint_bp_insert(void *ctx, int a);
+extern void *treeint_bp_find(void *ctx, int a);
+extern int treeint_bp_remove(void *ctx, int a);
+extern size_t treeint_bp_range(void *ctx,
+                               int lo,
+                               int hi,
+                               treeint_scan_cb *cb,
+                               void *arg);
+extern size_t treeint_bp_memsize(void *ctx);
+extern void treeint_bp_dump(void *ctx, enum dump_mode mode);
+
+#endif
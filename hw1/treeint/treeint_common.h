@@ -6,4 +6,13 @@ enum dump_mode {
     LEVEL_ORDER,
 };
 
+enum treeint_set_op {
+    SET_UNION,
+    SET_INTERSECTION,
+    SET_DIFFERENCE,
+};
+
+/* Called on each key visited by a range scan, in ascending order */
+typedef void treeint_scan_cb(int key, void *arg);
+
 #endif
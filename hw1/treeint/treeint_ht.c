@@ -0,0 +1,57 @@
+#include "treeint_ht.h"
+#include <assert.h>
+#include "common.h"
+#include "hashtable.h"
+
+void *treeint_ht_init()
+{
+    struct hashtable *ht = ht_create();
+    assert(ht);
+    return ht;
+}
+
+int treeint_ht_destroy(void *ctx)
+{
+    struct hashtable *ht = (struct hashtable *) ctx;
+
+    assert(ht);
+    ht_destroy(ht);
+    return 0;
+}
+
+int treeint_ht_insert(void *ctx, int a)
+{
+    return ht_insert((struct hashtable *) ctx, a);
+}
+
+void *treeint_ht_find(void *ctx, int a)
+{
+    return ht_find((struct hashtable *) ctx, a);
+}
+
+int treeint_ht_remove(void *ctx, int a)
+{
+    return ht_remove((struct hashtable *) ctx, a);
+}
+
+size_t treeint_ht_memsize(void *ctx)
+{
+    return ht_memsize((struct hashtable *) ctx);
+}
+
+#ifdef PRINT_DEBUG
+/* There is no order to dump the keys in, so both modes list them by slot */
+void treeint_ht_dump(void *ctx, __unused enum dump_mode mode)
+{
+    struct hashtable *ht = (struct hashtable *) ctx;
+
+    pr_debug("[");
+    for (size_t i = 0; i < (ht->mask + 1) * HT_GROUP_SIZE; i++) {
+        if (ht->ctrl[i] < HT_EMPTY)
+            pr_debug("%d,", ht->keys[i]);
+    }
+    pr_debug("]\n");
+}
+#else
+void treeint_ht_dump(__unused void *ctx, __unused enum dump_mode mode) {}
+#endif
@@ -0,0 +1,15 @@
+#ifndef TREEINT_HT_H
+#define TREEINT_HT_H
+
+#include <stddef.h>
+#include "treeint_common.h"
+
+extern void *treeint_ht_init();
+extern int treeint_ht_destroy(void *ctx);
+extern int treeint_ht_insert(void *ctx, int a);
+extern void *treeint_ht_find(void *ctx, int a);
+extern int treeint_ht_remove(void *ctx, int a);
+extern size_t treeint_ht_memsize(void *ctx);
+extern void treeint_ht_dump(void *ctx, enum dump_mode mode);
+
+#endif
@@ -0,0 +1,186 @@
+#include "treeint_it.h"
+#include <assert.h>
+#include "common.h"
+#include "interval_tree.h"
+
+/* A key a is held as the interval [a, a], so that the interval tree can stand
+ * in for a set of keys, range scans being overlap queries.
+ */
+
+struct treeint_it {
+    struct rb_root root;
+    size_t nr_nodes;
+};
+
+void *treeint_it_init()
+{
+    struct treeint_it *tree = calloc(sizeof(struct treeint_it), 1);
+    assert(tree);
+
+    tree->root = RB_ROOT;
+    return tree;
+}
+
+/* see __treeint_rb_destroy() */
+int treeint_it_destroy(void *ctx)
+{
+    struct treeint_it *tree = (struct treeint_it *) ctx;
+    struct rb_node *n = tree->root.rb_node;
+
+    while (n) {
+        struct rb_node *l = rb_left(n);
+
+        if (l) {
+            rb_left(n) = rb_right(l);
+            rb_right(l) = n;
+            n = l;
+        } else {
+            struct rb_node *r = rb_right(n);
+            free(container_of(n, struct it_node, rb));
+            n = r;
+        }
+    }
+
+    free(tree);
+    return 0;
+}
+
+int treeint_it_insert_interval(void *ctx, int start, int last)
+{
+    struct treeint_it *tree = (struct treeint_it *) ctx;
+    struct it_node *node = malloc(sizeof(struct it_node));
+    assert(node);
+
+    node->start = start;
+    node->last = last;
+    it_insert(node, &tree->root);
+    tree->nr_nodes++;
+    return 0;
+}
+
+int treeint_it_insert(void *ctx, int a)
+{
+    struct treeint_it *tree = (struct treeint_it *) ctx;
+
+    if (it_find(&tree->root, a, a))
+        return -1;
+
+    return treeint_it_insert_interval(ctx, a, a);
+}
+
+void *treeint_it_find(void *ctx, int a)
+{
+    return it_find(&((struct treeint_it *) ctx)->root, a, a);
+}
+
+int treeint_it_remove(void *ctx, int a)
+{
+    struct treeint_it *tree = (struct treeint_it *) ctx;
+    struct it_node *node = it_find(&tree->root, a, a);
+
+    if (!node)
+        return -1;
+
+    it_remove(node, &tree->root);
+    tree->nr_nodes--;
+    free(node);
+    return 0;
+}
+
+/* Visit the start of every interval overlapping [lo, hi], in order */
+size_t treeint_it_overlap(void *ctx,
+                          int lo,
+                          int hi,
+                          treeint_scan_cb *cb,
+                          void *arg)
+{
+    struct treeint_it *tree = (struct treeint_it *) ctx;
+    size_t nr = 0;
+
+    for (struct it_node *n = it_iter_first(&tree->root, lo, hi); n;
+         n = it_iter_next(n, lo, hi)) {
+        cb(n->start, arg);
+        nr++;
+    }
+
+    return nr;
+}
+
+size_t treeint_it_range(void *ctx,
+                        int lo,
+                        int hi,
+                        treeint_scan_cb *cb,
+                        void *arg)
+{
+    return treeint_it_overlap(ctx, lo, hi, cb, arg);
+}
+
+size_t treeint_it_memsize(void *ctx)
+{
+    struct treeint_it *tree = (struct treeint_it *) ctx;
+    return sizeof(*tree) + tree->nr_nodes * sizeof(struct it_node);
+}
+
+#ifdef PRINT_DEBUG
+static void treeint_it_dump_preorder(struct rb_node *n)
+{
+    if (!n)
+        return;
+
+    treeint_it_dump_preorder(rb_left(n));
+    struct it_node *node = container_of(n, struct it_node, rb);
+    pr_debug("[%d,%d]\n", node->start, node->last);
+    treeint_it_dump_preorder(rb_right(n));
+}
+
+static int treeint_it_height(struct rb_node *node)
+{
+    if (node == NULL)
+        return 0;
+
+    int lheight = treeint_it_height(rb_left(node));
+    int rheight = treeint_it_height(rb_right(node));
+
+    return (lheight > rheight) ? (lheight + 1) : (rheight + 1);
+}
+
+/* Each interval is followed by the largest end of its subtree */
+static void __treeint_it_dump_lvorder(struct rb_node *node, int level)
+{
+    if (node == NULL) {
+        if (level == 1)
+            pr_debug("null,");
+        return;
+    }
+
+    if (level == 1) {
+        struct it_node *n = container_of(node, struct it_node, rb);
+        pr_debug("[%d,%d]/%d,", n->start, n->last, n->subtree_last);
+        return;
+    }
+
+    __treeint_it_dump_lvorder(rb_left(node), level - 1);
+    __treeint_it_dump_lvorder(rb_right(node), level - 1);
+}
+
+static void treeint_it_dump_lvorder(struct rb_node *root)
+{
+    int h = treeint_it_height(root);
+    for (int i = 1; i <= h; i++)
+        __treeint_it_dump_lvorder(root, i);
+}
+
+void treeint_it_dump(void *ctx, enum dump_mode mode)
+{
+    struct treeint_it *tree = (struct treeint_it *) ctx;
+
+    pr_debug("[");
+    if (mode == PRE_ORDER)
+        treeint_it_dump_preorder(tree->root.rb_node);
+    else
+        treeint_it_dump_lvorder(tree->root.rb_node);
+    pr_debug("]\n");
+}
+#else
+void treeint_it_dump(__unused void *ctx, __unused enum dump_mode mode) {}
+#endif
@@ -0,0 +1,26 @@
+#ifndef TREEINT_IT_H
+#define TREEINT_IT_H
+
+#include <stddef.h>
+#include "treeint_common.h"
+
+extern void *treeint_it_init();
+extern int treeint_it_destroy(void *ctx);
+extern int treeint_it_insert(void *ctx, int a);
+extern void *treeint_it_find(void *ctx, int a);
+extern int treeint_it_remove(void *ctx, int a);
+extern size_t treeint_it_range(void *ctx,
+                               int lo,
+                               int hi,
+                               treeint_scan_cb *cb,
+                               void *arg);
+extern int treeint_it_insert_interval(void *ctx, int start, int last);
+extern size_t treeint_it_overlap(void *ctx,
+                                 int lo,
+                                 int hi,
+                                 treeint_scan_cb *cb,
+                                 void *arg);
+extern size_t treeint_it_memsize(void *ctx);
+extern void treeint_it_dump(void *ctx, enum dump_mode mode);
+
+#endif
@@ -1,6 +1,8 @@
 #include "treeint_rb.h"
 #include <assert.h>
+#include <pthread.h>
 #include "common.h"
+#include "eytzinger.h"
 #include "rbtree.h"
 
 #define treeint_rb_entry(ptr) container_of(ptr, struct treeint_rb, rb_n)
@@ -12,76 +14,139 @@ struct treeint_rb {
 
 void *treeint_rb_init()
 {
-    struct rb_root *root;
-    root = calloc(sizeof(struct rb_root), 1);
-    *root = RB_ROOT;
+    struct rb_root_cached *root;
+    root = calloc(sizeof(struct rb_root_cached), 1);
+    *root = RB_ROOT_CACHED;
     return root;
 }
 
+/* Free a subtree without recursion, by rotating left children onto the right
+ * spine as in __st_destroy().
+ */
 static void __treeint_rb_destroy(struct rb_node *n)
 {
-    if (rb_left(n))
-        __treeint_rb_destroy(rb_left(n));
-
-    if (rb_right(n))
-        __treeint_rb_destroy(rb_right(n));
-
-    struct treeint_rb *entry = treeint_rb_entry(n);
-    free(entry);
+    while (n) {
+        struct rb_node *l = rb_left(n);
+
+        if (l) {
+            rb_left(n) = rb_right(l);
+            rb_right(l) = n;
+            n = l;
+        } else {
+            struct rb_node *r = rb_right(n);
+            free(treeint_rb_entry(n));
+            n = r;
+        }
+    }
 }
 
 int treeint_rb_destroy(void *ctx)
 {
-    struct rb_root *root = (struct rb_root *) ctx;
-    if (rb_root(root))
-        __treeint_rb_destroy(rb_root(root));
+    struct rb_root_cached *root = ctx;
+    __treeint_rb_destroy(root->rb_root.rb_node);
 
     free(root);
     return 0;
 }
 
-static struct treeint_rb *__treeint_rb_insert(void *ctx, int a)
+static void __treeint_rb_destroy_parallel(struct rb_node *n, int spawn);
+
+struct treeint_rb_destroy_job {
+    struct rb_node *root;
+    int spawn;
+};
+
+static void *treeint_rb_destroy_worker(void *arg)
+{
+    struct treeint_rb_destroy_job *job = arg;
+
+    __treeint_rb_destroy_parallel(job->root, job->spawn);
+    return NULL;
+}
+
+static void __treeint_rb_destroy_parallel(struct rb_node *n, int spawn)
+{
+    pthread_t worker;
+
+    if (!n)
+        return;
+
+    if (spawn > 0 && rb_left(n) && rb_right(n)) {
+        struct treeint_rb_destroy_job job = {
+            .root = rb_left(n),
+            .spawn = spawn - 1,
+        };
+
+        if (!pthread_create(&worker, NULL, treeint_rb_destroy_worker, &job)) {
+            __treeint_rb_destroy_parallel(rb_right(n), spawn - 1);
+            pthread_join(worker, NULL);
+            free(treeint_rb_entry(n));
+            return;
+        }
+    }
+
+    __treeint_rb_destroy(n);
+}
+
+int treeint_rb_destroy_parallel(void *ctx, int nr_threads)
 {
-    struct rb_root *root = (struct rb_root *) ctx;
+    struct rb_root_cached *root = ctx;
+    int spawn = 0;
+
+    while ((1 << spawn) < nr_threads)
+        spawn++;
+
+    __treeint_rb_destroy_parallel(root->rb_root.rb_node, spawn);
 
-    struct rb_node **n = &rb_root(root);
+    free(root);
+    return 0;
+}
+
+/* Link i under its place for i->value, or fail if the value is present */
+static int __treeint_rb_insert(struct rb_root_cached *root,
+                               struct treeint_rb *i)
+{
+    struct rb_node **n = &root->rb_root.rb_node;
     struct rb_node *p = NULL;
     struct treeint_rb *entry;
+    bool leftmost = true;
 
     while (*n) {
         p = *n;
         entry = treeint_rb_entry(p);
-        if (a == entry->value)
-            return NULL;
+        if (i->value == entry->value)
+            return -1;
 
-        if (a < entry->value)
+        if (i->value < entry->value) {
             n = &(*n)->rb_left;
-        else if (a > entry->value)
+        } else {
             n = &(*n)->rb_right;
+            leftmost = false;
+        }
     }
 
-    struct treeint_rb *i = calloc(sizeof(struct treeint_rb), 1);
-    assert(i);
-    i->value = a;
     rb_link_node(&i->rb_n, p, n);
-    return i;
+    rb_insert_color_cached(&i->rb_n, root, leftmost);
+    return 0;
 }
 
 int treeint_rb_insert(void *ctx, int a)
 {
-    struct treeint_rb *node = __treeint_rb_insert(ctx, a);
-    if (node == NULL)
-        return -1;
+    struct treeint_rb *node = calloc(sizeof(struct treeint_rb), 1);
+    assert(node);
+    node->value = a;
 
-    struct rb_root *root = (struct rb_root *) ctx;
-    rb_insert_color(&node->rb_n, root);
+    if (__treeint_rb_insert(ctx, node)) {
+        free(node);
+        return -1;
+    }
     return 0;
 }
 
 void *treeint_rb_find(void *ctx, int a)
 {
-    struct rb_root *root = (struct rb_root *) ctx;
-    struct rb_node *n = rb_root(root);
+    struct rb_root_cached *root = ctx;
+    struct rb_node *n = root->rb_root.rb_node;
     struct treeint_rb *entry;
 
     while (n) {
@@ -98,19 +163,274 @@ void *treeint_rb_find(void *ctx, int a)
     return NULL;
 }
 
+/* Descents in flight in treeint_rb_find_batch(), see st_find_batch() */
+#define TREEINT_RB_BATCH_WIDTH 16
+
+size_t treeint_rb_find_batch(void *ctx,
+                             const int *keys,
+                             size_t nr,
+                             void **out)
+{
+    struct rb_root_cached *root = ctx;
+    struct rb_node *top = root->rb_root.rb_node;
+    struct {
+        struct rb_node *n;
+        size_t i;
+    } slot[TREEINT_RB_BATCH_WIDTH];
+    size_t next = 0, nr_slots = 0, found = 0;
+
+    if (!top) {
+        for (size_t i = 0; i < nr; i++)
+            out[i] = NULL;
+        return 0;
+    }
+
+    while (nr_slots < TREEINT_RB_BATCH_WIDTH && next < nr) {
+        slot[nr_slots].n = top;
+        slot[nr_slots++].i = next++;
+    }
+
+    while (nr_slots) {
+        for (size_t s = 0; s < nr_slots;) {
+            struct rb_node *n = slot[s].n;
+            size_t i = slot[s].i;
+            struct treeint_rb *entry = treeint_rb_entry(n);
+
+            if (keys[i] != entry->value) {
+                n = keys[i] < entry->value ? n->rb_left : n->rb_right;
+                if (n) {
+                    /* The value sits in front of the node */
+                    __builtin_prefetch(treeint_rb_entry(n));
+                    slot[s++].n = n;
+                    continue;
+                }
+                entry = NULL;
+            }
+
+            out[i] = entry;
+            found += !!entry;
+
+            if (next < nr) {
+                slot[s].n = top;
+                slot[s++].i = next++;
+            } else {
+                slot[s] = slot[--nr_slots];
+            }
+        }
+    }
+
+    return found;
+}
+
+size_t treeint_rb_range(void *ctx,
+                        int lo,
+                        int hi,
+                        treeint_scan_cb *cb,
+                        void *arg)
+{
+    struct rb_root_cached *root = ctx;
+    struct rb_node *n = root->rb_root.rb_node, *lb = NULL;
+    size_t nr = 0;
+
+    while (n) {
+        struct treeint_rb *entry = treeint_rb_entry(n);
+        if (lo == entry->value) {
+            lb = n;
+            break;
+        }
+
+        if (lo < entry->value) {
+            lb = n;
+            n = n->rb_left;
+        } else {
+            n = n->rb_right;
+        }
+    }
+
+    for (n = lb; n; n = rb_next(n)) {
+        /* see treeint_st_range() */
+        if (n->rb_right)
+            __builtin_prefetch(n->rb_right);
+
+        int v = treeint_rb_entry(n)->value;
+        if (v > hi)
+            break;
+
+        cb(v, arg);
+        nr++;
+    }
+
+    return nr;
+}
+
 int treeint_rb_remove(void *ctx, int a)
 {
-    struct rb_root *root = (struct rb_root *) ctx;
+    struct rb_root_cached *root = ctx;
     struct treeint_rb *entry = treeint_rb_find(ctx, a);
 
     if (!entry)
         return -1;
 
-    rb_erase(&entry->rb_n, root);
+    rb_erase_cached(&entry->rb_n, root);
     free(entry);
     return 0;
 }
 
+int treeint_rb_peek_min(void *ctx, int *a)
+{
+    struct rb_root_cached *root = ctx;
+    struct rb_node *n = rb_first_cached(root);
+
+    if (!n)
+        return -1;
+
+    *a = treeint_rb_entry(n)->value;
+    return 0;
+}
+
+int treeint_rb_pop_min(void *ctx, int *a)
+{
+    struct rb_root_cached *root = ctx;
+    struct rb_node *n = rb_first_cached(root);
+
+    if (!n)
+        return -1;
+
+    *a = treeint_rb_entry(n)->value;
+    rb_erase_cached(n, root);
+    free(treeint_rb_entry(n));
+    return 0;
+}
+
+/* The node is reused, and when new_key still falls between the same neighbours
+ * (a timer pulled in by a bit) it is rekeyed in place without touching the
+ * tree shape.
+ */
+int treeint_rb_decrease_key(void *ctx, int a, int new_key)
+{
+    struct rb_root_cached *root = ctx;
+    struct treeint_rb *entry;
+    struct rb_node *prev;
+
+    if (new_key >= a || !(entry = treeint_rb_find(ctx, a)))
+        return -1;
+
+    prev = rb_prev(&entry->rb_n);
+    if (!prev || treeint_rb_entry(prev)->value < new_key) {
+        entry->value = new_key;
+        return 0;
+    }
+
+    if (treeint_rb_find(ctx, new_key))
+        return -1;
+
+    rb_erase_cached(&entry->rb_n, root);
+    entry->value = new_key;
+    __treeint_rb_insert(root, entry);
+    return 0;
+}
+
+/* see treeint_st_memsize() */
+size_t treeint_rb_memsize(void *ctx)
+{
+    struct rb_root_cached *root = ctx;
+    size_t size = sizeof(*root);
+
+    for (struct rb_node *n = rb_first_cached(root); n; n = rb_next(n))
+        size += sizeof(struct treeint_rb);
+
+    return size;
+}
+
+static struct rb_node *treeint_rb_node_at(size_t i, void *arg)
+{
+    struct treeint_rb *entry = calloc(sizeof(struct treeint_rb), 1);
+    assert(entry);
+
+    entry->value = ((int *) arg)[i];
+    return &entry->rb_n;
+}
+
+int treeint_rb_build(void *ctx, int *keys, size_t nr, int nr_threads)
+{
+    struct rb_root_cached *root = ctx;
+
+    if (root->rb_root.rb_node)
+        return -1;
+
+    rb_build_sorted_parallel(&root->rb_root, nr, treeint_rb_node_at, keys,
+                             nr_threads);
+    root->rb_leftmost = rb_first(&root->rb_root);
+    return 0;
+}
+
+static void treeint_rb_fill(void *slot, struct rb_node *n)
+{
+    *(int *) slot = treeint_rb_entry(n)->value;
+}
+
+void *treeint_rb_freeze(void *ctx)
+{
+    struct rb_root_cached *root = ctx;
+    struct ez_tree *ez = malloc(sizeof(struct ez_tree));
+    assert(ez);
+
+    ez->keys = rb_freeze(&root->rb_root, sizeof(int), treeint_rb_fill, &ez->nr);
+    assert(ez->keys);
+    return ez;
+}
+
+static int treeint_rb_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+    int x = treeint_rb_entry(a)->value, y = treeint_rb_entry(b)->value;
+    return (x > y) - (x < y);
+}
+
+static void treeint_rb_free(struct rb_node *n)
+{
+    free(treeint_rb_entry(n));
+}
+
+int treeint_rb_set_op(void *ctx,
+                      void *other,
+                      enum treeint_set_op op,
+                      int nr_threads)
+{
+    struct rb_root_cached *root = ctx;
+    struct rb_root_cached *oroot = other;
+
+    switch (op) {
+    case SET_UNION:
+        rb_union(&root->rb_root, &oroot->rb_root, treeint_rb_cmp,
+                 treeint_rb_free, nr_threads);
+        break;
+    case SET_INTERSECTION:
+        rb_intersection(&root->rb_root, &oroot->rb_root, treeint_rb_cmp,
+                        treeint_rb_free, nr_threads);
+        break;
+    case SET_DIFFERENCE:
+        rb_difference(&root->rb_root, &oroot->rb_root, treeint_rb_cmp,
+                      treeint_rb_free, nr_threads);
+        break;
+    }
+
+    root->rb_leftmost = rb_first(&root->rb_root);
+    free(oroot);
+    return 0;
+}
+
+size_t treeint_rb_range_delete(void *ctx, int lo, int hi, int nr_threads)
+{
+    struct rb_root_cached *root = ctx;
+    struct treeint_rb lo_key = {.value = lo}, hi_key = {.value = hi};
+    size_t nr;
+
+    nr = rb_range_delete(&root->rb_root, &lo_key.rb_n, &hi_key.rb_n,
+                         treeint_rb_cmp, treeint_rb_free, nr_threads);
+    root->rb_leftmost = rb_first(&root->rb_root);
+    return nr;
+}
+
 #ifdef PRINT_DEBUG
 static void treeint_rb_dump_preorder(struct rb_node *n)
 {
@@ -163,13 +483,13 @@ static void treeint_rb_dump_lvorder(struct rb_node *root)
 
 void treeint_rb_dump(void *ctx, enum dump_mode mode)
 {
-    struct rb_root *root = (struct rb_root *) ctx;
+    struct rb_root_cached *root = ctx;
 
     pr_debug("[");
     if (mode == PRE_ORDER)
-        treeint_rb_dump_preorder(rb_root(root));
+        treeint_rb_dump_preorder(root->rb_root.rb_node);
     else
-        treeint_rb_dump_lvorder(rb_root(root));
+        treeint_rb_dump_lvorder(root->rb_root.rb_node);
     pr_debug("]\n");
 }
 #else
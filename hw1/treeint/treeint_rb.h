@@ -1,12 +1,37 @@
 #ifndef TREEINT_RBTREE_H
 #define TREEINT_RBTREE_H
 
+#include <stddef.h>
 #include "treeint_common.h"
 
 extern void *treeint_rb_init();
 extern int treeint_rb_destroy(void *ctx);
+extern int treeint_rb_destroy_parallel(void *ctx, int nr_threads);
 extern int treeint_rb_insert(void *ctx, int a);
 extern void *treeint_rb_find(void *ctx, int a);
+extern size_t treeint_rb_find_batch(void *ctx,
+                                    const int *keys,
+                                    size_t nr,
+                                    void **out);
 extern int treeint_rb_remove(void *ctx, int a);
+extern int treeint_rb_peek_min(void *ctx, int *a);
+extern int treeint_rb_pop_min(void *ctx, int *a);
+extern int treeint_rb_decrease_key(void *ctx, int a, int new_key);
+extern size_t treeint_rb_range(void *ctx,
+                               int lo,
+                               int hi,
+                               treeint_scan_cb *cb,
+                               void *arg);
+extern size_t treeint_rb_memsize(void *ctx);
 extern void treeint_rb_dump(void *ctx, enum dump_mode mode);
+extern int treeint_rb_build(void *ctx, int *keys, size_t nr, int nr_threads);
+extern void *treeint_rb_freeze(void *ctx);
+extern int treeint_rb_set_op(void *ctx,
+                             void *other,
+                             enum treeint_set_op op,
+                             int nr_threads);
+extern size_t treeint_rb_range_delete(void *ctx,
+                                      int lo,
+                                      int hi,
+                                      int nr_threads);
 #endif
@@ -0,0 +1,139 @@
+#include "treeint_rbc.h"
+#include <assert.h>
+#include "common.h"
+#include "rbtree_compact.h"
+
+void *treeint_rbc_init()
+{
+    struct rbc_tree *tree = rbc_create();
+    assert(tree);
+    return tree;
+}
+
+int treeint_rbc_destroy(void *ctx)
+{
+    struct rbc_tree *tree = (struct rbc_tree *) ctx;
+
+    assert(tree);
+    rbc_destroy(tree);
+    return 0;
+}
+
+int treeint_rbc_insert(void *ctx, int a)
+{
+    return rbc_insert((struct rbc_tree *) ctx, a);
+}
+
+void *treeint_rbc_find(void *ctx, int a)
+{
+    return rbc_find((struct rbc_tree *) ctx, a);
+}
+
+int treeint_rbc_remove(void *ctx, int a)
+{
+    return rbc_remove((struct rbc_tree *) ctx, a);
+}
+
+int treeint_rbc_save(void *ctx, const char *path)
+{
+    return rbc_save((struct rbc_tree *) ctx, path);
+}
+
+void *treeint_rbc_load(const char *path)
+{
+    return rbc_load(path);
+}
+
+size_t treeint_rbc_range(void *ctx,
+                         int lo,
+                         int hi,
+                         treeint_scan_cb *cb,
+                         void *arg)
+{
+    struct rbc_tree *tree = (struct rbc_tree *) ctx;
+    struct ia_node *nodes = tree->arena.nodes;
+    size_t nr = 0;
+
+    for (uint32_t n = rbc_lower_bound(tree, lo); n; n = rbc_next(tree, n)) {
+        /* see treeint_st_range() */
+        if (nodes[n].right)
+            __builtin_prefetch(&nodes[nodes[n].right]);
+
+        if (nodes[n].key > hi)
+            break;
+
+        cb(nodes[n].key, arg);
+        nr++;
+    }
+
+    return nr;
+}
+
+size_t treeint_rbc_memsize(void *ctx)
+{
+    struct rbc_tree *tree = (struct rbc_tree *) ctx;
+    return sizeof(*tree) + ia_memsize(&tree->arena);
+}
+
+#ifdef PRINT_DEBUG
+static void treeint_rbc_dump_preorder(struct ia_node *nodes, uint32_t n)
+{
+    if (!n)
+        return;
+
+    treeint_rbc_dump_preorder(nodes, nodes[n].left);
+    pr_debug("%d\n", nodes[n].key);
+    treeint_rbc_dump_preorder(nodes, nodes[n].right);
+}
+
+static int treeint_rbc_height(struct ia_node *nodes, uint32_t n)
+{
+    if (!n)
+        return 0;
+
+    int lheight = treeint_rbc_height(nodes, nodes[n].left);
+    int rheight = treeint_rbc_height(nodes, nodes[n].right);
+
+    return (lheight > rheight) ? (lheight + 1) : (rheight + 1);
+}
+
+static void __treeint_rbc_dump_lvorder(struct ia_node *nodes,
+                                       uint32_t n,
+                                       int level)
+{
+    if (!n) {
+        if (level == 1)
+            pr_debug("null,");
+        return;
+    }
+
+    if (level == 1) {
+        pr_debug("%d,", nodes[n].key);
+        return;
+    }
+
+    __treeint_rbc_dump_lvorder(nodes, nodes[n].left, level - 1);
+    __treeint_rbc_dump_lvorder(nodes, nodes[n].right, level - 1);
+}
+
+static void treeint_rbc_dump_lvorder(struct ia_node *nodes, uint32_t root)
+{
+    int h = treeint_rbc_height(nodes, root);
+    for (int i = 1; i <= h; i++)
+        __treeint_rbc_dump_lvorder(nodes, root, i);
+}
+
+void treeint_rbc_dump(void *ctx, enum dump_mode mode)
+{
+    struct rbc_tree *tree = (struct rbc_tree *) ctx;
+
+    pr_debug("[");
+    if (mode == PRE_ORDER)
+        treeint_rbc_dump_preorder(tree->arena.nodes, tree->root);
+    else
+        treeint_rbc_dump_lvorder(tree->arena.nodes, tree->root);
+    pr_debug("]\n");
+}
+#else
+void treeint_rbc_dump(__unused void *ctx, __unused enum dump_mode mode) {}
+#endif
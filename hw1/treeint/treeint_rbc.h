@@ -0,0 +1,22 @@
+#ifndef TREEINT_RBC_H
+#define TREEINT_RBC_H
+
+#include <stddef.h>
+#include "treeint_common.h"
+
+extern void *treeint_rbc_init();
+extern int treeint_rbc_destroy(void *ctx);
+extern int treeint_rbc_insert(void *ctx, int a);
+extern void *treeint_rbc_find(void *ctx, int a);
+extern int treeint_rbc_remove(void *ctx, int a);
+extern int treeint_rbc_save(void *ctx, const char *path);
+extern void *treeint_rbc_load(const char *path);
+extern size_t treeint_rbc_range(void *ctx,
+                                int lo,
+                                int hi,
+                                treeint_scan_cb *cb,
+                                void *arg);
+extern size_t treeint_rbc_memsize(void *ctx);
+extern void treeint_rbc_dump(void *ctx, enum dump_mode mode);
+
+#endif
@@ -0,0 +1,284 @@
+#include "treeint_rbo.h"
+#include <assert.h>
+#include "common.h"
+#include "rbtree_augmented.h"
+
+/* Order-statistic tree: a red-black tree whose nodes also count the nodes of
+ * their subtree, which ranks a key or selects the k-th one in O(log n).
+ */
+
+#define treeint_rbo_entry(ptr) container_of(ptr, struct treeint_rbo_node, rb_n)
+
+struct treeint_rbo_node {
+    int value;
+    unsigned int size; /* fits in the padding before rb_n */
+    struct rb_node rb_n;
+};
+
+static inline unsigned int treeint_rbo_size(struct rb_node *n)
+{
+    return n ? treeint_rbo_entry(n)->size : 0;
+}
+
+static inline bool treeint_rbo_compute(struct treeint_rbo_node *node,
+                                       bool exit)
+{
+    unsigned int size = 1 + treeint_rbo_size(node->rb_n.rb_left) +
+                        treeint_rbo_size(node->rb_n.rb_right);
+
+    if (exit && node->size == size)
+        return true;
+    node->size = size;
+    return false;
+}
+
+RB_DECLARE_CALLBACKS(static,
+                     treeint_rbo_augment,
+                     struct treeint_rbo_node,
+                     rb_n,
+                     size,
+                     treeint_rbo_compute)
+
+void *treeint_rbo_init()
+{
+    struct rb_root *root = calloc(sizeof(struct rb_root), 1);
+    assert(root);
+
+    *root = RB_ROOT;
+    return root;
+}
+
+/* see __treeint_rb_destroy() */
+int treeint_rbo_destroy(void *ctx)
+{
+    struct rb_root *root = (struct rb_root *) ctx;
+    struct rb_node *n = root->rb_node;
+
+    while (n) {
+        struct rb_node *l = rb_left(n);
+
+        if (l) {
+            rb_left(n) = rb_right(l);
+            rb_right(l) = n;
+            n = l;
+        } else {
+            struct rb_node *r = rb_right(n);
+            free(treeint_rbo_entry(n));
+            n = r;
+        }
+    }
+
+    free(root);
+    return 0;
+}
+
+int treeint_rbo_insert(void *ctx, int a)
+{
+    struct rb_root *root = (struct rb_root *) ctx;
+    struct rb_node **n = &root->rb_node, *p = NULL;
+
+    while (*n) {
+        struct treeint_rbo_node *entry = treeint_rbo_entry(*n);
+        if (a == entry->value)
+            return -1;
+
+        p = *n;
+        n = a < entry->value ? &(*n)->rb_left : &(*n)->rb_right;
+    }
+
+    struct treeint_rbo_node *i = calloc(sizeof(struct treeint_rbo_node), 1);
+    assert(i);
+    i->value = a;
+    i->size = 1;
+
+    /* The key is new, so every subtree on the way down grows by one */
+    for (struct rb_node *up = p; up; up = rb_parent(up))
+        treeint_rbo_entry(up)->size++;
+
+    rb_link_node(&i->rb_n, p, n);
+    rb_insert_augmented(&i->rb_n, root, &treeint_rbo_augment);
+    return 0;
+}
+
+void *treeint_rbo_find(void *ctx, int a)
+{
+    struct rb_node *n = ((struct rb_root *) ctx)->rb_node;
+
+    while (n) {
+        struct treeint_rbo_node *entry = treeint_rbo_entry(n);
+        if (a == entry->value)
+            return entry;
+
+        n = a < entry->value ? n->rb_left : n->rb_right;
+    }
+
+    return NULL;
+}
+
+int treeint_rbo_remove(void *ctx, int a)
+{
+    struct rb_root *root = (struct rb_root *) ctx;
+    struct treeint_rbo_node *entry = treeint_rbo_find(ctx, a);
+
+    if (!entry)
+        return -1;
+
+    rb_erase_augmented(&entry->rb_n, root, &treeint_rbo_augment);
+    free(entry);
+    return 0;
+}
+
+/* see treeint_rb_range() */
+size_t treeint_rbo_range(void *ctx,
+                         int lo,
+                         int hi,
+                         treeint_scan_cb *cb,
+                         void *arg)
+{
+    struct rb_node *n = ((struct rb_root *) ctx)->rb_node, *lb = NULL;
+    size_t nr = 0;
+
+    while (n) {
+        int v = treeint_rbo_entry(n)->value;
+        if (lo == v) {
+            lb = n;
+            break;
+        }
+
+        if (lo < v) {
+            lb = n;
+            n = n->rb_left;
+        } else {
+            n = n->rb_right;
+        }
+    }
+
+    for (n = lb; n; n = rb_next(n)) {
+        int v = treeint_rbo_entry(n)->value;
+        if (v > hi)
+            break;
+
+        cb(v, arg);
+        nr++;
+    }
+
+    return nr;
+}
+
+/* The number of keys less than a */
+size_t treeint_rbo_rank(void *ctx, int a)
+{
+    struct rb_node *n = ((struct rb_root *) ctx)->rb_node;
+    size_t rank = 0;
+
+    while (n) {
+        struct treeint_rbo_node *entry = treeint_rbo_entry(n);
+
+        if (a <= entry->value) {
+            if (a == entry->value)
+                return rank + treeint_rbo_size(n->rb_left);
+            n = n->rb_left;
+        } else {
+            rank += treeint_rbo_size(n->rb_left) + 1;
+            n = n->rb_right;
+        }
+    }
+
+    return rank;
+}
+
+/* Store the k-th smallest key, counting from 0, in *a */
+int treeint_rbo_select(void *ctx, size_t k, int *a)
+{
+    struct rb_node *n = ((struct rb_root *) ctx)->rb_node;
+
+    while (n) {
+        size_t left = treeint_rbo_size(n->rb_left);
+
+        if (k == left) {
+            *a = treeint_rbo_entry(n)->value;
+            return 0;
+        }
+
+        if (k < left) {
+            n = n->rb_left;
+        } else {
+            k -= left + 1;
+            n = n->rb_right;
+        }
+    }
+
+    return -1;
+}
+
+/* The size of the root is the number of nodes */
+size_t treeint_rbo_memsize(void *ctx)
+{
+    struct rb_root *root = (struct rb_root *) ctx;
+
+    return sizeof(*root) +
+           treeint_rbo_size(root->rb_node) * sizeof(struct treeint_rbo_node);
+}
+
+#ifdef PRINT_DEBUG
+static void treeint_rbo_dump_preorder(struct rb_node *n)
+{
+    if (!n)
+        return;
+
+    treeint_rbo_dump_preorder(rb_left(n));
+    pr_debug("%d\n", treeint_rbo_entry(n)->value);
+    treeint_rbo_dump_preorder(rb_right(n));
+}
+
+static int treeint_rbo_height(struct rb_node *node)
+{
+    if (node == NULL)
+        return 0;
+
+    int lheight = treeint_rbo_height(rb_left(node));
+    int rheight = treeint_rbo_height(rb_right(node));
+
+    return (lheight > rheight) ? (lheight + 1) : (rheight + 1);
+}
+
+/* Each node is followed by the size of its subtree */
+static void __treeint_rbo_dump_lvorder(struct rb_node *node, int level)
+{
+    if (node == NULL) {
+        if (level == 1)
+            pr_debug("null,");
+        return;
+    }
+
+    if (level == 1) {
+        struct treeint_rbo_node *entry = treeint_rbo_entry(node);
+        pr_debug("%d/%u,", entry->value, entry->size);
+        return;
+    }
+
+    __treeint_rbo_dump_lvorder(rb_left(node), level - 1);
+    __treeint_rbo_dump_lvorder(rb_right(node), level - 1);
+}
+
+static void treeint_rbo_dump_lvorder(struct rb_node *root)
+{
+    int h = treeint_rbo_height(root);
+    for (int i = 1; i <= h; i++)
+        __treeint_rbo_dump_lvorder(root, i);
+}
+
+void treeint_rbo_dump(void *ctx, enum dump_mode mode)
+{
+    struct rb_root *root = (struct rb_root *) ctx;
+
+    pr_debug("[");
+    if (mode == PRE_ORDER)
+        treeint_rbo_dump_preorder(root->rb_node);
+    else
+        treeint_rbo_dump_lvorder(root->rb_node);
+    pr_debug("]\n");
+}
+#else
+void treeint_rbo_dump(__unused void *ctx, __unused enum dump_mode mode) {}
+#endif
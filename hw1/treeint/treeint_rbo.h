@@ -0,0 +1,22 @@
+#ifndef TREEINT_RBO_H
+#define TREEINT_RBO_H
+
+#include <stddef.h>
+#include "treeint_common.h"
+
+extern void *treeint_rbo_init();
+extern int treeint_rbo_destroy(void *ctx);
+extern int treeint_rbo_insert(void *ctx, int a);
+extern void *treeint_rbo_find(void *ctx, int a);
+extern int treeint_rbo_remove(void *ctx, int a);
+extern size_t treeint_rbo_range(void *ctx,
+                                int lo,
+                                int hi,
+                                treeint_scan_cb *cb,
+                                void *arg);
+extern size_t treeint_rbo_rank(void *ctx, int a);
+extern int treeint_rbo_select(void *ctx, size_t k, int *a);
+extern size_t treeint_rbo_memsize(void *ctx);
+extern void treeint_rbo_dump(void *ctx, enum dump_mode mode);
+
+#endif
@@ -0,0 +1,237 @@
+#include "treeint_rbs.h"
+#include <assert.h>
+#include <pthread.h>
+#include "common.h"
+#include "ebr.h"
+#include "rbtree.h"
+#include "seqcount.h"
+
+/* Red-black tree for one writer at a time and any number of lockless readers.
+ *
+ * Writers are serialized by a mutex and bracket every change of the tree with
+ * a sequence counter. Since rbtree.c publishes the child links with release
+ * stores and never creates a loop, a lookup racing with a rotation always
+ * completes, and a node it finds is the right one. Only a miss is unreliable: a rotation
+ * may have hidden the key for a moment, so a reader retries a miss when the
+ * counter shows that a writer was active. Removed nodes are freed through
+ * epoch-based reclamation, once no reader can still be standing on them.
+ */
+
+#define treeint_rbs_entry(ptr) container_of(ptr, struct treeint_rbs_node, rb_n)
+
+struct treeint_rbs_node {
+    int value;
+    struct rb_node rb_n;
+};
+
+struct treeint_rbs {
+    struct rb_root root;
+    seqcount_t seq;
+    pthread_mutex_t lock; /* serializes the writers */
+    struct ebr_limbo limbo;
+};
+
+void *treeint_rbs_init()
+{
+    struct treeint_rbs *tree = calloc(sizeof(struct treeint_rbs), 1);
+    assert(tree);
+
+    tree->root = RB_ROOT;
+    pthread_mutex_init(&tree->lock, NULL);
+    tree->limbo.free_fn = free;
+    return tree;
+}
+
+/* see __treeint_rb_destroy() */
+int treeint_rbs_destroy(void *ctx)
+{
+    struct treeint_rbs *tree = (struct treeint_rbs *) ctx;
+    struct rb_node *n = tree->root.rb_node;
+
+    ebr_flush(&tree->limbo);
+
+    while (n) {
+        struct rb_node *l = rb_left(n);
+
+        if (l) {
+            rb_left(n) = rb_right(l);
+            rb_right(l) = n;
+            n = l;
+        } else {
+            struct rb_node *r = rb_right(n);
+            free(treeint_rbs_entry(n));
+            n = r;
+        }
+    }
+
+    pthread_mutex_destroy(&tree->lock);
+    free(tree);
+    return 0;
+}
+
+/* Lockless descent, see the comment on rb_publish() in rbtree.c */
+static struct treeint_rbs_node *__treeint_rbs_find(struct treeint_rbs *tree,
+                                                   int a)
+{
+    struct rb_node *n =
+        __atomic_load_n(&tree->root.rb_node, __ATOMIC_ACQUIRE);
+
+    while (n) {
+        struct treeint_rbs_node *entry = treeint_rbs_entry(n);
+        if (a == entry->value)
+            return entry;
+
+        if (a < entry->value)
+            n = __atomic_load_n(&n->rb_left, __ATOMIC_ACQUIRE);
+        else
+            n = __atomic_load_n(&n->rb_right, __ATOMIC_ACQUIRE);
+    }
+
+    return NULL;
+}
+
+/* The node is only guaranteed to stay around until the end of the read
+ * section, so the result is only good for testing the presence of the key.
+ */
+void *treeint_rbs_find(void *ctx, int a)
+{
+    struct treeint_rbs *tree = (struct treeint_rbs *) ctx;
+    struct treeint_rbs_node *entry;
+    unsigned int seq;
+
+    ebr_read_lock();
+    do {
+        seq = raw_read_seqcount(&tree->seq);
+        entry = __treeint_rbs_find(tree, a);
+    } while (!entry && read_seqcount_retry(&tree->seq, seq));
+    ebr_read_unlock();
+
+    return entry;
+}
+
+int treeint_rbs_insert(void *ctx, int a)
+{
+    struct treeint_rbs *tree = (struct treeint_rbs *) ctx;
+    struct rb_node **n = &tree->root.rb_node;
+    struct rb_node *p = NULL;
+
+    pthread_mutex_lock(&tree->lock);
+
+    while (*n) {
+        struct treeint_rbs_node *entry = treeint_rbs_entry(*n);
+        if (a == entry->value) {
+            pthread_mutex_unlock(&tree->lock);
+            return -1;
+        }
+
+        p = *n;
+        n = a < entry->value ? &(*n)->rb_left : &(*n)->rb_right;
+    }
+
+    struct treeint_rbs_node *i = calloc(sizeof(struct treeint_rbs_node), 1);
+    assert(i);
+    i->value = a;
+
+    write_seqcount_begin(&tree->seq);
+    rb_link_node_rcu(&i->rb_n, p, n);
+    rb_insert_color(&i->rb_n, &tree->root);
+    write_seqcount_end(&tree->seq);
+
+    pthread_mutex_unlock(&tree->lock);
+    return 0;
+}
+
+int treeint_rbs_remove(void *ctx, int a)
+{
+    struct treeint_rbs *tree = (struct treeint_rbs *) ctx;
+
+    pthread_mutex_lock(&tree->lock);
+
+    struct treeint_rbs_node *entry = __treeint_rbs_find(tree, a);
+    if (!entry) {
+        pthread_mutex_unlock(&tree->lock);
+        return -1;
+    }
+
+    write_seqcount_begin(&tree->seq);
+    rb_erase(&entry->rb_n, &tree->root);
+    write_seqcount_end(&tree->seq);
+
+    ebr_retire(&tree->limbo, entry);
+
+    pthread_mutex_unlock(&tree->lock);
+    return 0;
+}
+
+/* see treeint_st_memsize(), retired nodes are not counted */
+size_t treeint_rbs_memsize(void *ctx)
+{
+    struct treeint_rbs *tree = (struct treeint_rbs *) ctx;
+    size_t size = sizeof(*tree);
+
+    for (struct rb_node *n = rb_first(&tree->root); n; n = rb_next(n))
+        size += sizeof(struct treeint_rbs_node);
+
+    return size;
+}
+
+#ifdef PRINT_DEBUG
+static void treeint_rbs_dump_preorder(struct rb_node *n)
+{
+    if (!n)
+        return;
+
+    treeint_rbs_dump_preorder(rb_left(n));
+    pr_debug("%d\n", treeint_rbs_entry(n)->value);
+    treeint_rbs_dump_preorder(rb_right(n));
+}
+
+static int treeint_rbs_height(struct rb_node *node)
+{
+    if (node == NULL)
+        return 0;
+
+    int lheight = treeint_rbs_height(rb_left(node));
+    int rheight = treeint_rbs_height(rb_right(node));
+
+    return (lheight > rheight) ? (lheight + 1) : (rheight + 1);
+}
+
+static void __treeint_rbs_dump_lvorder(struct rb_node *node, int level)
+{
+    if (node == NULL) {
+        if (level == 1)
+            pr_debug("null,");
+        return;
+    }
+
+    if (level == 1) {
+        pr_debug("%d,", treeint_rbs_entry(node)->value);
+        return;
+    }
+
+    __treeint_rbs_dump_lvorder(rb_left(node), level - 1);
+    __treeint_rbs_dump_lvorder(rb_right(node), level - 1);
+}
+
+static void treeint_rbs_dump_lvorder(struct rb_node *root)
+{
+    int h = treeint_rbs_height(root);
+    for (int i = 1; i <= h; i++)
+        __treeint_rbs_dump_lvorder(root, i);
+}
+
+void treeint_rbs_dump(void *ctx, enum dump_mode mode)
+{
+    struct treeint_rbs *tree = (struct treeint_rbs *) ctx;
+
+    pr_debug("[");
+    if (mode == PRE_ORDER)
+        treeint_rbs_dump_preorder(tree->root.rb_node);
+    else
+        treeint_rbs_dump_lvorder(tree->root.rb_node);
+    pr_debug("]\n");
+}
+#else
+void treeint_rbs_dump(__unused void *ctx, __unused enum dump_mode mode) {}
+#endif
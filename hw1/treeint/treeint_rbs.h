@@ -0,0 +1,15 @@
+#ifndef TREEINT_RBS_H
+#define TREEINT_RBS_H
+
+#include <stddef.h>
+#include "treeint_common.h"
+
+extern void *treeint_rbs_init();
+extern int treeint_rbs_destroy(void *ctx);
+extern int treeint_rbs_insert(void *ctx, int a);
+extern void *treeint_rbs_find(void *ctx, int a);
+extern int treeint_rbs_remove(void *ctx, int a);
+extern size_t treeint_rbs_memsize(void *ctx);
+extern void treeint_rbs_dump(void *ctx, enum dump_mode mode);
+
+#endif
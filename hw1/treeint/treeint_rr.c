@@ -0,0 +1,101 @@
+#include "treeint_rr.h"
+#include <assert.h>
+#include <limits.h>
+#include "common.h"
+#include "roaring.h"
+
+void *treeint_rr_init()
+{
+    struct roaring *r = roaring_create();
+    assert(r);
+    return r;
+}
+
+int treeint_rr_destroy(void *ctx)
+{
+    struct roaring *r = (struct roaring *) ctx;
+
+    assert(r);
+    roaring_destroy(r);
+    return 0;
+}
+
+int treeint_rr_insert(void *ctx, int a)
+{
+    return roaring_insert((struct roaring *) ctx, a);
+}
+
+/* The keys are mere bits, there is nothing to point to but the set itself */
+void *treeint_rr_find(void *ctx, int a)
+{
+    return roaring_contains((struct roaring *) ctx, a) ? ctx : NULL;
+}
+
+int treeint_rr_remove(void *ctx, int a)
+{
+    return roaring_remove((struct roaring *) ctx, a);
+}
+
+size_t treeint_rr_range(void *ctx,
+                        int lo,
+                        int hi,
+                        treeint_scan_cb *cb,
+                        void *arg)
+{
+    return roaring_range((struct roaring *) ctx, lo, hi, cb, arg);
+}
+
+size_t treeint_rr_memsize(void *ctx)
+{
+    return roaring_memsize((struct roaring *) ctx);
+}
+
+/* A container at a time is all there is to it, so nr_threads is unused */
+int treeint_rr_set_op(void *ctx,
+                      void *other,
+                      enum treeint_set_op op,
+                      __unused int nr_threads)
+{
+    struct roaring *r = (struct roaring *) ctx;
+
+    switch (op) {
+    case SET_UNION:
+        roaring_union(r, other);
+        break;
+    case SET_INTERSECTION:
+        roaring_intersection(r, other);
+        break;
+    case SET_DIFFERENCE:
+        roaring_difference(r, other);
+        break;
+    }
+
+    roaring_destroy(other);
+    return 0;
+}
+
+size_t treeint_rr_range_delete(void *ctx,
+                               int lo,
+                               int hi,
+                               __unused int nr_threads)
+{
+    return roaring_range_delete((struct roaring *) ctx, lo, hi);
+}
+
+#ifdef PRINT_DEBUG
+static void treeint_rr_dump_cb(int key, __unused void *arg)
+{
+    pr_debug("%d,", key);
+}
+
+/* There are no nodes, so both modes list the keys in order */
+void treeint_rr_dump(void *ctx, __unused enum dump_mode mode)
+{
+    pr_debug("[");
+    roaring_range((struct roaring *) ctx, INT_MIN, INT_MAX, treeint_rr_dump_cb,
+                  NULL);
+    pr_debug("]\n");
+}
+#else
+void treeint_rr_dump(__unused void *ctx, __unused enum dump_mode mode) {}
+#endif
@@ -0,0 +1,28 @@
+#ifndef TREEINT_RR_H
+#define TREEINT_RR_H
+
+#include <stddef.h>
+#include "treeint_common.h"
+
+extern void *treeint_rr_init();
+extern int treeint_rr_destroy(void *ctx);
+extern int treeint_rr_insert(void *ctx, int a);
+extern void *treeint_rr_find(void *ctx, int a);
+extern int treeint_rr_remove(void *ctx, int a);
+extern size_t treeint_rr_range(void *ctx,
+                               int lo,
+                               int hi,
+                               treeint_scan_cb *cb,
+                               void *arg);
+extern size_t treeint_rr_memsize(void *ctx);
+extern void treeint_rr_dump(void *ctx, enum dump_mode mode);
+extern int treeint_rr_set_op(void *ctx,
+                             void *other,
+                             enum treeint_set_op op,
+                             int nr_threads);
+extern size_t treeint_rr_range_delete(void *ctx,
+                                      int lo,
+                                      int hi,
+                                      int nr_threads);
+
+#endif
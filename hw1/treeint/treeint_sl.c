@@ -0,0 +1,103 @@
+#include "treeint_sl.h"
+#include <assert.h>
+#include "common.h"
+#include "ebr.h"
+#include "skiplist.h"
+
+void *treeint_sl_init()
+{
+    struct skiplist *sl = sl_create();
+    assert(sl);
+    return sl;
+}
+
+int treeint_sl_destroy(void *ctx)
+{
+    struct skiplist *sl = (struct skiplist *) ctx;
+
+    assert(sl);
+    sl_destroy(sl);
+    return 0;
+}
+
+int treeint_sl_insert(void *ctx, int a)
+{
+    return sl_insert((struct skiplist *) ctx, a);
+}
+
+/* see treeint_rbs_find() */
+void *treeint_sl_find(void *ctx, int a)
+{
+    struct sl_node *node;
+
+    ebr_read_lock();
+    node = sl_find((struct skiplist *) ctx, a);
+    ebr_read_unlock();
+
+    return node;
+}
+
+int treeint_sl_remove(void *ctx, int a)
+{
+    return sl_remove((struct skiplist *) ctx, a);
+}
+
+/* Keys removed or inserted during the scan may or may not be visited */
+size_t treeint_sl_range(void *ctx,
+                        int lo,
+                        int hi,
+                        treeint_scan_cb *cb,
+                        void *arg)
+{
+    struct skiplist *sl = (struct skiplist *) ctx;
+    size_t nr = 0;
+
+    ebr_read_lock();
+    for (struct sl_node *n = sl_lower_bound(sl, lo); n && n->key <= hi;
+         n = sl_next(n)) {
+        cb(n->key, arg);
+        nr++;
+    }
+    ebr_read_unlock();
+
+    return nr;
+}
+
+/* Not thread-safe, the towers have a random height so they are walked */
+size_t treeint_sl_memsize(void *ctx)
+{
+    struct skiplist *sl = (struct skiplist *) ctx;
+    size_t size = sizeof(*sl);
+
+    for (struct sl_node *n = sl->head; n; n = sl_next(n))
+        size += sizeof(*n) + n->height * sizeof(n->next[0]);
+
+    return size;
+}
+
+#ifdef PRINT_DEBUG
+void treeint_sl_dump(void *ctx, enum dump_mode mode)
+{
+    struct skiplist *sl = (struct skiplist *) ctx;
+
+    pr_debug("[");
+    if (mode == PRE_ORDER) {
+        for (struct sl_node *n = sl_next(sl->head); n; n = sl_next(n))
+            pr_debug("%d\n", n->key);
+    } else {
+        /* one list per level from the top, each ended with a null */
+        for (int level = SL_MAX_LEVEL - 1; level >= 0; level--) {
+            struct sl_node *n = (struct sl_node *) sl->head->next[level];
+
+            if (!n)
+                continue;
+            for (; n; n = (struct sl_node *) (n->next[level] & ~1UL))
+                pr_debug("%d,", n->key);
+            pr_debug("null,");
+        }
+    }
+    pr_debug("]\n");
+}
+#else
+void treeint_sl_dump(__unused void *ctx, __unused enum dump_mode mode) {}
+#endif
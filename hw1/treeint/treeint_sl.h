@@ -0,0 +1,20 @@
+#ifndef TREEINT_SL_H
+#define TREEINT_SL_H
+
+#include <stddef.h>
+#include "treeint_common.h"
+
+extern void *treeint_sl_init();
+extern int treeint_sl_destroy(void *ctx);
+extern int treeint_sl_insert(void *ctx, int a);
+extern void *treeint_sl_find(void *ctx, int a);
+extern int treeint_sl_remove(void *ctx, int a);
+extern size_t treeint_sl_range(void *ctx,
+                               int lo,
+                               int hi,
+                               treeint_scan_cb *cb,
+                               void *arg);
+extern size_t treeint_sl_memsize(void *ctx);
+extern void treeint_sl_dump(void *ctx, enum dump_mode mode);
+
+#endif
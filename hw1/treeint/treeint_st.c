@@ -1,6 +1,8 @@
 #include "treeint_st.h"
 #include <assert.h>
+#include <stdbool.h>
 #include "common.h"
+#include "eytzinger.h"
 #include "s_tree.h"
 
 #define treeint_st_entry(ptr) container_of(ptr, struct treeint_st, st_n)
@@ -10,12 +12,21 @@ struct treeint_st {
     struct st_node st_n;
 };
 
+/* The tree and, for s-tree-finger, a finger on the last key touched, see
+ * st_find_from()
+ */
+struct treeint_st_ctx {
+    struct st_tree *tree;
+    struct st_finger finger;
+};
+
 static int treeint_st_cmp(struct st_node *node, void *key)
 {
     struct treeint_st *n = treeint_st_entry(node);
     int value = *(int *) key;
 
-    return n->value - value;
+    /* not n->value - value, which overflows for distant keys */
+    return (n->value > value) - (n->value < value);
 }
 
 static struct st_node *treeint_st_node_create(void *key)
@@ -37,41 +48,183 @@ static void treeint_st_node_destroy(struct st_node *n)
 
 void *treeint_st_init()
 {
-    struct st_tree *tree;
-    tree = st_create(treeint_st_cmp, treeint_st_node_create,
-                     treeint_st_node_destroy);
-    assert(tree);
-    return tree;
+    struct treeint_st_ctx *t = calloc(sizeof(struct treeint_st_ctx), 1);
+    assert(t);
+
+    t->tree = st_create(treeint_st_cmp, treeint_st_node_create,
+                        treeint_st_node_destroy);
+    assert(t->tree);
+    return t;
 }
 
 int treeint_st_destroy(void *ctx)
 {
-    struct st_tree *tree = (struct st_tree *) ctx;
+    struct st_tree *tree = ((struct treeint_st_ctx *) ctx)->tree;
 
     assert(tree);
     st_destroy(tree);
+    free(ctx);
+    return 0;
+}
+
+void treeint_st_set_update_freq(void *ctx, unsigned int freq)
+{
+    st_set_update_freq(((struct treeint_st_ctx *) ctx)->tree, freq);
+}
+
+void treeint_st_set_lookup_budget(void *ctx, unsigned int budget)
+{
+    st_set_lookup_budget(((struct treeint_st_ctx *) ctx)->tree, budget);
+}
+
+int treeint_st_destroy_parallel(void *ctx, int nr_threads)
+{
+    struct st_tree *tree = ((struct treeint_st_ctx *) ctx)->tree;
+
+    assert(tree);
+    st_destroy_parallel(tree, nr_threads);
+    free(ctx);
     return 0;
 }
 
 int treeint_st_insert(void *ctx, int a)
 {
-    struct st_tree *tree = (struct st_tree *) ctx;
+    struct st_tree *tree = ((struct treeint_st_ctx *) ctx)->tree;
     return st_insert(tree, (void *) &a);
 }
 
 void *treeint_st_find(void *ctx, int a)
 {
-    struct st_tree *tree = (struct st_tree *) ctx;
+    struct st_tree *tree = ((struct treeint_st_ctx *) ctx)->tree;
     struct st_node *n = st_find(tree, (void *) &a);
     return n ? treeint_st_entry(n) : NULL;
 }
 
+int treeint_st_finger_insert(void *ctx, int a)
+{
+    struct treeint_st_ctx *t = (struct treeint_st_ctx *) ctx;
+    return st_insert_hint(t->tree, &t->finger, (void *) &a);
+}
+
+void *treeint_st_finger_find(void *ctx, int a)
+{
+    struct treeint_st_ctx *t = (struct treeint_st_ctx *) ctx;
+    struct st_node *n = st_find_from(t->tree, &t->finger, (void *) &a);
+    return n ? treeint_st_entry(n) : NULL;
+}
+
+size_t treeint_st_find_batch(void *ctx,
+                             const int *keys,
+                             size_t nr,
+                             void **out)
+{
+    struct st_tree *tree = ((struct treeint_st_ctx *) ctx)->tree;
+    struct st_node *nodes[64];
+    size_t found = 0;
+
+    for (size_t i = 0; i < nr; i += 64) {
+        size_t chunk = nr - i < 64 ? nr - i : 64;
+
+        found += st_find_batch(tree, (void *) (keys + i), sizeof(int), chunk,
+                               nodes);
+        for (size_t j = 0; j < chunk; j++)
+            out[i + j] = nodes[j] ? treeint_st_entry(nodes[j]) : NULL;
+    }
+
+    return found;
+}
+
+static inline bool treeint_st_is(struct st_node *n, int a)
+{
+    return n && treeint_st_entry(n)->value == a;
+}
+
 int treeint_st_remove(void *ctx, int a)
 {
-    struct st_tree *tree = (struct st_tree *) ctx;
+    struct st_tree *tree = ((struct treeint_st_ctx *) ctx)->tree;
     return st_remove(tree, (void *) &a);
 }
 
+int treeint_st_finger_remove(void *ctx, int a)
+{
+    struct treeint_st_ctx *t = (struct treeint_st_ctx *) ctx;
+    struct st_finger *f = &t->finger;
+
+    /* The finger does not survive the removal of any of its nodes */
+    if (treeint_st_is(f->node, a) || treeint_st_is(f->prev, a) ||
+        treeint_st_is(f->next, a))
+        *f = (struct st_finger){NULL};
+
+    return st_remove(t->tree, (void *) &a);
+}
+
+size_t treeint_st_range(void *ctx,
+                        int lo,
+                        int hi,
+                        treeint_scan_cb *cb,
+                        void *arg)
+{
+    struct st_tree *tree = ((struct treeint_st_ctx *) ctx)->tree;
+    size_t nr = 0;
+
+    for (struct st_node *n = st_lower_bound(tree, &lo); n; n = st_next(n)) {
+        /* The successor is either up the path we came from, which is already
+         * in cache, or down the right subtree, so fetch it early.
+         */
+        if (st_right(n))
+            __builtin_prefetch(st_right(n));
+
+        int v = treeint_st_entry(n)->value;
+        if (v > hi)
+            break;
+
+        cb(v, arg);
+        nr++;
+    }
+
+    return nr;
+}
+
+/* Bytes held by the nodes and the tree itself, not counting the overhead of
+ * the allocator for each node.
+ */
+size_t treeint_st_memsize(void *ctx)
+{
+    struct st_tree *tree = ((struct treeint_st_ctx *) ctx)->tree;
+    size_t size = sizeof(struct treeint_st_ctx) + sizeof(*tree) +
+                  tree->dirty_cap * sizeof(*tree->dirty);
+
+    if (!st_root(tree))
+        return size;
+
+    for (struct st_node *n = st_first(st_root(tree)); n; n = st_next(n))
+        size += sizeof(struct treeint_st);
+
+    return size;
+}
+
+int treeint_st_build(void *ctx, int *keys, size_t nr, int nr_threads)
+{
+    struct st_tree *tree = ((struct treeint_st_ctx *) ctx)->tree;
+    return st_build_sorted_parallel(tree, keys, nr, sizeof(int), nr_threads);
+}
+
+static void treeint_st_fill(void *slot, struct st_node *n)
+{
+    *(int *) slot = treeint_st_entry(n)->value;
+}
+
+void *treeint_st_freeze(void *ctx)
+{
+    struct st_tree *tree = ((struct treeint_st_ctx *) ctx)->tree;
+    struct ez_tree *ez = malloc(sizeof(struct ez_tree));
+    assert(ez);
+
+    ez->keys = st_freeze(tree, sizeof(int), treeint_st_fill, &ez->nr);
+    assert(ez->keys);
+    return ez;
+}
+
 #ifdef PRINT_DEBUG
 static void treeint_st_dump_preorder(struct st_node *n)
 {
@@ -124,7 +277,7 @@ static void treeint_st_dump_lvorder(struct st_node *root)
 
 void treeint_st_dump(void *ctx, enum dump_mode mode)
 {
-    struct st_tree *tree = (struct st_tree *) ctx;
+    struct st_tree *tree = ((struct treeint_st_ctx *) ctx)->tree;
 
     pr_debug("[");
     if (mode == PRE_ORDER)
@@ -1,13 +1,32 @@
 #ifndef TREEINT_ST_H
 #define TREEINT_ST_H
 
+#include <stddef.h>
 #include "treeint_common.h"
 
 extern void *treeint_st_init();
 extern int treeint_st_destroy(void *ctx);
+extern int treeint_st_destroy_parallel(void *ctx, int nr_threads);
+extern void treeint_st_set_update_freq(void *ctx, unsigned int freq);
+extern void treeint_st_set_lookup_budget(void *ctx, unsigned int budget);
 extern int treeint_st_insert(void *ctx, int a);
 extern void *treeint_st_find(void *ctx, int a);
+extern size_t treeint_st_find_batch(void *ctx,
+                                    const int *keys,
+                                    size_t nr,
+                                    void **out);
 extern int treeint_st_remove(void *ctx, int a);
+extern int treeint_st_finger_insert(void *ctx, int a);
+extern void *treeint_st_finger_find(void *ctx, int a);
+extern int treeint_st_finger_remove(void *ctx, int a);
+extern size_t treeint_st_range(void *ctx,
+                               int lo,
+                               int hi,
+                               treeint_scan_cb *cb,
+                               void *arg);
+extern size_t treeint_st_memsize(void *ctx);
 extern void treeint_st_dump(void *ctx, enum dump_mode mode);
+extern int treeint_st_build(void *ctx, int *keys, size_t nr, int nr_threads);
+extern void *treeint_st_freeze(void *ctx);
 
 #endif
@@ -0,0 +1,139 @@
+#include "treeint_stc.h"
+#include <assert.h>
+#include "common.h"
+#include "s_tree_compact.h"
+
+void *treeint_stc_init()
+{
+    struct stc_tree *tree = stc_create();
+    assert(tree);
+    return tree;
+}
+
+int treeint_stc_destroy(void *ctx)
+{
+    struct stc_tree *tree = (struct stc_tree *) ctx;
+
+    assert(tree);
+    stc_destroy(tree);
+    return 0;
+}
+
+int treeint_stc_insert(void *ctx, int a)
+{
+    return stc_insert((struct stc_tree *) ctx, a);
+}
+
+void *treeint_stc_find(void *ctx, int a)
+{
+    return stc_find((struct stc_tree *) ctx, a);
+}
+
+int treeint_stc_remove(void *ctx, int a)
+{
+    return stc_remove((struct stc_tree *) ctx, a);
+}
+
+int treeint_stc_save(void *ctx, const char *path)
+{
+    return stc_save((struct stc_tree *) ctx, path);
+}
+
+void *treeint_stc_load(const char *path)
+{
+    return stc_load(path);
+}
+
+size_t treeint_stc_range(void *ctx,
+                         int lo,
+                         int hi,
+                         treeint_scan_cb *cb,
+                         void *arg)
+{
+    struct stc_tree *tree = (struct stc_tree *) ctx;
+    struct ia_node *nodes = tree->arena.nodes;
+    size_t nr = 0;
+
+    for (uint32_t n = stc_lower_bound(tree, lo); n; n = stc_next(tree, n)) {
+        /* see treeint_st_range() */
+        if (nodes[n].right)
+            __builtin_prefetch(&nodes[nodes[n].right]);
+
+        if (nodes[n].key > hi)
+            break;
+
+        cb(nodes[n].key, arg);
+        nr++;
+    }
+
+    return nr;
+}
+
+size_t treeint_stc_memsize(void *ctx)
+{
+    struct stc_tree *tree = (struct stc_tree *) ctx;
+    return sizeof(*tree) + ia_memsize(&tree->arena);
+}
+
+#ifdef PRINT_DEBUG
+static void treeint_stc_dump_preorder(struct ia_node *nodes, uint32_t n)
+{
+    if (!n)
+        return;
+
+    treeint_stc_dump_preorder(nodes, nodes[n].left);
+    pr_debug("%d\n", nodes[n].key);
+    treeint_stc_dump_preorder(nodes, nodes[n].right);
+}
+
+static int treeint_stc_height(struct ia_node *nodes, uint32_t n)
+{
+    if (!n)
+        return 0;
+
+    int lheight = treeint_stc_height(nodes, nodes[n].left);
+    int rheight = treeint_stc_height(nodes, nodes[n].right);
+
+    return (lheight > rheight) ? (lheight + 1) : (rheight + 1);
+}
+
+static void __treeint_stc_dump_lvorder(struct ia_node *nodes,
+                                       uint32_t n,
+                                       int level)
+{
+    if (!n) {
+        if (level == 1)
+            pr_debug("null,");
+        return;
+    }
+
+    if (level == 1) {
+        pr_debug("%d,", nodes[n].key);
+        return;
+    }
+
+    __treeint_stc_dump_lvorder(nodes, nodes[n].left, level - 1);
+    __treeint_stc_dump_lvorder(nodes, nodes[n].right, level - 1);
+}
+
+static void treeint_stc_dump_lvorder(struct ia_node *nodes, uint32_t root)
+{
+    int h = treeint_stc_height(nodes, root);
+    for (int i = 1; i <= h; i++)
+        __treeint_stc_dump_lvorder(nodes, root, i);
+}
+
+void treeint_stc_dump(void *ctx, enum dump_mode mode)
+{
+    struct stc_tree *tree = (struct stc_tree *) ctx;
+
+    pr_debug("[");
+    if (mode == PRE_ORDER)
+        treeint_stc_dump_preorder(tree->arena.nodes, tree->root);
+    else
+        treeint_stc_dump_lvorder(tree->arena.nodes, tree->root);
+    pr_debug("]\n");
+}
+#else
+void treeint_stc_dump(__unused void *ctx, __unused enum dump_mode mode) {}
+#endif
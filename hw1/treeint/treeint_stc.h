@@ -0,0 +1,22 @@
+#ifndef TREEINT_STC_H
+#define TREEINT_STC_H
+
+#include <stddef.h>
+#include "treeint_common.h"
+
+extern void *treeint_stc_init();
+extern int treeint_stc_destroy(void *ctx);
+extern int treeint_stc_insert(void *ctx, int a);
+extern void *treeint_stc_find(void *ctx, int a);
+extern int treeint_stc_remove(void *ctx, int a);
+extern int treeint_stc_save(void *ctx, const char *path);
+extern void *treeint_stc_load(const char *path);
+extern size_t treeint_stc_range(void *ctx,
+                                int lo,
+                                int hi,
+                                treeint_scan_cb *cb,
+                                void *arg);
+extern size_t treeint_stc_memsize(void *ctx);
+extern void treeint_stc_dump(void *ctx, enum dump_mode mode);
+
+#endif
@@ -0,0 +1,103 @@
+#include "treeint_stl.h"
+#include <assert.h>
+#include "common.h"
+#include "s_tree_lc.h"
+
+void *treeint_stl_init()
+{
+    struct stl_tree *tree = stl_create();
+    assert(tree);
+    return tree;
+}
+
+int treeint_stl_destroy(void *ctx)
+{
+    struct stl_tree *tree = (struct stl_tree *) ctx;
+
+    assert(tree);
+    stl_destroy(tree);
+    return 0;
+}
+
+int treeint_stl_insert(void *ctx, int a)
+{
+    return stl_insert((struct stl_tree *) ctx, a);
+}
+
+void *treeint_stl_find(void *ctx, int a)
+{
+    return stl_find((struct stl_tree *) ctx, a);
+}
+
+int treeint_stl_remove(void *ctx, int a)
+{
+    return stl_remove((struct stl_tree *) ctx, a);
+}
+
+/* see treeint_st_memsize() */
+size_t treeint_stl_memsize(void *ctx)
+{
+    struct stl_tree *tree = (struct stl_tree *) ctx;
+    return sizeof(*tree) + tree->nr_nodes * sizeof(struct stl_node);
+}
+
+#ifdef PRINT_DEBUG
+static void treeint_stl_dump_preorder(struct stl_node *n)
+{
+    if (!n)
+        return;
+
+    treeint_stl_dump_preorder(n->left);
+    pr_debug("%d\n", n->key);
+    treeint_stl_dump_preorder(n->right);
+}
+
+static int treeint_stl_height(struct stl_node *node)
+{
+    if (node == NULL)
+        return 0;
+
+    int lheight = treeint_stl_height(node->left);
+    int rheight = treeint_stl_height(node->right);
+
+    return (lheight > rheight) ? (lheight + 1) : (rheight + 1);
+}
+
+static void __treeint_stl_dump_lvorder(struct stl_node *node, int level)
+{
+    if (node == NULL) {
+        if (level == 1)
+            pr_debug("null,");
+        return;
+    }
+
+    if (level == 1) {
+        pr_debug("%d,", node->key);
+        return;
+    }
+
+    __treeint_stl_dump_lvorder(node->left, level - 1);
+    __treeint_stl_dump_lvorder(node->right, level - 1);
+}
+
+static void treeint_stl_dump_lvorder(struct stl_node *root)
+{
+    int h = treeint_stl_height(root);
+    for (int i = 1; i <= h; i++)
+        __treeint_stl_dump_lvorder(root, i);
+}
+
+void treeint_stl_dump(void *ctx, enum dump_mode mode)
+{
+    struct stl_tree *tree = (struct stl_tree *) ctx;
+
+    pr_debug("[");
+    if (mode == PRE_ORDER)
+        treeint_stl_dump_preorder(tree->root);
+    else
+        treeint_stl_dump_lvorder(tree->root);
+    pr_debug("]\n");
+}
+#else
+void treeint_stl_dump(__unused void *ctx, __unused enum dump_mode mode) {}
+#endif
@@ -0,0 +1,15 @@
+#ifndef TREEINT_STL_H
+#define TREEINT_STL_H
+
+#include <stddef.h>
+#include "treeint_common.h"
+
+extern void *treeint_stl_init();
+extern int treeint_stl_destroy(void *ctx);
+extern int treeint_stl_insert(void *ctx, int a);
+extern void *treeint_stl_find(void *ctx, int a);
+extern int treeint_stl_remove(void *ctx, int a);
+extern size_t treeint_stl_memsize(void *ctx);
+extern void treeint_stl_dump(void *ctx, enum dump_mode mode);
+
+#endif
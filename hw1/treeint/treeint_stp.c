@@ -0,0 +1,124 @@
+#include "treeint_stp.h"
+#include <assert.h>
+#include "common.h"
+#include "ebr.h"
+#include "s_tree_persistent.h"
+
+void *treeint_stp_init()
+{
+    struct stp_tree *tree = stp_create();
+    assert(tree);
+    return tree;
+}
+
+int treeint_stp_destroy(void *ctx)
+{
+    struct stp_tree *tree = (struct stp_tree *) ctx;
+
+    assert(tree);
+    stp_destroy(tree);
+    return 0;
+}
+
+int treeint_stp_insert(void *ctx, int a)
+{
+    return stp_insert((struct stp_tree *) ctx, a);
+}
+
+/* see treeint_rbs_find() */
+void *treeint_stp_find(void *ctx, int a)
+{
+    struct stp_node *node;
+
+    ebr_read_lock();
+    node = stp_find((struct stp_tree *) ctx, a);
+    ebr_read_unlock();
+
+    return node;
+}
+
+int treeint_stp_remove(void *ctx, int a)
+{
+    return stp_remove((struct stp_tree *) ctx, a);
+}
+
+/* Unlike treeint_sl_range(), the scan sees none of the concurrent updates */
+size_t treeint_stp_range(void *ctx,
+                         int lo,
+                         int hi,
+                         treeint_scan_cb *cb,
+                         void *arg)
+{
+    size_t nr;
+
+    ebr_read_lock();
+    nr = stp_range((struct stp_tree *) ctx, lo, hi, cb, arg);
+    ebr_read_unlock();
+
+    return nr;
+}
+
+void *treeint_stp_snapshot(void *ctx)
+{
+    struct stp_tree *snap = stp_snapshot((struct stp_tree *) ctx);
+    assert(snap);
+    return snap;
+}
+
+/* The nodes shared with snapshots are counted in full */
+size_t treeint_stp_memsize(void *ctx)
+{
+    struct stp_tree *tree = (struct stp_tree *) ctx;
+    return sizeof(*tree) + tree->nr * sizeof(struct stp_node);
+}
+
+#ifdef PRINT_DEBUG
+static void treeint_stp_dump_preorder(struct stp_node *n)
+{
+    if (!n)
+        return;
+
+    treeint_stp_dump_preorder(n->left);
+    pr_debug("%d\n", n->key);
+    treeint_stp_dump_preorder(n->right);
+}
+
+static void __treeint_stp_dump_lvorder(struct stp_node *n, int level)
+{
+    if (!n) {
+        if (level == 1)
+            pr_debug("null,");
+        return;
+    }
+
+    if (level == 1) {
+        pr_debug("%d,", n->key);
+        return;
+    }
+
+    __treeint_stp_dump_lvorder(n->left, level - 1);
+    __treeint_stp_dump_lvorder(n->right, level - 1);
+}
+
+/* The hints are the exact heights */
+static void treeint_stp_dump_lvorder(struct stp_node *root)
+{
+    int h = root ? root->hint + 1 : 0;
+    for (int i = 1; i <= h; i++)
+        __treeint_stp_dump_lvorder(root, i);
+}
+
+void treeint_stp_dump(void *ctx, enum dump_mode mode)
+{
+    struct stp_tree *tree = (struct stp_tree *) ctx;
+
+    pr_debug("[");
+    if (mode == PRE_ORDER)
+        treeint_stp_dump_preorder(tree->root);
+    else
+        treeint_stp_dump_lvorder(tree->root);
+    pr_debug("]\n");
+}
+#else
+void treeint_stp_dump(__unused void *ctx, __unused enum dump_mode mode) {}
+#endif
@@ -0,0 +1,21 @@
+#ifndef TREEINT_STP_H
+#define TREEINT_STP_H
+
+#include <stddef.h>
+#include "treeint_common.h"
+
+extern void *treeint_stp_init();
+extern int treeint_stp_destroy(void *ctx);
+extern int treeint_stp_insert(void *ctx, int a);
+extern void *treeint_stp_find(void *ctx, int a);
+extern int treeint_stp_remove(void *ctx, int a);
+extern size_t treeint_stp_range(void *ctx,
+                                int lo,
+                                int hi,
+                                treeint_scan_cb *cb,
+                                void *arg);
+extern void *treeint_stp_snapshot(void *ctx);
+extern size_t treeint_stp_memsize(void *ctx);
+extern void treeint_stp_dump(void *ctx, enum dump_mode mode);
+
+#endif
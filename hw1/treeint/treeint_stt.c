@@ -0,0 +1,118 @@
+#include "treeint_stt.h"
+#include <assert.h>
+#include "common.h"
+#include "s_tree_typed.h"
+
+/* The specialized counterpart of treeint_st: same S-Tree, but the int key is
+ * compared inline instead of through treeint_st_cmp().
+ */
+ST_DEFINE(stt, int, (a > b) - (a < b))
+
+void *treeint_stt_init()
+{
+    struct stt_tree *tree = calloc(sizeof(struct stt_tree), 1);
+    assert(tree);
+    stt_init(tree);
+    return tree;
+}
+
+int treeint_stt_destroy(void *ctx)
+{
+    struct stt_tree *tree = (struct stt_tree *) ctx;
+
+    assert(tree);
+    stt_destroy(tree);
+    free(tree);
+    return 0;
+}
+
+int treeint_stt_insert(void *ctx, int a)
+{
+    return stt_insert((struct stt_tree *) ctx, a);
+}
+
+void *treeint_stt_find(void *ctx, int a)
+{
+    return stt_find((struct stt_tree *) ctx, a);
+}
+
+int treeint_stt_remove(void *ctx, int a)
+{
+    return stt_remove((struct stt_tree *) ctx, a);
+}
+
+/* see treeint_st_memsize() */
+size_t treeint_stt_memsize(void *ctx)
+{
+    struct stt_tree *tree = (struct stt_tree *) ctx;
+    size_t size = sizeof(*tree);
+
+    if (!st_root(tree))
+        return size;
+
+    for (struct st_node *n = st_first(st_root(tree)); n; n = st_next(n))
+        size += sizeof(struct stt_node);
+
+    return size;
+}
+
+#ifdef PRINT_DEBUG
+static void treeint_stt_dump_preorder(struct st_node *n)
+{
+    if (!n)
+        return;
+
+    treeint_stt_dump_preorder(st_left(n));
+    pr_debug("%d\n", stt_entry(n)->key);
+    treeint_stt_dump_preorder(st_right(n));
+}
+
+static int treeint_stt_height(struct st_node *node)
+{
+    if (node == NULL)
+        return 0;
+
+    int lheight = treeint_stt_height(st_left(node));
+    int rheight = treeint_stt_height(st_right(node));
+
+    return (lheight > rheight) ? (lheight + 1) : (rheight + 1);
+}
+
+static void __treeint_stt_dump_lvorder(struct st_node *node, int level)
+{
+    if (node == NULL) {
+        if (level == 1)
+            pr_debug("null,");
+        return;
+    }
+
+    if (level == 1) {
+        pr_debug("%d,", stt_entry(node)->key);
+        return;
+    }
+
+    __treeint_stt_dump_lvorder(st_left(node), level - 1);
+    __treeint_stt_dump_lvorder(st_right(node), level - 1);
+}
+
+static void treeint_stt_dump_lvorder(struct st_node *root)
+{
+    int h = treeint_stt_height(root);
+    for (int i = 1; i <= h; i++)
+        __treeint_stt_dump_lvorder(root, i);
+}
+
+void treeint_stt_dump(void *ctx, enum dump_mode mode)
+{
+    struct stt_tree *tree = (struct stt_tree *) ctx;
+
+    pr_debug("[");
+    if (mode == PRE_ORDER)
+        treeint_stt_dump_preorder(st_root(tree));
+    else
+        treeint_stt_dump_lvorder(st_root(tree));
+    pr_debug("]\n");
+}
+#else
+void treeint_stt_dump(__unused void *ctx, __unused enum dump_mode mode) {}
+#endif
@@ -0,0 +1,15 @@
+#ifndef TREEINT_STT_H
+#define TREEINT_STT_H
+
+#include <stddef.h>
+#include "treeint_common.h"
+
+extern void *treeint_stt_init();
+extern int treeint_stt_destroy(void *ctx);
+extern int treeint_stt_insert(void *ctx, int a);
+extern void *treeint_stt_find(void *ctx, int a);
+extern int treeint_stt_remove(void *ctx, int a);
+extern size_t treeint_stt_memsize(void *ctx);
+extern void treeint_stt_dump(void *ctx, enum dump_mode mode);
+
+#endif